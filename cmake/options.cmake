@@ -9,4 +9,6 @@
 
 option(USE_SCRIPTPCH    "Use precompiled headers when compiling scripts"              1)
 option(USE_COREPCH      "Use precompiled headers when compiling servers"             1)
+option(TOOLS           "Build the tools (dealtable_generator, deal_benchmark)"      0)
+option(TESTS           "Build the tests, run by ctest"                              0)
 
@@ -38,6 +38,7 @@
 
 #include <emmintrin.h>                 // Define SSE2 intrinsics
 #include "randomc.h"                   // Define integer types etc
+#include <string.h>
 #include <time.h>
 #include <new>
 
@@ -123,16 +124,14 @@
 #define SFMT_PARITY 0x00000001, 0x00000000, 0x00000000, 0x5986f054  // Period certification vector
 #endif
 
-// Functions used by SFMTRand::RandomInitByArray (UNUSED AND COMMENTED OUT)
-/*
-static uint32_t func1(uint32_t x) {
+// Functions used by SFMTRand::RandomInitByArray
+static inline uint32_t func1(uint32_t x) {
     return (x ^ (x >> 27)) * 1664525U;
 }
 
-static uint32_t func2(uint32_t x) {
+static inline uint32_t func2(uint32_t x) {
     return (x ^ (x >> 27)) * 1566083941U;
 }
-*/
 
 // Subfunction for the sfmt algorithm
 static inline __m128i sfmt_recursion(__m128i const &a, __m128i const &b, 
@@ -185,6 +184,45 @@ public:
         Init2();
     }
 
+    void RandomInitByArray(uint32_t const* key, uint32_t length) // Re-seed with more than 32 bits
+    {
+        // Re-seed, init_by_array of the SFMT reference implementation
+        uint32_t i, j, count, r;
+        uint32_t* state32 = (uint32_t*)state;
+        const uint32_t size = SFMT_N*4;     // Size of state vector
+        const uint32_t lag = size >= 623 ? 11 : size >= 68 ? 7 : size >= 39 ? 5 : 3;
+        const uint32_t mid = (size - lag) / 2;
+
+        memset(state, 0x8b, sizeof(state));
+        count = length + 1 > size ? length + 1 : size;
+        r = func1(state32[0] ^ state32[mid] ^ state32[size - 1]);
+        state32[mid] += r;
+        r += length;
+        state32[mid + lag] += r;
+        state32[0] = r;
+        count--;
+
+        for (i = 1, j = 0; j < count; j++) {
+            r = func1(state32[i] ^ state32[(i + mid) % size] ^ state32[(i + size - 1) % size]);
+            state32[(i + mid) % size] += r;
+            r += (j < length ? key[j] : 0) + i;
+            state32[(i + mid + lag) % size] += r;
+            state32[i] = r;
+            i = (i + 1) % size;
+        }
+        for (j = 0; j < size; j++) {
+            r = func2(state32[i] + state32[(i + mid) % size] + state32[(i + size - 1) % size]);
+            state32[(i + mid) % size] ^= r;
+            r -= i;
+            state32[(i + mid + lag) % size] ^= r;
+            state32[i] = r;
+            i = (i + 1) % size;
+        }
+
+        // Further initialization and period certification
+        Init2();
+    }
+
     int32_t IRandom(int32_t min, int32_t max)     // Output random integer
     {
         // Output random integer in the interval min <= x <= max
@@ -1,72 +1,236 @@
 #include "AiPlayerPool.h"
 
-#include<stdio.h>
+#include "Log.h"
+#include "Metrics.h"
 #include "Player.h"
+#include "Util.h"
 #include "World.h"
 
-AiPlayerPool::AiPlayerPool()
+#include <cmath>
+
+AiPlayerPool::AiPlayerPool() : _freeHead(0), _idle(0), _size(0), _slotCount(0)
 {
-	uint32 defaultAiCount = sWorld->getIntConfig(CONFIG_AI_PLAYER_COUNT);
+	for (uint32 i = 0; i < AI_POOL_MAX_CHUNKS; ++i)
+		_chunks[i] = nullptr;
+
+	_seatsInUseGauge = sMetrics->GetGauge("landlord_ai_seats_in_use");
+	_idleGauge = sMetrics->GetGauge("landlord_ai_pool_idle");
+	_sizeGauge = sMetrics->GetGauge("landlord_ai_pool_players");
+	_missCounter = sMetrics->GetCounter("landlord_ai_pool_misses_total");
+
+	_minIdle = sWorld->getIntConfig(CONFIG_AI_PLAYER_COUNT);
+	_sampleTimer.SetInterval(AI_POOL_SAMPLE_INTERVAL);
+
+	for (uint32 i = 0; i < _minIdle && Grow(); ++i)
+		;
 
-	for (uint32 i = 0; i < defaultAiCount; ++i) 
+	_idleGauge->Set(_idle);
+	_sizeGauge->Set(_size);
+}
+
+AiPlayerPool::~AiPlayerPool()
+{
+	for (uint32 i = 0; i < AI_POOL_MAX_CHUNKS; ++i)
 	{
-		Player* player = new Player(nullptr);
-		_aiPlayerList.push_back(player);
+		AiSlot* chunk = _chunks[i];
+		if (!chunk)
+			continue;
+
+		for (uint32 j = 0; j < AI_POOL_CHUNK_SLOTS; ++j)
+			delete chunk[j].player;
+		delete[] chunk;
 	}
+
 }
 
-AiPlayerPool::~AiPlayerPool()
+bool AiPlayerPool::Pop(uint32& index)
 {
-	for (Player* player : _aiPlayerList)
+	uint64 head = _freeHead.load(std::memory_order_acquire);
+	while (uint32(head) != 0)
 	{
-		delete player;
+		uint32 next = GetSlot(uint32(head) - 1).next.load(std::memory_order_relaxed);
+		uint64 newHead = ((head >> 32) + 1) << 32 | next;
+
+		if (_freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+		{
+			index = uint32(head) - 1;
+			--_idle;
+			return true;
+		}
 	}
+	return false;
 }
 
-Player * AiPlayerPool::getAiPlayer(uint32 roomid)
+void AiPlayerPool::Push(uint32 index)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(_aiPlayerPoolLock);
+	AiSlot& slot = GetSlot(index);
+
+	/// counted first, a concurrent pop never sees the count below the stack
+	++_idle;
+
+	uint64 head = _freeHead.load(std::memory_order_relaxed);
+	uint64 newHead;
+	do
+	{
+		slot.next.store(uint32(head), std::memory_order_relaxed);
+		newHead = (head >> 32) << 32 | (index + 1);
+	} while (!_freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
 
-	if (_aiPlayerList.empty()) 
+bool AiPlayerPool::Grow()
+{
+	uint32 index;
 	{
-		Player* player = new Player(nullptr);
-		_aiPlayerList.push_back(player);
+		std::lock_guard<std::mutex> lock(_growLock);
+
+		if (!_emptySlots.empty())
+		{
+			index = _emptySlots.back();
+			_emptySlots.pop_back();
+		}
+		else
+		{
+			if (_slotCount == AI_POOL_MAX_CHUNKS * AI_POOL_CHUNK_SLOTS)
+				return false;
+
+			index = _slotCount++;
+			if (index % AI_POOL_CHUNK_SLOTS == 0)
+				_chunks[index / AI_POOL_CHUNK_SLOTS].store(new AiSlot[AI_POOL_CHUNK_SLOTS](), std::memory_order_release);
+		}
 	}
 
-	Player *player = _aiPlayerList.back();
-		
-	_aiPlayerList.pop_back();
-	
-	configureAiPlayer(player, roomid);
-	printf("getAiPlayer: %d,now ai count: %d\n", player->getid(),_aiPlayerList.size());
-	return player;
+	/// the identity never changes, checkouts only copy it
+	AiSlot& slot = GetSlot(index);
+	slot.player = new Player(nullptr);
+	slot.sex = urand(0, 1);
+	snprintf(slot.account, sizeof(slot.account), "%u", GetSlotPlayerId(index));
+
+	++_size;
+	Push(index);
+	return true;
+}
+
+bool AiPlayerPool::Shrink()
+{
+	uint32 index;
+	if (!Pop(index))
+		return false;
+
+	AiSlot& slot = GetSlot(index);
+	delete slot.player;
+	slot.player = nullptr;
+	--_size;
+
+	std::lock_guard<std::mutex> lock(_growLock);
+	_emptySlots.push_back(index);
+	return true;
 }
 
-void AiPlayerPool::configureAiPlayer(Player * player, uint32 roomid)
+Player * AiPlayerPool::getAiPlayer(RoomConfig const& room)
 {
+	uint32 index;
+	while (!Pop(index))
+	{
+		/// the demand grew faster than the pool was prewarmed
+		_missCounter->Add();
+		if (!Grow())
+		{
+			TC_LOG_DEBUG("server.ai", "AiPlayerPool: all %u players are seated, no ai for room %u", uint32(_size), room.id);
+			return nullptr;
+		}
+	}
+
+	std::unordered_map<uint32, RoomDemand>::iterator itr = _rooms.find(room.id);
+	if (itr != _rooms.end())
+		++itr->second.checkouts;
+
+	configureAiPlayer(index, room);
+	_seatsInUseGauge->Add(1);
+	_idleGauge->Set(_idle);
+	return GetSlot(index).player;
+}
+
+void AiPlayerPool::configureAiPlayer(uint32 index, RoomConfig const& room)
+{
+	AiSlot& slot = GetSlot(index);
+	Player* player = slot.player;
+
+	/// what an ai player shows in the room, only the id, sex and account differ between players
 	PlayerInfo aiPlayerInfo;
-	
-	aiPlayerInfo.id = 2000 + rand() % 100;
-	aiPlayerInfo.sex = rand() % 2;
-	aiPlayerInfo.gold = sWorld->getIntConfig(WorldIntConfigs(CONFIG_ROOM1_GOLD + roomid));
-	aiPlayerInfo.level = roomid * 2 + 1;
-	aiPlayerInfo.all_Chess = roomid * 100 + 80;
+	aiPlayerInfo.gold = room.gold;
+	aiPlayerInfo.level = room.id * 2 + 1;
+	aiPlayerInfo.all_Chess = room.id * 100 + 80;
 	aiPlayerInfo.win_chess = aiPlayerInfo.all_Chess * 0.4;
 	aiPlayerInfo.win_Rate = 0.4;
-	snprintf(aiPlayerInfo.account, 12,"%d", aiPlayerInfo.id + 524288);
-	memcpy(aiPlayerInfo.nick_name, "",8);
+	memcpy(aiPlayerInfo.nick_name, "", 8);
+	aiPlayerInfo.id = GetSlotPlayerId(index);
+	aiPlayerInfo.sex = slot.sex;
+	memcpy(aiPlayerInfo.account, slot.account, sizeof(slot.account));
 
 	player->loadData(aiPlayerInfo);
+	player->setRoomId(room.id);
 	player->setPlayerType(PLAYER_TYPE_AI);
 	player->setStart();
-
 }
 
 void AiPlayerPool::releasePlayer(Player * player)
 {
-	_aiPlayerPoolLock.lock();
-	_aiPlayerList.push_back(player);
-	static uint32  releaseAiCount = 0;
-	printf("releasePlayer,now ai count: %d\n", _aiPlayerList.size());
-	_aiPlayerPoolLock.unlock();
-}
\ No newline at end of file
+	uint32 index = player->getid() - AI_PLAYER_BASE_ID;
+	ASSERT(index < AI_POOL_MAX_CHUNKS * AI_POOL_CHUNK_SLOTS && _chunks[index / AI_POOL_CHUNK_SLOTS] && GetSlot(index).player == player);
+
+	Push(index);
+	_seatsInUseGauge->Add(-1);
+	_idleGauge->Set(_idle);
+}
+
+void AiPlayerPool::SetRoom(RoomConfig const& room)
+{
+	/// the demand seen so far is kept through a reload
+	_rooms[room.id].fill = room.aiPolicy == ROOM_AI_FILL;
+}
+
+void AiPlayerPool::RemoveRoom(uint32 roomId)
+{
+	_rooms.erase(roomId);
+}
+
+void AiPlayerPool::Update(uint32 diff)
+{
+	_sampleTimer.Update(diff);
+	if (!_sampleTimer.Passed())
+		return;
+	_sampleTimer.Reset();
+
+	/// keep idle twice the checkouts a sample interval sees on average in each room seating ai players.
+	/// A room whose last sample is above its average is prewarmed for the sample, a room getting busy
+	/// is not left to catch up a quarter at a time.
+	uint32 target = 0;
+	for (std::unordered_map<uint32, RoomDemand>::iterator itr = _rooms.begin(); itr != _rooms.end(); ++itr)
+	{
+		RoomDemand& demand = itr->second;
+		uint32 checkouts = demand.checkouts.exchange(0);
+		demand.average = demand.average * 0.75f + checkouts * 0.25f;
+
+		if (demand.fill)
+			target += uint32(std::ceil(std::max(demand.average, float(checkouts)) * 2.0f));
+	}
+	target = std::max(_minIdle, target);
+	uint32 idle = _idle;
+
+	if (idle < target)
+	{
+		while (idle < target && Grow())
+			++idle;
+	}
+	else if (idle > target * 2)
+	{
+		/// the demand dropped, give a quarter of the excess back each sample
+		for (uint32 excess = (idle - target) / 4; excess > 0 && Shrink(); --excess)
+			;
+	}
+
+	_idleGauge->Set(_idle);
+	_sizeGauge->Set(_size);
+	TC_LOG_DEBUG("server.ai", "AiPlayerPool: %u players, %u idle, prewarmed for %u over %u rooms", uint32(_size), uint32(_idle), target,
+		uint32(_rooms.size()));
+}
@@ -1,8 +1,30 @@
 #ifndef __AI_PLAYER_POOL_H
 #define __AI_PLAYER_POOL_H
 
+#include "Player.h"
+#include "RoomConfig.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class MetricCounter;
+class MetricGauge;
 class Player;
 
+#define AI_PLAYER_BASE_ID        0x80000000          /// ai ids have the high bit set, account ids never do
+#define AI_POOL_CHUNK_SLOTS      256
+#define AI_POOL_MAX_CHUNKS       256                 /// 65536 ai players at most
+#define AI_POOL_SAMPLE_INTERVAL  5000                /// ms between two samples of the ai demand
+
+/// Ai players filling the desks of players waiting too long.
+/// Every pooled player has a fixed slot, its id and identity are computed once when the slot
+/// is created. Idle players are kept in a lock-free stack of slot indexes, checkout and release
+/// from the room update threads are a compare and swap each.
+/// The pool is grown and shrunk by Update() on the world thread, to the ai demand of each room
+/// filling its desks with ai averaged over the last samples, so checkouts rarely have to allocate.
 class AiPlayerPool
 {
 public:
@@ -12,21 +34,79 @@ public:
 		return &instance;
 	}
 
-	Player * getAiPlayer(uint32 roomid);
+	/// ai player dressed for the room, nullptr when every player the pool can hold is seated
+	Player * getAiPlayer(RoomConfig const& room);
 	void releasePlayer(Player * player);
 
+	/// samples the demand and prewarms the pool, called between two room updates
+	void Update(uint32 diff);
+
+	/// a room opened or given new settings, the pool prewarms for it when it fills its desks with
+	/// ai. Called on the world thread between two room updates, like RemoveRoom.
+	void SetRoom(RoomConfig const& room);
+	/// a room closed, the pool stops prewarming for it
+	void RemoveRoom(uint32 roomId);
+
+	uint32 GetIdleCount() const { return _idle; }
+	uint32 GetPlayerCount() const { return _size; }
+
 private:
-	typedef std::list<Player *> aiPlayerList;
+	struct AiSlot
+	{
+		Player* player;
+		std::atomic<uint32> next;          /// slot index + 1 of the next idle player, 0 ends the stack
+		uint32 sex;
+		char account[12];
+	};
+
+	struct RoomDemand
+	{
+		RoomDemand() : checkouts(0), average(0.0f), fill(false) { }
 
-	aiPlayerList _aiPlayerList;
-	std::recursive_mutex _aiPlayerPoolLock;
+		std::atomic<uint32> checkouts;     /// since the last sample
+		float average;                     /// checkouts a sample, averaged
+		bool fill;                         /// the room seats ai players
+	};
 
-	void configureAiPlayer(Player * player, uint32 roomid);
+	/// the player id of a slot, the account name shown to the clients is the id too
+	static uint32 GetSlotPlayerId(uint32 index) { return AI_PLAYER_BASE_ID + index; }
+
+	AiSlot& GetSlot(uint32 index) const
+	{
+		return _chunks[index / AI_POOL_CHUNK_SLOTS].load(std::memory_order_acquire)[index % AI_POOL_CHUNK_SLOTS];
+	}
+
+	bool Pop(uint32& index);
+	void Push(uint32 index);
+	/// creates a player in a new slot and makes it idle, false when the pool is full
+	bool Grow();
+	/// deletes an idle player, its slot is reused by the next Grow()
+	bool Shrink();
+
+	void configureAiPlayer(uint32 index, RoomConfig const& room);
 
 	AiPlayerPool();
 	~AiPlayerPool();
+
+	std::atomic<AiSlot*> _chunks[AI_POOL_MAX_CHUNKS];
+	std::atomic<uint64> _freeHead;         /// tag << 32 | slot index + 1, the tag changes on every pop against ABA
+	std::atomic<uint32> _idle;
+	std::atomic<uint32> _size;
+	uint32 _slotCount;                     /// slots created, used or not
+
+	std::vector<uint32> _emptySlots;       /// slots whose player was deleted by Shrink()
+	std::mutex _growLock;
+
+	std::unordered_map<uint32, RoomDemand> _rooms;     /// by room id, only changed between two room updates
+	uint32 _minIdle;
+	IntervalTimer _sampleTimer;
+
+	MetricGauge* _seatsInUseGauge;
+	MetricGauge* _idleGauge;
+	MetricGauge* _sizeGauge;
+	MetricCounter* _missCounter;
 };
 
 #define sAiPlayerPool AiPlayerPool::instance()
 
-#endif
\ No newline at end of file
+#endif
@@ -1,5 +1,6 @@
 #include "OutCardAI.h"
 
+#include "Desk.h"
 #include "Player.h"
 OutCardAi::OutCardAi()
 {
@@ -28,8 +29,7 @@ void OutCardAi::resetCards(uint8 * cards)
 void OutCardAi::OutCard(Player *player)
 {
 	/// test
-	if (player->getLandlordId() == player->getid() && getCardsNumber(player->_cards) == 20
-		|| (player->_left->_cardType == CARD_TYPE_PASS && player->_right->_cardType == CARD_TYPE_PASS))
+	if (player->getDesk()->leads(player->getid()))
 	{
 		resetCards(player->_outCards);
 		player->_outCards[0] = player->_cards[0];
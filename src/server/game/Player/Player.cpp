@@ -1,57 +1,243 @@
 #include "Player.h"
 
+#include "Desk.h"
+#include "GameVariant.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "OutCardAI.h"
+#include "PlayerStore.h"
+#include "Room.h"
+#include "RoomManager.h"
+#include "TickProfiler.h"
+#include "TimingHistogram.h"
+#include "Tournament.h"
+#include "Util.h"
 #include "WorldSession.h"
 #include "World.h"
 
 #define PLAYER(left,right) (left !=nullptr ? left:right)
 
-Player::Player(WorldSession* session) :_roomid(0), _left(nullptr), _right(nullptr), _queueFlags(QUEUE_FLAGS_NULL)
-, _playerType(PLAYER_TYPE_USER), _start(false), _defaultGrabLandlordPlayerId(0), _grabLandlordScore(-1), _landlordPlayerId(-1)
-, _gameStatus(GAME_STATUS_WAIT_START), _winGold(0)
+PlayerStateHandler const Player::_stateHandlers[PLAYER_STATE_COUNT] =
+{
+	/*0x00*/{ "wait_start",                nullptr },
+	/*0x01*/{ "starting",                  &Player::checkStart },
+	/*0x02*/{ "started",                   nullptr },
+	/*0x03*/{ "dealing_card",              &Player::checkDealCards },
+	/*0x04*/{ "dealed_card",               &Player::updateGrab },
+	/*0x05*/{ "grabing_landlord",          &Player::updateGrab },
+	/*0x06*/{ "grabed_landlord",           &Player::updateGrab },
+	/*0x07*/{ "wait_out_card",             &Player::updateOutCard },
+	/*0x08*/{ "out_carding",               &Player::updateOutCard },
+	/*0x09*/{ "out_carded",                &Player::updateOutCard },
+	/*0x0A*/{ "roundovering",              &Player::checkRoundOver },
+	/*0x0B*/{ "roundovered",               &Player::checkRoundOver },
+};
+
+namespace
+{
+	/// time from the event waking a player to the transitions it causes, by reached state
+	struct TransitionLatency
+	{
+		TransitionLatency()
+		{
+			for (uint32 i = 0; i <= PLAYER_STATE_COUNT; ++i)
+				sMetrics->RegisterHistogram("landlord_player_transition_seconds",
+					std::string("state=\"") + Player::getStateName(i < PLAYER_STATE_COUNT ? GameStatus(i) : GAME_STATUS_LOG_OUTING) + "\"", &states[i]);
+		}
+
+		TimingHistogram states[PLAYER_STATE_COUNT + 1];      /// the last one for both log out states
+	};
+
+	TimingHistogram& GetTransitionLatency(GameStatus status)
+	{
+		static TransitionLatency latency;
+		return latency.states[(status & 0xf0) ? PLAYER_STATE_COUNT : status];
+	}
+}
+
+Player::Player(WorldSession* session) :_awake(true), _updating(false), _wokenAt(std::chrono::steady_clock::now())
+, _timers(nullptr), _expirationTimer(this, &Player::onExpiration)
+, _aiDelayTimer(this, &Player::onAiDelay), _turnTimer(this, &Player::onTurnTimeout), _expired(false), _aiThought(false)
+, _turnExpired(false), _autoPlay(false), _desk(nullptr), _seat(0), _roomid(0), _room(nullptr), _left(nullptr), _right(nullptr)
+, _queueFlags(QUEUE_FLAGS_NULL), _playerType(PLAYER_TYPE_USER), _gameStatus(GAME_STATUS_WAIT_START), _start(false)
+, _grabLandlordScore(-1), _winGold(0), _roundWon(false), _playCount(0)
+, _resumeToken(0), _disconnected(false)
 {
 	_session = session;
 
-	for (int i = 0; i < CARD_NUMBER; ++i)
+	for (int i = 0; i < HAND_CARD_NUMBER; ++i)
 		_cards[i] = CARD_TERMINATE;
-	for (int i = 0; i < BASIC_CARD; ++i)
-		_baseCards[i] = CARD_TERMINATE;
+	for (int i = 0; i < 24; ++i)
+		_outCards[i] = CARD_TERMINATE;
+	_cardType = CARD_TYPE_PASS;
 
-	_expiration = sWorld->getIntConfig(CONFIG_WAIT_TIME);
-	_aiDelay = sWorld->getIntConfig(CONFIG_AI_DELAY);
 }
 
 Player::~Player()
 {
-
+	if (_playerType & PLAYER_TYPE_USER)
+		sRoomMgr->RemovePlayer(this);
 }
 
-void Player::Update(uint32 diff)
+void Player::Update(uint32 /*diff*/)
 {
-	if (_queueFlags == QUEUE_FLAGS_ONE || _queueFlags == QUEUE_FLAGS_TWO)
-	  _expiration -= diff;
-
-	UpdateAiDelay(diff);
+	_awake = false;
+	_updating = true;
+	_eventTime = _wokenAt;
 
 	checkOutPlayer();
 	checkQueueStatus();
-	checkStart();
-	checkDealCards();
+
+	/// each state reached runs its handler, until the player waits for another event
+	for (uint32 steps = 0; steps < PLAYER_STATE_COUNT && _gameStatus < PLAYER_STATE_COUNT; ++steps)
+	{
+		GameStatus status = _gameStatus;
+		if (void (Player::*handler)() = _stateHandlers[status].handler)
+			(this->*handler)();
+
+		if (_gameStatus == status)
+			break;
+	}
+
+	_updating = false;
+}
+
+void Player::wakeUp()
+{
+	if (_awake)
+		return;
+
+	_awake = true;
+	_wokenAt = std::chrono::steady_clock::now();
+}
+
+void Player::setGameStatus(GameStatus status)
+{
+	if (status == _gameStatus)
+		return;
+
+	TC_LOG_DEBUG("server.state", "Player %u: %s -> %s", getid(), getStateName(_gameStatus), getStateName(status));
+	_gameStatus = status;
+	if (_desk)
+		_desk->setSeatStatus(_seat, status);
+
+	/// a transition of Update is timed from its event, the next one from this transition
+	if (_updating)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		GetTransitionLatency(status).Record(uint32(std::chrono::duration_cast<std::chrono::microseconds>(now - _eventTime).count()));
+		_eventTime = now;
+	}
+	else
+		wakeUp();
+
+	/// the neighbours follow the status of the desk
+	if (_left)
+		_left->wakeUp();
+	if (_right)
+		_right->wakeUp();
+}
+
+char const* Player::getStateName(GameStatus status)
+{
+	if (status & GAME_STATUS_LOG_OUTED)
+		return "log_outed";
+	if (status & GAME_STATUS_LOG_OUTING)
+		return "log_outing";
+	return status < PLAYER_STATE_COUNT ? _stateHandlers[status].name : "unknown";
+}
+
+void Player::updateGrab()
+{
+	checkTurnTimeout();
 	checkGrabLandlord();
+}
+
+void Player::updateOutCard()
+{
+	checkTurnTimeout();
 	checkOutCard();
-	checkRoundOver();
 }
 
-void Player::UpdateAiDelay(const uint32 diff)
+void Player::setTimers(TimingWheel* timers)
 {
-	if (!(getPlayerType() & PLAYER_TYPE_AI))
+	if (timers == _timers)
 		return;
 
-	if (_gameStatus == GAME_STATUS_GRABING_LANDLORD || _gameStatus == GAME_STATUS_OUT_CARDING)
+	stopTimers();
+	_timers = timers;
+
+	/// a player queued before reaching the room starts waiting now
+	if (_timers && (_queueFlags == QUEUE_FLAGS_ONE || _queueFlags == QUEUE_FLAGS_TWO) && !_expired)
+		restartExpiration();
+}
+
+void Player::setRoom(Room* room)
+{
+	_room = room;
+	setTimers(room ? &room->GetTimers() : nullptr);
+}
+
+void Player::stopTimers()
+{
+	_expirationTimer.Cancel();
+	_aiDelayTimer.Cancel();
+	_turnTimer.Cancel();
+	_aiThought = false;
+	_turnExpired = false;
+}
+
+void Player::restartExpiration()
+{
+	_expired = false;
+	if (_timers)
+		_timers->Schedule(_expirationTimer, _room->GetConfig().waitTime);
+}
+
+bool Player::aiThinkDone()
+{
+	if (_aiThought)
 	{
-		_aiDelay -= diff;
+		_aiThought = false;
+		return true;
 	}
+
+	if (!_aiDelayTimer.IsScheduled() && _timers)
+		_timers->Schedule(_aiDelayTimer, _room->GetConfig().aiDelay);
+	return false;
+}
+
+void Player::setQueueFlags(AtQueueFlags flags)
+{
+	/// only time spent in the match queue or at a desk of two counts as waiting
+	if (flags == QUEUE_FLAGS_ONE && _queueFlags == QUEUE_FLAGS_NULL)
+		restartExpiration();
+
+	_queueFlags = flags;
+	if (_desk)
+		_desk->setSeatFlag(_seat, DESK_SEAT_AT_THREE, flags == QUEUE_FLAGS_THREE);
+	wakeUp();
+}
+
+void Player::setStart()
+{
+	setGameStatus(GAME_STATUS_STARTING);
+	_playerInfo.start = 1;
+	if (_desk)
+		_desk->setSeatFlag(_seat, DESK_SEAT_STARTED, true);
+}
+
+void Player::setDesk(Desk* desk, uint8 seat)
+{
+	_desk = desk;
+	_seat = seat;
+	if (!_desk)
+		return;
+
+	_desk->setSeatStatus(_seat, _gameStatus);
+	_desk->setSeatFlag(_seat, DESK_SEAT_STARTED, started());
+	_desk->setSeatFlag(_seat, DESK_SEAT_AT_THREE, _queueFlags == QUEUE_FLAGS_THREE);
+	wakeUp();
 }
 
 void Player::checkOutPlayer()
@@ -84,18 +270,24 @@ void Player::checkOutPlayer()
 		if (_right != nullptr && _right->getPlayerType() == PLAYER_TYPE_USER )
 			_right->GetSession()->SendPacket(&data);
 
+		if (_desk)
+			_desk->broadcast(data);
+
+		/// a tournament plays on with the ai in the seat of a player leaving
+		bool tournament = _room && _room->GetTournament();
+
 		if (logoutStatus == 4)
 		{
-			if (_left->getPlayerType() == PLAYER_TYPE_USER || _right->getPlayerType() == PLAYER_TYPE_USER)
+			if (_disconnected || tournament || _left->getPlayerType() == PLAYER_TYPE_USER || _right->getPlayerType() == PLAYER_TYPE_USER)
 			{
-				_gameStatus = GameStatus(0x0f & _gameStatus);
+				setGameStatus(GameStatus(0x0f & _gameStatus));
 			}
 			else
 			{
 				_left->setGameStatus(GAME_STATUS_LOG_OUTING);
 				_right->setGameStatus(GAME_STATUS_LOG_OUTING);
 
-				_gameStatus = GAME_STATUS_LOG_OUTED;
+				setGameStatus(GAME_STATUS_LOG_OUTED);
 			}
 			_playerType = PLAYER_TYPE_REPLACE_AI;
 		}			
@@ -104,7 +296,8 @@ void Player::checkOutPlayer()
 			if (_left != nullptr)
 			{
 				_left->_right = nullptr;
-				if (_left->getPlayerType() == PLAYER_TYPE_AI)
+				_left->wakeUp();
+				if (_left->getPlayerType() == PLAYER_TYPE_AI && !tournament)
 				{
 					_left->setGameStatus(GAME_STATUS_LOG_OUTING);
 					_left->checkOutPlayer();
@@ -114,7 +307,8 @@ void Player::checkOutPlayer()
 			if (_right != nullptr)
 			{
 				_right->_left = nullptr;
-				if (_right->getPlayerType() == PLAYER_TYPE_AI)
+				_right->wakeUp();
+				if (_right->getPlayerType() == PLAYER_TYPE_AI && !tournament)
 				{
 					_right->setGameStatus(GAME_STATUS_LOG_OUTING);
 					_right->checkOutPlayer();
@@ -122,7 +316,7 @@ void Player::checkOutPlayer()
 			}
 			_left = nullptr;
 			_right = nullptr;
-			_gameStatus = GAME_STATUS_LOG_OUTED;
+			setGameStatus(GAME_STATUS_LOG_OUTED);
 		}
 		
 		if (_session != nullptr)
@@ -133,10 +327,78 @@ void Player::checkOutPlayer()
 
 void Player::logOutPlayer()
 {
-	_gameStatus = GameStatus(_gameStatus | GAME_STATUS_LOG_OUTING);
+	setGameStatus(GameStatus(_gameStatus | GAME_STATUS_LOG_OUTING));
 	checkOutPlayer();
 }
 
+void Player::disconnect()
+{
+	/// even a desk of ai players is kept, the round goes on while the client reconnects
+	_disconnected = true;
+	logOutPlayer();
+}
+
+bool Player::resume(WorldSession* session, uint64 token)
+{
+	if (_session != nullptr || _playerType != PLAYER_TYPE_REPLACE_AI || (_gameStatus & 0xf0) != 0
+		|| token == 0 || token != _resumeToken)
+		return false;
+
+	_session = session;
+	_playerType = PLAYER_TYPE_USER;
+	_disconnected = false;
+	_autoPlay = false;
+	wakeUp();
+	_aiDelayTimer.Cancel();
+	_turnTimer.Cancel();
+	_aiThought = false;
+	_turnExpired = false;
+
+	/// a turn handed to the ai but not played yet goes back to the client
+	if (_gameStatus == GAME_STATUS_OUT_CARDING)
+		setGameStatus(GAME_STATUS_WAIT_OUT_CARD);
+	else if (_gameStatus == GAME_STATUS_GRABING_LANDLORD)
+		setGameStatus(GAME_STATUS_DEALED_CARD);
+	return true;
+}
+
+uint32 Player::getCardCount()
+{
+	uint32 count = 0;
+	while (count < HAND_CARD_NUMBER && _cards[count] != CARD_TERMINATE)
+		++count;
+	return count;
+}
+
+void Player::sendResumeState()
+{
+	WorldPacket data(CMSG_PLAYER_RESUME, 80);
+
+	data.resize(8);
+	data << uint32(1);
+	data << uint32(_roomid);
+	data << uint32(_gameStatus);
+	data << int32(_desk ? _desk->getLandlordId() : -1);
+	data << _grabLandlordScore;
+	data << uint32(_left ? _left->getid() : 0);
+	data << uint32(_left ? _left->getCardCount() : 0);
+	data << uint32(_right ? _right->getid() : 0);
+	data << uint32(_right ? _right->getCardCount() : 0);
+	uint8 baseCards[BASIC_CARD];
+	memset(baseCards, CARD_TERMINATE, BASIC_CARD);
+	if (_desk)
+		memcpy(baseCards, _desk->getBaseCards(), BASIC_CARD);
+
+	data.append(_cards, HAND_CARD_NUMBER);
+	data.append(baseCards, BASIC_CARD);
+
+	GetSession()->SendPacket(&data);
+
+	/// the other players of the desk as at the start of the round
+	if (_left && _right)
+		sendThreeDesk();
+}
+
 void Player::checkQueueStatus()
 {
 	if (_left != nullptr && _right != nullptr)
@@ -144,6 +406,9 @@ void Player::checkQueueStatus()
 		if (_queueFlags != QUEUE_FLAGS_THREE)
 		{
 			_queueFlags = QUEUE_FLAGS_THREE;
+			if (_desk)
+				_desk->setSeatFlag(_seat, DESK_SEAT_AT_THREE, true);
+			_expirationTimer.Cancel();
 			sendThreeDesk();
 		}
 	}
@@ -152,6 +417,8 @@ void Player::checkQueueStatus()
 		if (_queueFlags != QUEUE_FLAGS_TWO)
 		{
 			_queueFlags = QUEUE_FLAGS_TWO;
+			if (!_expirationTimer.IsScheduled() && !_expired)
+				restartExpiration();
 			sendTwoDesk();
 		}
 	}
@@ -162,43 +429,21 @@ void Player::checkStart()
 {
 	if (_gameStatus == GAME_STATUS_STARTING)
 	{
-		if (_left != nullptr && _left->getPlayerType() == PLAYER_TYPE_USER)
-		{
-			WorldPacket data(CMSG_WAIT_START, 12);
-			data.resize(8);
-			data << uint32(this->getid());
+		WorldPacket data(CMSG_WAIT_START, 12);
+		data.resize(8);
+		data << uint32(this->getid());
 
+		if (_left != nullptr && _left->getPlayerType() == PLAYER_TYPE_USER)
 			_left->GetSession()->SendPacket(&data);
-		}
 
 		if (_right != nullptr && _right->getPlayerType() == PLAYER_TYPE_USER)
-		{
-			WorldPacket data(CMSG_WAIT_START, 12);
-			data.resize(8);
-			data << uint32(this->getid());
-
 			_right->GetSession()->SendPacket(&data);
-		}
-		_gameStatus = GAME_STATUS_STARTED;
-	}
-}
 
-uint32 Player::getDefaultLandlordUserId()
-{
-	if (_defaultGrabLandlordPlayerId == 0)
-	{
-		uint8 iLandlordUserIdx = (rand() % 3);
-		switch (iLandlordUserIdx)
-		{
-		case 0:_defaultGrabLandlordPlayerId = this->getid(); break;
-		case 1:_defaultGrabLandlordPlayerId = _left->getid(); break;
-		case 2:_defaultGrabLandlordPlayerId = _right->getid(); break;
-		}
-		_left->setDefaultLandlordUserId(_defaultGrabLandlordPlayerId);
-		_right->setDefaultLandlordUserId(_defaultGrabLandlordPlayerId);
-	}
+		if (_desk)
+			_desk->broadcast(data);
 
-	return _defaultGrabLandlordPlayerId;
+		setGameStatus(GAME_STATUS_STARTED);
+	}
 }
 
 void Player::checkDealCards()
@@ -209,53 +454,147 @@ void Player::checkDealCards()
 		{
 			WorldPacket data(SMSG_CARD_DEAL, 36);
 			data.resize(8);
-			data << getDefaultLandlordUserId();
+			data << _desk->getDefaultGrabId();
 			data.append((char *)_cards, CARD_NUMBER);
-			data.append((char *)_baseCards, BASIC_CARD);
+			data.append(_desk->getBaseCards(), BASIC_CARD);
 
 			GetSession()->SendPacket(&data);
 		}
-		_gameStatus = GAME_STATUS_DEALED_CARD;
+		setGameStatus(GAME_STATUS_DEALED_CARD);
 
-		if (getDefaultLandlordUserId() == getid() && (getPlayerType() & PLAYER_TYPE_AI))
-			_gameStatus = GAME_STATUS_GRABING_LANDLORD;
+		if (_desk->getDefaultGrabId() == getid() && (getPlayerType() & PLAYER_TYPE_AI))
+			setGameStatus(GAME_STATUS_GRABING_LANDLORD);
 	}
 }
 
 uint32 Player::aiGrabLandlord()
 {
-	uint32 leftGrabScore = _left->getGrabLandlordScore();
-	uint32 rightGrabScore = _right->getGrabLandlordScore();
-
-	uint32 maxScore = std::max(leftGrabScore, rightGrabScore);
-
-	if (leftGrabScore == -1 && rightGrabScore == -1)
-		return (rand() % 4);
-	else if (maxScore == 0)
-		return 1;
-	else 
-		return 0;
+	return _desk->getVariant()->AiGrabScore(_left->getGrabLandlordScore(), _right->getGrabLandlordScore());
 }
 
 int32 Player::getLandlordId()
 {
-	if (_landlordPlayerId != -1)
-		return _landlordPlayerId;
+	if (!_desk || _desk->getLandlordId() != -1)
+		return _desk ? _desk->getLandlordId() : -1;
 
 	int32 leftGrabScore = _left->getGrabLandlordScore();
 	int32 rightGrabScore = _right->getGrabLandlordScore();
 	int32 maxScore = std::max(std::max(_grabLandlordScore, leftGrabScore), rightGrabScore);
 
-	if ((_grabLandlordScore != -1 && leftGrabScore != -1 && rightGrabScore != -1) || maxScore == 3)
+	if ((_grabLandlordScore != -1 && leftGrabScore != -1 && rightGrabScore != -1) || maxScore == _desk->getVariant()->GetMaxGrabScore())
 	{	
 		if (maxScore == _grabLandlordScore)
-			_landlordPlayerId = getid();
+			_desk->setLandlordId(getid());
 		else if (maxScore == leftGrabScore)
-			_landlordPlayerId = _left->getid();
+			_desk->setLandlordId(_left->getid());
 		else if (maxScore == rightGrabScore)
-			_landlordPlayerId =  _right->getid();
+			_desk->setLandlordId(_right->getid());
+	}
+	return _desk->getLandlordId();
+}
+
+bool Player::isTurnToGrab()
+{
+	if (!_left || !_right || !_desk)
+		return false;
+	return _gameStatus == GAME_STATUS_DEALED_CARD && (_desk->getDefaultGrabId() == getid()
+		|| _left->getGameStatus() == GAME_STATUS_GRABED_LAND_LORD);
+}
+
+bool Player::isTurnToOutCard()
+{
+	if (_gameStatus != GAME_STATUS_WAIT_OUT_CARD || !_left || !_right || !_desk)
+		return false;
+
+	/// the landlord opens the round with the base cards still in hand
+	if (_desk->getLandlordId() == int32(getid()) && getCardCount() == CARD_NUMBER + 3)
+		return true;
+	return _left->getGameStatus() == GAME_STATUS_OUT_CARDED;
+}
+
+void Player::setAutoPlay(bool on)
+{
+	if (on == _autoPlay)
+		return;
+
+	_autoPlay = on;
+	_aiDelayTimer.Cancel();
+	_aiThought = false;
+	wakeUp();
+
+	TC_LOG_INFO("server.worldserver", "Player %u auto-play %s in room %u", getid(), on ? "on" : "off", _roomid);
+
+	if (!_left || !_right)
+		return;
+
+	WorldPacket data(CMSG_AUTO_PLAY, 16);
+	data.resize(8);
+	data << getid();
+	data << uint32(on);
+
+	if (getPlayerType() == PLAYER_TYPE_USER)
+		GetSession()->SendPacket(&data);
+
+	if (_left->getPlayerType() == PLAYER_TYPE_USER)
+		_left->GetSession()->SendPacket(&data);
+
+	if (_right->getPlayerType() == PLAYER_TYPE_USER)
+		_right->GetSession()->SendPacket(&data);
+
+	if (_desk)
+		_desk->broadcast(data);
+}
+
+void Player::checkTurnTimeout()
+{
+	bool grab = false, outCard = false;
+	if (_playerType == PLAYER_TYPE_USER)
+	{
+		grab = isTurnToGrab();
+		outCard = !grab && isTurnToOutCard();
+	}
+
+	if (!grab && !outCard)
+	{
+		_turnTimer.Cancel();
+		_turnExpired = false;
+		return;
+	}
+
+	if (!_autoPlay)
+	{
+		uint32 timeout = sWorld->getIntConfig(CONFIG_TURN_TIMEOUT);
+		if (!timeout)
+			return;
+
+		if (!_turnExpired)
+		{
+			if (!_turnTimer.IsScheduled() && _timers)
+				_timers->Schedule(_turnTimer, timeout);
+			return;
+		}
+
+		static MetricCounter* timeouts = sMetrics->GetCounter("landlord_turn_timeouts_total");
+		timeouts->Add();
+
+		_turnExpired = false;
+		setAutoPlay(true);
+	}
+	else if (!aiThinkDone())
+		return;
+
+	/// the move goes through checkGrabLandlord and checkOutCard as if the client had sent it
+	PROFILE_TICK_PHASE(TICK_PHASE_AI_DECISION);
+	if (grab)
+	{
+		_grabLandlordScore = aiGrabLandlord();
+		setGameStatus(GAME_STATUS_GRABING_LANDLORD);
+	}
+	else
+	{
+		sOutCardAi->OutCard(this);
+		setGameStatus(GAME_STATUS_OUT_CARDING);
 	}
-	return _landlordPlayerId;
 }
 
 void Player::checkGrabLandlord()
@@ -265,10 +604,9 @@ void Player::checkGrabLandlord()
 
 	if (_gameStatus == GAME_STATUS_DEALED_CARD)
 	{
-		if (getPlayerType() & PLAYER_TYPE_AI && (_defaultGrabLandlordPlayerId == getid()
-			|| _left->getGameStatus() == GAME_STATUS_GRABED_LAND_LORD))
+		if (getPlayerType() & PLAYER_TYPE_AI && isTurnToGrab())
 		{
-			_gameStatus = GAME_STATUS_GRABING_LANDLORD;
+			setGameStatus(GAME_STATUS_GRABING_LANDLORD);
 		}
 	}
 
@@ -278,12 +616,12 @@ void Player::checkGrabLandlord()
 		{
 			if (getPlayerType() & PLAYER_TYPE_AI)
 			{
-				if (_aiDelay > 0)
+				if (!aiThinkDone())
 					break;
 				else
 				{
+					PROFILE_TICK_PHASE(TICK_PHASE_AI_DECISION);
 					_grabLandlordScore = aiGrabLandlord();
-					_aiDelay = sWorld->getIntConfig(CONFIG_AI_DELAY);
 				}
 			}
 		
@@ -303,7 +641,9 @@ void Player::checkGrabLandlord()
 			if (_right->getPlayerType() == PLAYER_TYPE_USER)
 				_right->GetSession()->SendPacket(&data);
 
-		    _gameStatus = GAME_STATUS_GRABED_LAND_LORD;
+			_desk->broadcast(data);
+
+		    setGameStatus(GAME_STATUS_GRABED_LAND_LORD);
 		} while (0);
 	}
 
@@ -311,9 +651,9 @@ void Player::checkGrabLandlord()
 	{
 		if (getGrabLandlordScore() == 0 && _left->getGrabLandlordScore() == 0 && _right->getGrabLandlordScore() == 0)
 		{
-			_defaultGrabLandlordPlayerId = 0;
+			_desk->resetGrab();
 			_grabLandlordScore = -1;
-			_gameStatus = GAME_STATUS_STARTED;
+			setGameStatus(GAME_STATUS_STARTED);
 		}
 		if (getLandlordId() != -1)
 		{
@@ -324,18 +664,20 @@ void Player::checkGrabLandlord()
 
 void Player::beginOutCard()
 {
-	_left->setLandlordId(_landlordPlayerId);
-	_right->setLandlordId(_landlordPlayerId);
+	/// the landlord takes the base cards, the server follows every hand to know when a round ends
+	int32 landlordId = _desk->getLandlordId();
+	Player* landlord = landlordId == int32(getid()) ? this : (landlordId == int32(_left->getid()) ? _left : _right);
+	memcpy(landlord->_cards + CARD_NUMBER, _desk->getBaseCards(), 3);
 
 	setGameStatus(GAME_STATUS_WAIT_OUT_CARD);
 	_left->setGameStatus(GAME_STATUS_WAIT_OUT_CARD);
 	_right->setGameStatus(GAME_STATUS_WAIT_OUT_CARD);
 
-	//if (_landlordPlayerId == getid() && getPlayerType() & PLAYER_TYPE_AI)
+	//if (landlordId == getid() && getPlayerType() & PLAYER_TYPE_AI)
 	//	setGameStatus(GAME_STATUS_OUT_CARDING);
-	//else if (_landlordPlayerId == _left->getid() && _left->getPlayerType() & PLAYER_TYPE_AI)
+	//else if (landlordId == _left->getid() && _left->getPlayerType() & PLAYER_TYPE_AI)
 	//	_left->setGameStatus(GAME_STATUS_OUT_CARDING);
-	//else if (_landlordPlayerId == _right->getid() && _right->getPlayerType() & PLAYER_TYPE_AI)
+	//else if (landlordId == _right->getid() && _right->getPlayerType() & PLAYER_TYPE_AI)
 	//	_right->setGameStatus(GAME_STATUS_OUT_CARDING);
 }
 
@@ -343,10 +685,10 @@ void Player::checkOutCard()
 {
 	if (_gameStatus < GAME_STATUS_WAIT_OUT_CARD || _gameStatus > GAME_STATUS_OUT_CARDED)
 		return;
-	if (getPlayerType() & PLAYER_TYPE_AI && (_gameStatus == GAME_STATUS_WAIT_OUT_CARD && getLandlordId() == getid()
-		|| _left->getGameStatus() == GAME_STATUS_OUT_CARDED))
+	/// the landlord waiting again is not its turn, a human between the ai seats would be skipped
+	if (getPlayerType() & PLAYER_TYPE_AI && isTurnToOutCard())
 	{
-		_gameStatus = GAME_STATUS_OUT_CARDING;
+		setGameStatus(GAME_STATUS_OUT_CARDING);
 	}
 
 	if (_gameStatus == GAME_STATUS_OUT_CARDING)
@@ -355,13 +697,13 @@ void Player::checkOutCard()
 		{
 			if (getPlayerType() & PLAYER_TYPE_AI)
 			{
-				if (_aiDelay > 0)
+				if (!aiThinkDone())
 					break;
 				else
 				{
 					/// ai out cards
+					PROFILE_TICK_PHASE(TICK_PHASE_AI_DECISION);
 					sOutCardAi->OutCard(this);
-					_aiDelay = sWorld->getIntConfig(CONFIG_AI_DELAY);
 				}
 			}
 			WorldPacket data(CMSG_CARD_OUT, 40);
@@ -379,24 +721,35 @@ void Player::checkOutCard()
 			if (_right->getPlayerType() == PLAYER_TYPE_USER)
 				_right->GetSession()->SendPacket(&data);
 
-			_gameStatus = GAME_STATUS_OUT_CARDED;
+			_desk->broadcast(data);
+
+			setGameStatus(GAME_STATUS_OUT_CARDED);
+
+			if (_cardType != CARD_TYPE_PASS)
+				++_playCount;
+			_desk->setLastPlay(getid(), _cardType, _outCards);
 
 			sOutCardAi->updateCardsFace(_cards, _outCards);
 
+			/// an empty hand ends the round for the whole desk
+			if (_cards[0] == CARD_TERMINATE)
+			{
+				settleRound();
+				return;
+			}
+
 			if (_right->getPlayerType() & PLAYER_TYPE_AI)
 				_right->setGameStatus(GAME_STATUS_OUT_CARDING);
 		} while (0);
 	}
 	if (_gameStatus == GAME_STATUS_OUT_CARDED && _right->getGameStatus() == GAME_STATUS_OUT_CARDED)
-		_gameStatus = GAME_STATUS_WAIT_OUT_CARD;
+		setGameStatus(GAME_STATUS_WAIT_OUT_CARD);
 }
 
 void Player::checkRoundOver()
 {
 	if (_gameStatus == GAME_STATUS_ROUNDOVERING)
 	{
-		UpdatePlayerData();
-		
 		WorldPacket data(CMSG_ROUND_OVER, 160);
 
 		data.resize(8);
@@ -405,16 +758,11 @@ void Player::checkRoundOver()
 		if (getPlayerType() == PLAYER_TYPE_USER)
 			GetSession()->SendPacket(&data);
 
-		_gameStatus = GAME_STATUS_ROUNDOVERED;
+		/// the result of each seat
+		if (_desk)
+			_desk->broadcast(data);
 
-		if (_left->getPlayerType() & PLAYER_TYPE_AI && _left->getGameStatus() != GAME_STATUS_ROUNDOVERED)
-			_left->setGameStatus(GAME_STATUS_ROUNDOVERING);
-		if (_right->getPlayerType() & PLAYER_TYPE_AI && _right->getGameStatus() != GAME_STATUS_ROUNDOVERED)
-		{
-			_right->setGameStatus(GAME_STATUS_ROUNDOVERING);
-			_right->checkRoundOver();
-		}
-			
+		setGameStatus(GAME_STATUS_ROUNDOVERED);
 	}
 	if (_gameStatus == GAME_STATUS_ROUNDOVERED)
 	{
@@ -422,25 +770,98 @@ void Player::checkRoundOver()
 	}
 }
 
+void Player::settleRound()
+{
+	Player* players[3] = { this, _left, _right };
+	Player* landlord = nullptr;
+	uint32 bombs = _desk->getBombCount();
+
+	for (Player* player : players)
+	{
+		if (int32(player->getid()) == _desk->getLandlordId())
+			landlord = player;
+	}
+	ASSERT(landlord != nullptr);
+
+	/// spring: the farmers never played, anti-spring: the landlord played only the first hand
+	bool landlordWon = landlord == this;
+	bool spring = false;
+	if (landlordWon)
+		spring = landlord->_left->_playCount == 0 && landlord->_right->_playCount == 0;
+	else
+		spring = landlord->_playCount == 1;
+
+	/// grab score, doubled by each bomb or rocket and once more by a spring
+	uint64 multiplier = _desk->getVariant()->GetMultiplier(landlord->_grabLandlordScore, bombs, spring);
+	uint64 stake = std::min<uint64>(uint64(_room->GetConfig().basicGold) * multiplier, 0x3FFFFFFF);
+
+	/// nobody pays more than they own, the winners share what was paid. A tournament plays for
+	/// points, the stake is paid in full.
+	Tournament* tournament = _room->GetTournament();
+	Player* farmers[2] = { landlord->_left, landlord->_right };
+	if (landlordWon)
+	{
+		uint32 paid = 0;
+		for (Player* farmer : farmers)
+		{
+			uint32 loss = std::min<uint64>(stake, tournament ? stake : farmer->_playerInfo.gold);
+			farmer->_winGold = -int32(loss);
+			paid += loss;
+		}
+		landlord->_winGold = int32(paid);
+	}
+	else
+	{
+		uint32 loss = std::min<uint64>(stake * 2, tournament ? stake * 2 : landlord->_playerInfo.gold);
+		landlord->_winGold = -int32(loss);
+		farmers[0]->_winGold = int32(loss / 2);
+		farmers[1]->_winGold = int32(loss - loss / 2);
+	}
+
+	for (Player* player : players)
+	{
+		/// the points go to the tournament, the gold stays
+		if (tournament)
+		{
+			tournament->AddPoints(player->getid(), player->_winGold);
+			player->_winGold = 0;
+		}
+
+		player->_roundWon = (player == landlord) == landlordWon;
+		player->UpdatePlayerData();
+		/// a pending log out is kept, the player leaves with the round already settled
+		player->setGameStatus(GameStatus((player->getGameStatus() & 0xf0) | GAME_STATUS_ROUNDOVERING));
+	}
+
+	TC_LOG_DEBUG("server.settlement", "Room %u: %s won by player %u, grab score %d, %u bombs%s, stake " UI64FMTD,
+		_roomid, landlordWon ? "landlord" : "farmers", getid(), landlord->_grabLandlordScore, bombs, spring ? ", spring" : "", stake);
+}
+
 void Player::resetGame()
 {
-	for (int i = 0; i < CARD_NUMBER; ++i)
+	for (int i = 0; i < HAND_CARD_NUMBER; ++i)
 		_cards[i] = CARD_TERMINATE;
-	for (int i = 0; i < BASIC_CARD; ++i)
-		_baseCards[i] = CARD_TERMINATE;
 
 	if (getPlayerType() & PLAYER_TYPE_USER )
 		_queueFlags = QUEUE_FLAGS_NULL;
 
-	_expiration = sWorld->getIntConfig(CONFIG_WAIT_TIME);
-	_aiDelay = sWorld->getIntConfig(CONFIG_AI_DELAY);
+	/// a client leaves the desk for its next game, the room releases the other seats with the desk
+	if (_desk && getPlayerType() == PLAYER_TYPE_USER)
+	{
+		_desk->leave(_seat);
+		_desk = nullptr;
+	}
+
+	_expired = false;
+	_autoPlay = false;
+	stopTimers();
 	_left = nullptr;
 	_right = nullptr;
 	_start = false;
-	_defaultGrabLandlordPlayerId = 0; 
 	_grabLandlordScore = -1;
-	_landlordPlayerId = -1;
 	_winGold = 0;
+	_roundWon = false;
+	_playCount = 0;
 }
 
 void Player::UpdatePlayerData()
@@ -451,15 +872,19 @@ void Player::UpdatePlayerData()
 
 	_playerInfo.all_Chess++;
 
-	if (_winGold > 0)
+	if (_roundWon)
 		_playerInfo.win_chess++;
 
 	_playerInfo.win_Rate = 100 * _playerInfo.win_chess / (float)_playerInfo.all_Chess;
 
 	uint32 doubleScore = calcDoubleScore();
-	_playerInfo.score += _winGold > 0 ? (_roomid + 1) * sWorld->getIntConfig(CONFIG_BASICSCORE) * doubleScore : 0;
+	_playerInfo.score += _roundWon ? _room->GetConfig().basicScore * doubleScore : 0;
 
 	UpdatePlayerLevel();
+
+	/// ai players are made up for each game, only real accounts are kept
+	if (getPlayerType() & PLAYER_TYPE_USER)
+		sPlayerStore->Save(_playerInfo);
 }
 
 void Player::UpdatePlayerLevel()
@@ -553,13 +978,14 @@ void Player::addPlayer(Player *player)
 		player->setLeftPlayer(this);
 	}
 
-	_expiration = sWorld->getIntConfig(CONFIG_WAIT_TIME);
+	restartExpiration();
 }
 
-void Player::dealCards(uint8 * cards, uint8 * baseCards)
+void Player::dealCards(uint8 const* cards)
 {
-	memcpy(_cards, cards, sizeof(_cards));
-	memcpy(_baseCards, baseCards, 3/*sizeof(_baseCards)*/);
+	memcpy(_cards, cards, CARD_NUMBER);
+	for (int i = CARD_NUMBER; i < HAND_CARD_NUMBER; ++i)
+		_cards[i] = CARD_TERMINATE;
 
-	_gameStatus = GAME_STATUS_DEALING_CARD;
+	setGameStatus(GAME_STATUS_DEALING_CARD);
 }
\ No newline at end of file
@@ -1,13 +1,21 @@
 #ifndef _PLAYER_H
 #define _PLAYER_H
 
+#include "TimingWheel.h"
+
+#include <chrono>
+
 #define PROPS_COUNT      16
 #define NAME_LENGTH      12
 
 #define CARD_TERMINATE   100
+#define CARD_HIDDEN      0xFF  /// a card of a hand shown to spectators
 #define CARD_NUMBER      17
 #define BASIC_CARD        7
+#define HAND_CARD_NUMBER 21   /// dealt cards and the base cards of the landlord, terminated
 
+class Desk;
+class Room;
 class WorldSession;
 
 struct PlayerInfo
@@ -63,6 +71,17 @@ enum GameStatus:uint8
 	GAME_STATUS_LOG_OUTED          = 0x20
 };
 
+#define PLAYER_STATE_COUNT (GAME_STATUS_ROUNDOVERED + 1)
+
+class Player;
+
+/// what Player::Update runs in a game state
+struct PlayerStateHandler
+{
+	char const* name;
+	void (Player::*handler)();
+};
+
 enum PlayerType
 {
 	PLAYER_TYPE_USER         = 0x01,
@@ -110,33 +129,54 @@ public:
 	uint32 getid(){ return _playerInfo.id; }
 	char const * GetName() { return _playerInfo.nick_name; }
 
+	/// runs the state machine of a player woken by an event: a status change of the player or of
+	/// a neighbour, a packet, a timer or a change of the desk
 	void Update(const uint32 diff);
-	void UpdateAiDelay(const uint32 diff);
+	bool awake(){ return _awake; }
+	void wakeUp();
+	/// timers run on the wheel of the room updating the player, nullptr out of a room
+	void setTimers(TimingWheel* timers);
+	/// room the player sits in, its settings and timers, nullptr out of a room
+	void setRoom(Room* room);
+	Room* getRoom(){ return _room; }
+	void stopTimers();
 	void checkOutPlayer();
 	void checkQueueStatus();
 	void checkStart();
-	uint32 getDefaultLandlordUserId();
-	void setDefaultLandlordUserId(uint32 id){ _defaultGrabLandlordPlayerId = id; }
 	void checkDealCards();
+	void checkTurnTimeout();
 	void checkGrabLandlord();
 	void checkOutCard();
 	void checkRoundOver();
+	void settleRound();
 
 	void UpdatePlayerData();
 	void UpdatePlayerLevel();
 	void sendTwoDesk();
 	void sendThreeDesk();
 	void logOutPlayer();
-	bool expiration(){ return  _expiration < 0; }
+	/// connection lost, the ai plays for the player until the round is over or the client resumes
+	void disconnect();
+	bool resume(WorldSession* session, uint64 token);
+	void sendResumeState();
+	uint64 getResumeToken(){ return _resumeToken; }
+	void setResumeToken(uint64 token){ _resumeToken = token; }
+	uint32 getCardCount();
+	/// turns of a player who let a turn time out are played by the ai until the client acts again
+	bool autoPlay(){ return _autoPlay; }
+	void setAutoPlay(bool on);
+	bool isTurnToGrab();
+	bool isTurnToOutCard();
+	bool expiration(){ return _expired; }
 	void addPlayer(Player *player);
-	void setLeftPlayer(Player * left){  _left = left; }
-	void setRightPlayer(Player * right){ _right = right; }
+	void setLeftPlayer(Player * left){  _left = left; wakeUp(); }
+	void setRightPlayer(Player * right){ _right = right; wakeUp(); }
 	bool LogOut(){ return _gameStatus == GAME_STATUS_LOG_OUTED; }
 	bool idle(){ return _queueFlags == QUEUE_FLAGS_NULL; }
 	bool inTheGame(){ return (_gameStatus & 0x0f) > GAME_STATUS_DEALED_CARD && (_gameStatus & 0x0f) < GAME_STATUS_ROUNDOVERED; }
 	bool started(){ return _playerInfo.start == 1; }
-	void setStart(){ _gameStatus = GAME_STATUS_STARTING; _playerInfo.start = 1; }
-	void dealCards(uint8 * cards, uint8 * baseCards);
+	void setStart();
+	void dealCards(uint8 const* cards);
 	bool roundOver(){ return _gameStatus == GAME_STATUS_ROUNDOVERED; };
 	void setRoomId(uint32 roomid){ _roomid = roomid; }
 	uint32 getRoomId(){ return _roomid; }
@@ -144,35 +184,63 @@ public:
 	PlayerType getPlayerType(){ return _playerType; }
 	PlayerInfo * getPlayerInfo(){ return &_playerInfo; };
 	AtQueueFlags getQueueFlags(){ return _queueFlags; }
-	void setQueueFlags(AtQueueFlags flags){ _queueFlags = flags; }
+	void setQueueFlags(AtQueueFlags flags);
 	GameStatus getGameStatus(){ return _gameStatus; }
-	void setGameStatus(GameStatus status){ _gameStatus = status; }
+	void setGameStatus(GameStatus status);
+	static char const* getStateName(GameStatus status);
 	int32 getGrabLandlordScore(){ return _grabLandlordScore; }
 	int32 getLandlordId();
-	void setLandlordId(uint32 id){ _landlordPlayerId = id; }
+	/// desk of the round, the player mirrors its status and flags in the table of the room
+	Desk* getDesk(){ return _desk; }
+	void setDesk(Desk* desk, uint8 seat);
 	uint32 aiGrabLandlord();
 	uint32 calcDoubleScore();
 	void resetGame();
 	void beginOutCard();
 
 private:
+	static PlayerStateHandler const _stateHandlers[PLAYER_STATE_COUNT];
+	void updateGrab();
+	void updateOutCard();
+
+	void restartExpiration();
+	void onExpiration(){ _expired = true; wakeUp(); }
+	/// true once the ai thought for aiDelay, the delay starts with the first call of a turn
+	bool aiThinkDone();
+	void onAiDelay(){ _aiThought = true; wakeUp(); }
+	void onTurnTimeout(){ _turnExpired = true; wakeUp(); }
+
 	WorldSession* _session;
-	int32 _expiration;
-	int32 _aiDelay;
-	uint8 _cards[CARD_NUMBER];
-	uint8 _baseCards[BASIC_CARD];
+	bool _awake;
+	bool _updating;
+	std::chrono::steady_clock::time_point _wokenAt;
+	std::chrono::steady_clock::time_point _eventTime;  /// event behind the next transition of Update
+	TimingWheel* _timers;
+	MemberTimer<Player> _expirationTimer;       /// waiting for players to fill the desk
+	MemberTimer<Player> _aiDelayTimer;
+	MemberTimer<Player> _turnTimer;             /// time left to the client for its move
+	bool _expired;
+	bool _aiThought;
+	bool _turnExpired;
+	bool _autoPlay;
+	uint8 _cards[HAND_CARD_NUMBER];
+	Desk* _desk;
+	uint8 _seat;
 	uint32 _roomid;
+	Room* _room;
 	Player *_left, *_right;
 	AtQueueFlags _queueFlags;
 	PlayerType _playerType;
 	GameStatus _gameStatus;
 	bool _start;
-	uint32 _defaultGrabLandlordPlayerId;
 	int32 _grabLandlordScore;
-	int32 _landlordPlayerId;
 	CardType _cardType;
 	uint8  _outCards[24];
 	int32 _winGold;
+	bool _roundWon;
+	uint32 _playCount;                 /// plays other than pass in this round
+	uint64 _resumeToken;               /// given at login, proves a reconnecting client owns the player
+	bool _disconnected;
 private:
 	///// player data
 	PlayerInfo _playerInfo;
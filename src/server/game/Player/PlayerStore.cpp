@@ -0,0 +1,347 @@
+#include "PlayerStore.h"
+
+#include "Config.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "Player.h"
+
+#if PLATFORM == PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define PLAYER_STORE_LOG_MAGIC       0x474F4C50   /// "PLOG"
+#define PLAYER_STORE_SNAPSHOT_MAGIC  0x50414E53   /// "SNAP"
+
+/// one record as written in both files, the checksum covers the magic and the record
+struct PlayerStoreEntry
+{
+	uint32 magic;
+	PlayerRecord record;
+	uint32 checksum;
+};
+
+static uint32 EntryChecksum(PlayerStoreEntry const& entry)
+{
+	/// FNV-1a
+	uint8 const* data = reinterpret_cast<uint8 const*>(&entry);
+	uint32 hash = 2166136261U;
+	for (size_t i = 0; i < offsetof(PlayerStoreEntry, checksum); ++i)
+		hash = (hash ^ data[i]) * 16777619U;
+	return hash;
+}
+
+static void FillEntry(PlayerStoreEntry& entry, uint32 magic, PlayerRecord const& record)
+{
+	memset(&entry, 0, sizeof(entry));
+	entry.magic = magic;
+	entry.record = record;
+	entry.checksum = EntryChecksum(entry);
+}
+
+static void SyncFile(FILE* file)
+{
+	fflush(file);
+#if PLATFORM == PLATFORM_WINDOWS
+	_commit(_fileno(file));
+#else
+	fsync(fileno(file));
+#endif
+}
+
+static uint32 ElapsedUs(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point now)
+{
+	return uint32(std::chrono::duration_cast<std::chrono::microseconds>(now - since).count());
+}
+
+PlayerStore::PlayerStore() : _flushInterval(0), _batchSize(0), _snapshotRecords(0), _sync(true),
+	_log(nullptr), _logRecords(0), _running(false)
+{
+	_recordsCounter = sMetrics->GetCounter("landlord_store_records_total");
+	_batchesCounter = sMetrics->GetCounter("landlord_store_batches_total");
+	_errorsCounter = sMetrics->GetCounter("landlord_store_errors_total");
+	_pendingGauge = sMetrics->GetGauge("landlord_store_pending");
+	_playersGauge = sMetrics->GetGauge("landlord_store_players");
+	sMetrics->RegisterHistogram("landlord_store_batch_seconds", "", &_batchTime);
+	sMetrics->RegisterHistogram("landlord_store_commit_seconds", "", &_commitTime);
+}
+
+PlayerStore::~PlayerStore()
+{
+	Close();
+}
+
+bool PlayerStore::Open()
+{
+	if (_running || !sConfigMgr->GetBoolDefault("PlayerStore.Enable", true))
+		return false;
+
+	std::string path = sConfigMgr->GetStringDefault("PlayerStore.Path", "");
+	if (!path.empty() && path[path.length() - 1] != '/' && path[path.length() - 1] != '\\')
+		path.push_back('/');
+
+	_logFile = path + "players.log";
+	_snapshotFile = path + "players.snapshot";
+	_flushInterval = sConfigMgr->GetIntDefault("PlayerStore.FlushInterval", 100);
+	_batchSize = std::max(sConfigMgr->GetIntDefault("PlayerStore.BatchSize", 512), 1);
+	_snapshotRecords = sConfigMgr->GetIntDefault("PlayerStore.SnapshotRecords", 100000);
+	_sync = sConfigMgr->GetBoolDefault("PlayerStore.Sync", true);
+
+	PlayerRecordMap players;
+	uint32 loaded = ReadFile(_snapshotFile, players, true);
+	uint32 replayed = ReadFile(_logFile, players, false);
+
+	/// start over from a fresh snapshot, so a torn record left in the log is never followed by good ones
+	if (!WriteSnapshot(players))
+	{
+		TC_LOG_ERROR("server.store", "PlayerStore: can't write %s, player progress will not be saved", _snapshotFile.c_str());
+		return false;
+	}
+
+	_log = fopen(_logFile.c_str(), "wb");
+	if (!_log)
+	{
+		TC_LOG_ERROR("server.store", "PlayerStore: can't open %s, player progress will not be saved", _logFile.c_str());
+		return false;
+	}
+
+	_players.swap(players);
+	_logRecords = 0;
+	_playersGauge->Set(_players.size());
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_handOff = nullptr;
+		_running = true;
+	}
+	_writer = std::thread(&PlayerStore::WriterThread, this);
+
+	TC_LOG_INFO("server.loading", "Loaded %u player records from %s, replayed %u from %s", loaded, _snapshotFile.c_str(), replayed, _logFile.c_str());
+	return true;
+}
+
+void PlayerStore::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		if (!_running)
+			return;
+
+		_running = false;
+	}
+
+	_wakeUp.notify_all();
+	if (_writer.joinable())
+		_writer.join();
+
+	if (_log)
+	{
+		SyncFile(_log);
+		fclose(_log);
+		_log = nullptr;
+	}
+}
+
+bool PlayerStore::Load(uint32 id, PlayerRecord& record)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	PlayerRecordMap::const_iterator itr = _players.find(id);
+	if (itr == _players.end())
+		return false;
+
+	record = itr->second;
+	return true;
+}
+
+void PlayerStore::Save(PlayerInfo const& info)
+{
+	PlayerRecord record;
+	record.id = info.id;
+	record.gold = info.gold;
+	record.level = info.level;
+	record.score = info.score;
+	record.all_Chess = info.all_Chess;
+	record.win_chess = info.win_chess;
+	record.win_Rate = info.win_Rate;
+	record.offline_count = info.offline_count;
+	SaveRecord(record);
+}
+
+void PlayerStore::SaveRecord(PlayerRecord const& record)
+{
+	PendingRecord pending;
+	pending.record = record;
+	pending.queued = std::chrono::steady_clock::now();
+
+	bool wakeUp = false;
+	std::function<void(PlayerRecord const&)> handOff;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		if (!_running)
+			handOff = _handOff;
+		else
+		{
+			_players[record.id] = record;
+			_pending.push_back(pending);
+			wakeUp = _pending.size() >= _batchSize;
+
+			_pendingGauge->Set(_pending.size());
+			_playersGauge->Set(_players.size());
+		}
+	}
+
+	if (handOff)
+		handOff(record);
+	else if (wakeUp)
+		_wakeUp.notify_one();
+}
+
+void PlayerStore::HandOff(std::function<void(PlayerRecord const&)> sink)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock(_lock);
+	_handOff = sink;
+}
+
+void PlayerStore::ApplyRecord(PlayerRecord const& record, PlayerInfo& info)
+{
+	info.gold = record.gold;
+	info.level = record.level;
+	info.score = record.score;
+	info.all_Chess = record.all_Chess;
+	info.win_chess = record.win_chess;
+	info.win_Rate = record.win_Rate;
+	info.offline_count = record.offline_count;
+}
+
+void PlayerStore::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	while (true)
+	{
+		_wakeUp.wait_for(lock, std::chrono::milliseconds(_flushInterval), [this]() { return !_running || _pending.size() >= _batchSize; });
+
+		bool stopping = !_running;
+
+		std::vector<PendingRecord> batch;
+		batch.swap(_pending);
+		_pendingGauge->Set(0);
+
+		/// _players already holds the batch, later saves go to the new log
+		PlayerRecordMap players;
+		bool compact = _snapshotRecords && _logRecords + batch.size() >= _snapshotRecords;
+		if (compact)
+			players = _players;
+
+		lock.unlock();
+
+		if (!batch.empty())
+			WriteBatch(batch);
+
+		if (compact && WriteSnapshot(players))
+		{
+			if (FILE* log = fopen(_logFile.c_str(), "wb"))
+			{
+				fclose(_log);
+				_log = log;
+				_logRecords = 0;
+			}
+		}
+
+		lock.lock();
+
+		if (stopping && _pending.empty())
+			break;
+	}
+}
+
+void PlayerStore::WriteBatch(std::vector<PendingRecord>& batch)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<PlayerStoreEntry> entries(batch.size());
+	for (size_t i = 0; i < batch.size(); ++i)
+		FillEntry(entries[i], PLAYER_STORE_LOG_MAGIC, batch[i].record);
+
+	size_t written = fwrite(entries.data(), sizeof(PlayerStoreEntry), entries.size(), _log);
+	if (_sync)
+		SyncFile(_log);
+	else
+		fflush(_log);
+
+	if (written != entries.size())
+	{
+		_errorsCounter->Add();
+		TC_LOG_ERROR("server.store", "PlayerStore: wrote %u of %u records to %s", uint32(written), uint32(entries.size()), _logFile.c_str());
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	_batchTime.Record(ElapsedUs(start, now));
+	for (PendingRecord const& pending : batch)
+		_commitTime.Record(ElapsedUs(pending.queued, now));
+
+	_logRecords += written;
+	_recordsCounter->Add(written);
+	_batchesCounter->Add();
+}
+
+bool PlayerStore::WriteSnapshot(PlayerRecordMap const& players)
+{
+	/// written aside and renamed, a crash never leaves a partial snapshot in place
+	std::string tmpFile = _snapshotFile + ".tmp";
+	FILE* file = fopen(tmpFile.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool ok = true;
+	PlayerStoreEntry entry;
+	for (PlayerRecordMap::const_iterator itr = players.begin(); itr != players.end() && ok; ++itr)
+	{
+		FillEntry(entry, PLAYER_STORE_SNAPSHOT_MAGIC, itr->second);
+		ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+	}
+
+	SyncFile(file);
+	fclose(file);
+
+#if PLATFORM == PLATFORM_WINDOWS
+	remove(_snapshotFile.c_str());
+#endif
+	if (!ok || rename(tmpFile.c_str(), _snapshotFile.c_str()) != 0)
+	{
+		_errorsCounter->Add();
+		remove(tmpFile.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+uint32 PlayerStore::ReadFile(std::string const& fileName, PlayerRecordMap& players, bool snapshot)
+{
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (!file)
+		return 0;
+
+	uint32 magic = snapshot ? PLAYER_STORE_SNAPSHOT_MAGIC : PLAYER_STORE_LOG_MAGIC;
+	uint32 count = 0;
+
+	PlayerStoreEntry entry;
+	while (fread(&entry, sizeof(entry), 1, file) == 1)
+	{
+		if (entry.magic != magic || entry.checksum != EntryChecksum(entry))
+		{
+			TC_LOG_WARN("server.store", "PlayerStore: dropping the end of %s after %u records, the record is damaged", fileName.c_str(), count);
+			break;
+		}
+
+		players[entry.record.id] = entry.record;
+		++count;
+	}
+
+	fclose(file);
+	return count;
+}
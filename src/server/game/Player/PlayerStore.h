@@ -0,0 +1,108 @@
+#ifndef _PLAYER_STORE_H
+#define _PLAYER_STORE_H
+
+#include "TimingHistogram.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class MetricCounter;
+class MetricGauge;
+struct PlayerInfo;
+
+/// Progress of a player kept by the server, everything else still comes from the client
+struct PlayerRecord
+{
+	uint32 id;
+	uint32 gold;
+	uint32 level;
+	uint32 score;
+	uint32 all_Chess;
+	uint32 win_chess;
+	uint32 win_Rate;
+	uint32 offline_count;
+};
+
+/// Local player persistence: an append-only log of player records compacted into a snapshot file.
+/// Saves are queued and written by a background thread in batches, one sync per batch.
+/// On startup the snapshot is loaded and the log replayed over it, a torn record at the end of
+/// the log (crash in the middle of a write) is detected by its checksum and dropped.
+class PlayerStore
+{
+public:
+	static PlayerStore* instance()
+	{
+		static PlayerStore instance;
+		return &instance;
+	}
+
+	/// loads the snapshot, replays the log and starts the writer
+	bool Open();
+	/// writes what is queued and stops the writer
+	void Close();
+	bool IsOpen() const { return _running; }
+
+	/// last saved progress of a player, false for a player never seen
+	bool Load(uint32 id, PlayerRecord& record);
+	/// queues the progress of a player for the next batch
+	void Save(PlayerInfo const& info);
+	void SaveRecord(PlayerRecord const& record);
+
+	/// closes the store for a server handing over to its successor, the one writing the files
+	/// from now on: the progress saved afterwards goes to sink instead
+	void HandOff(std::function<void(PlayerRecord const&)> sink);
+
+	static void ApplyRecord(PlayerRecord const& record, PlayerInfo& info);
+
+private:
+	PlayerStore();
+	~PlayerStore();
+
+	struct PendingRecord
+	{
+		PlayerRecord record;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	typedef std::unordered_map<uint32, PlayerRecord> PlayerRecordMap;
+
+	void WriterThread();
+	void WriteBatch(std::vector<PendingRecord>& batch);
+	bool WriteSnapshot(PlayerRecordMap const& players);
+	uint32 ReadFile(std::string const& fileName, PlayerRecordMap& players, bool snapshot);
+
+	std::string _logFile;
+	std::string _snapshotFile;
+	uint32 _flushInterval;
+	uint32 _batchSize;
+	uint32 _snapshotRecords;
+	bool _sync;
+
+	PlayerRecordMap _players;
+	std::vector<PendingRecord> _pending;
+	std::mutex _lock;
+	std::condition_variable _wakeUp;
+
+	FILE* _log;
+	uint32 _logRecords;
+	bool _running;
+	std::thread _writer;
+	std::function<void(PlayerRecord const&)> _handOff;
+
+	MetricCounter* _recordsCounter;
+	MetricCounter* _batchesCounter;
+	MetricCounter* _errorsCounter;
+	MetricGauge* _pendingGauge;
+	MetricGauge* _playersGauge;
+	TimingHistogram _batchTime;          /// write and sync of one batch
+	TimingHistogram _commitTime;         /// from Save() to the record being on disk
+};
+
+#define sPlayerStore PlayerStore::instance()
+
+#endif
@@ -0,0 +1,159 @@
+#include "Desk.h"
+
+#include "Opcodes.h"
+#include "SpectatorMgr.h"
+#include "Util.h"
+#include "WorldPacket.h"
+
+Desk::Desk(DeskTable* table, uint32 index, Player* p0, Player* p1, Player* p2) : _table(table), _index(index),
+	_defaultGrabId(0), _landlordId(-1), _lastPlayId(0), _lastPlayType(CARD_TYPE_PASS), _bombCount(0)
+{
+	_seats[0] = p0;
+	_seats[1] = p1;
+	_seats[2] = p2;
+
+	for (int i = 0; i < BASIC_CARD; ++i)
+		_baseCards[i] = CARD_TERMINATE;
+	memset(_lastPlayCards, CARD_TERMINATE, sizeof(_lastPlayCards));
+
+	_channel = sSpectatorMgr->OpenChannel(this);
+}
+
+Desk::~Desk()
+{
+	if (_channel)
+		sSpectatorMgr->CloseChannel(_channel);
+}
+
+GameVariant const* Desk::getVariant() const
+{
+	return _table->_variant;
+}
+
+void Desk::deal(uint8 const* deck)
+{
+	memcpy(_baseCards, deck + DESK_SEATS * CARD_NUMBER, 3);
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		_seats[seat]->dealCards(deck + seat * CARD_NUMBER);
+
+	/// the deal of a seat with the hand hidden, the base cards are shown to every seat
+	if (_channel)
+	{
+		uint8 hidden[CARD_NUMBER];
+		memset(hidden, CARD_HIDDEN, CARD_NUMBER);
+
+		WorldPacket data(SMSG_CARD_DEAL, 36);
+		data.resize(8);
+		data << getDefaultGrabId();
+		data.append(hidden, CARD_NUMBER);
+		data.append(_baseCards, BASIC_CARD);
+		_channel->Publish(data);
+	}
+}
+
+uint32 Desk::getDefaultGrabId()
+{
+	if (_defaultGrabId == 0)
+		_defaultGrabId = _seats[urand(0, DESK_SEATS - 1)]->getid();
+	return _defaultGrabId;
+}
+
+void Desk::setLastPlay(uint32 id, CardType type, uint8 const* cards)
+{
+	if (type == CARD_TYPE_PASS)
+		return;
+
+	_lastPlayId = id;
+	_lastPlayType = type;
+	memcpy(_lastPlayCards, cards, sizeof(_lastPlayCards));
+	if (type == CARD_TYPE_BOMB || type == CARD_TYPE_ROCKET)
+		++_bombCount;
+}
+
+void Desk::broadcast(WorldPacket const& packet)
+{
+	if (_channel)
+		_channel->Publish(packet);
+}
+
+void Desk::setSeatStatus(uint8 seat, GameStatus status)
+{
+	uint32& row = _table->_seatStatus[_index];
+	row = (row & ~(0xFFu << (seat * 8))) | (uint32(status) << (seat * 8));
+}
+
+void Desk::setSeatFlag(uint8 seat, DeskSeatFlags flag, bool on)
+{
+	uint8& row = _table->_seatFlags[_index];
+	if (on)
+		row |= DESK_SEAT_FLAG(seat, flag);
+	else
+		row &= ~DESK_SEAT_FLAG(seat, flag);
+}
+
+DeskTable::~DeskTable()
+{
+	/// the room goes away with its players, nobody is left to detach
+	for (Desk* desk : _desks)
+		delete desk;
+}
+
+Desk* DeskTable::Create(Player* p0, Player* p1, Player* p2)
+{
+	Desk* desk = new Desk(this, _desks.size(), p0, p1, p2);
+	_desks.push_back(desk);
+	_seatStatus.push_back(0);
+	_seatFlags.push_back(0);
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		desk->_seats[seat]->setDesk(desk, seat);
+	return desk;
+}
+
+void DeskTable::Remove(uint32 index)
+{
+	Desk* desk = _desks[index];
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		if (desk->_seats[seat] && desk->_seats[seat]->getDesk() == desk)
+			desk->_seats[seat]->setDesk(nullptr, 0);
+
+	uint32 last = _desks.size() - 1;
+	if (index != last)
+	{
+		_desks[index] = _desks[last];
+		_desks[index]->_index = index;
+		_seatStatus[index] = _seatStatus[last];
+		_seatFlags[index] = _seatFlags[last];
+	}
+
+	_desks.pop_back();
+	_seatStatus.pop_back();
+	_seatFlags.pop_back();
+	delete desk;
+}
+
+GameStatus DeskTable::GetLowestStatus(uint32 index) const
+{
+	uint32 row = _seatStatus[index];
+	return GameStatus(std::min(std::min(row & 0x0f, (row >> 8) & 0x0f), (row >> 16) & 0x0f));
+}
+
+bool DeskTable::AllSeats(uint32 index, GameStatus status) const
+{
+	return _seatStatus[index] == (uint32(status) * 0x010101);
+}
+
+bool DeskTable::AllSeatsBelow(uint32 index, GameStatus status) const
+{
+	uint32 row = _seatStatus[index];
+	return (row & 0xFF) < status && ((row >> 8) & 0xFF) < status && ((row >> 16) & 0xFF) < status;
+}
+
+bool DeskTable::AnySeatLoggedOut(uint32 index) const
+{
+	uint32 row = _seatStatus[index];
+	return (row & 0xFF) == GAME_STATUS_LOG_OUTED || ((row >> 8) & 0xFF) == GAME_STATUS_LOG_OUTED
+		|| ((row >> 16) & 0xFF) == GAME_STATUS_LOG_OUTED;
+}
@@ -0,0 +1,117 @@
+#ifndef _DESK_H
+#define _DESK_H
+
+#include "Player.h"
+
+#include <memory>
+#include <vector>
+
+class DeskTable;
+class GameVariant;
+class SpectatorChannel;
+class WorldPacket;
+
+#define DESK_SEATS 3
+
+/// flags of a seat kept in the desk table, two bits a seat
+enum DeskSeatFlags
+{
+	DESK_SEAT_STARTED  = 0x01,         /// the client asked for a game
+	DESK_SEAT_AT_THREE = 0x02          /// the player knows the other two seats
+};
+
+#define DESK_SEAT_FLAG(seat, flag)  ((flag) << ((seat) * 2))
+#define DESK_ALL_SEATS(flag)        (DESK_SEAT_FLAG(0, flag) | DESK_SEAT_FLAG(1, flag) | DESK_SEAT_FLAG(2, flag))
+
+/// State of a game shared by the three seats of a desk: who grabs first, who is the landlord,
+/// the base cards, the last play and the bombs of the round.
+/// The seats mirror their status and flags in the table of the room, so the room checks its desks
+/// without touching the players.
+class Desk
+{
+	friend class DeskTable;
+public:
+	uint32 getIndex() const { return _index; }
+	/// rules of the room the desk is in
+	GameVariant const* getVariant() const;
+	/// nullptr once the player of the seat left for another game
+	Player* getSeat(uint8 seat) const { return _seats[seat]; }
+	void leave(uint8 seat) { _seats[seat] = nullptr; }
+
+	/// deals a shuffled deck: 17 cards a seat, the last 3 are the base cards
+	void deal(uint8 const* deck);
+	uint8 const* getBaseCards() const { return _baseCards; }
+
+	/// seat grabbing the landlord first, picked at random on the first call of a deal
+	uint32 getDefaultGrabId();
+	void resetGrab() { _defaultGrabId = 0; _landlordId = -1; }
+	int32 getLandlordId() const { return _landlordId; }
+	void setLandlordId(int32 id) { _landlordId = id; }
+
+	/// the cards other than pass played last, a player leads when nobody beat them
+	void setLastPlay(uint32 id, CardType type, uint8 const* cards);
+	uint8 const* getLastPlay() const { return _lastPlayCards; }
+	bool leads(uint32 id) const { return _lastPlayId == 0 ? int32(id) == _landlordId : _lastPlayId == id; }
+	uint32 getBombCount() const { return _bombCount; }
+
+	void setSeatStatus(uint8 seat, GameStatus status);
+	void setSeatFlag(uint8 seat, DeskSeatFlags flag, bool on);
+
+	/// event the seats are sent, the spectators get it after the delay. Once a desk event, not per seat.
+	void broadcast(WorldPacket const& packet);
+
+private:
+	Desk(DeskTable* table, uint32 index, Player* p0, Player* p1, Player* p2);
+	~Desk();
+
+	DeskTable* _table;
+	uint32 _index;                     /// row in the table, changes when another desk is removed
+	Player* _seats[DESK_SEATS];
+	uint32 _defaultGrabId;
+	int32 _landlordId;
+	uint8 _baseCards[BASIC_CARD];
+	uint32 _lastPlayId;
+	CardType _lastPlayType;
+	uint8 _lastPlayCards[24];
+	uint32 _bombCount;
+	std::shared_ptr<SpectatorChannel> _channel;    /// nullptr when spectating is off
+};
+
+/// Desks of a room. What the room reads of every desk each tick is kept in arrays indexed by
+/// desk, a status byte and two flag bits a seat, the rest stays in the Desk.
+class DeskTable
+{
+	friend class Desk;
+public:
+	explicit DeskTable(GameVariant const* variant) : _variant(variant) { }
+	~DeskTable();
+
+	/// seats the players, they mirror their state in the table from now on
+	Desk* Create(Player* p0, Player* p1, Player* p2);
+	/// detaches the seats still at the desk and deletes it, the last desk takes its row
+	void Remove(uint32 index);
+
+	uint32 Size() const { return _desks.size(); }
+	Desk* Get(uint32 index) const { return _desks[index]; }
+
+	GameStatus GetSeatStatus(uint32 index, uint8 seat) const { return GameStatus(uint8(_seatStatus[index] >> (seat * 8))); }
+	/// lowest status of the seats, game statuses only
+	GameStatus GetLowestStatus(uint32 index) const;
+	/// every seat in status
+	bool AllSeats(uint32 index, GameStatus status) const;
+	/// every seat below status, a seat logging out is not
+	bool AllSeatsBelow(uint32 index, GameStatus status) const;
+	bool AllSeatFlags(uint32 index, DeskSeatFlags flag) const { return (_seatFlags[index] & DESK_ALL_SEATS(flag)) == DESK_ALL_SEATS(flag); }
+	bool AnySeatLoggedOut(uint32 index) const;
+
+private:
+	DeskTable(DeskTable const&);
+	DeskTable& operator=(DeskTable const&);
+
+	GameVariant const* _variant;
+	std::vector<Desk*> _desks;
+	std::vector<uint32> _seatStatus;   /// a GameStatus byte a seat
+	std::vector<uint8> _seatFlags;     /// DeskSeatFlags of the seats
+};
+
+#endif
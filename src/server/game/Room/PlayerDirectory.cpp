@@ -0,0 +1,35 @@
+#include "PlayerDirectory.h"
+
+Player* PlayerDirectory::Find(uint32 id) const
+{
+	Shard const& shard = _shards[GetShardIndex(id)];
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	PlayerMapType::const_iterator itr = shard.players.find(id);
+	return itr != shard.players.end() ? itr->second : nullptr;
+}
+
+void PlayerDirectory::Insert(uint32 id, Player* player)
+{
+	Shard& shard = _shards[GetShardIndex(id)];
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	if (shard.players.insert(std::make_pair(id, player)).second)
+		++_count;
+	else
+		shard.players[id] = player;
+}
+
+bool PlayerDirectory::Remove(uint32 id, Player* player)
+{
+	Shard& shard = _shards[GetShardIndex(id)];
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	PlayerMapType::iterator itr = shard.players.find(id);
+	if (itr == shard.players.end() || itr->second != player)
+		return false;
+
+	shard.players.erase(itr);
+	--_count;
+	return true;
+}
@@ -0,0 +1,78 @@
+#ifndef _PLAYER_DIRECTORY_H
+#define _PLAYER_DIRECTORY_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+class Player;
+
+#define PLAYER_DIRECTORY_SHARDS  64
+
+/// Logged in players by account id, for lookups that must not scan every room.
+/// The map is split in shards with a lock each, the room update threads removing players
+/// and the sessions looking them up only meet when they hit the same shard.
+/// Players are deleted by room updates, which never run together with the world thread
+/// (sessions, console), so a player found from the world thread stays valid until the next
+/// room update and no deferred reclamation is needed.
+class PlayerDirectory
+{
+public:
+	PlayerDirectory() : _count(0) { }
+
+	Player* Find(uint32 id) const;
+	/// replaces a player left by an earlier login of the account
+	void Insert(uint32 id, Player* player);
+	/// removes the entry only if it still points to this player
+	bool Remove(uint32 id, Player* player);
+
+	uint32 Count() const { return _count; }
+
+	/// calls f(id, player) for every player, locking one shard at a time
+	template<class F>
+	void ForEach(F f) const
+	{
+		for (uint32 i = 0; i < PLAYER_DIRECTORY_SHARDS; ++i)
+		{
+			std::lock_guard<std::mutex> lock(_shards[i].lock);
+			for (PlayerMapType::const_iterator itr = _shards[i].players.begin(); itr != _shards[i].players.end(); ++itr)
+				f(itr->first, itr->second);
+		}
+	}
+
+	/// calls f(player) with its shard locked, false when the account has no player. A player leaves
+	/// the directory first thing when deleted, so it stays valid for the call from any thread.
+	template<class F>
+	bool Visit(uint32 id, F f) const
+	{
+		Shard const& shard = _shards[GetShardIndex(id)];
+		std::lock_guard<std::mutex> lock(shard.lock);
+
+		PlayerMapType::const_iterator itr = shard.players.find(id);
+		if (itr == shard.players.end())
+			return false;
+
+		f(itr->second);
+		return true;
+	}
+
+private:
+	typedef std::unordered_map<uint32, Player*> PlayerMapType;
+
+	/// a cache line each, so two threads on neighbouring shards don't share one
+	struct alignas(64) Shard
+	{
+		mutable std::mutex lock;
+		PlayerMapType players;
+	};
+
+	/// account ids are mostly sequential, the multiply spreads them over the shards
+	static uint32 GetShardIndex(uint32 id) { return ((id * 2654435761U) >> 16) & (PLAYER_DIRECTORY_SHARDS - 1); }
+
+	Shard _shards[PLAYER_DIRECTORY_SHARDS];
+	std::atomic<uint32> _count;
+};
+
+#endif
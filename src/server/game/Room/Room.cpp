@@ -1,64 +1,224 @@
 #include "Room.h"
 
 #include "AiPlayerPool.h"
+#include "GameVariant.h"
+#include "Metrics.h"
 #include "Player.h"
+#include "TickProfiler.h"
+#include "Tournament.h"
+#include "Util.h"
+#include "World.h"
 #include <utility>
 
 #define  RELEASE(player)     if(player->getPlayerType() == PLAYER_TYPE_AI)\
-	                          sAiPlayerPool->releasePlayer(player);\
+	                          releaseAi(player);\
 	                           else \
                              delete player;
 #define OUT_TWO(player)      if(player->getPlayerType() == PLAYER_TYPE_AI)\
-	                           sAiPlayerPool->releasePlayer(player); \
+	                           releaseAi(player); \
 							   else\
 							   _OnePlayerList.push_back(player);
 
-Room::Room(uint32 id, uint32 basic_score) :_id(id), _basic_score(basic_score)
+Room::Room(RoomConfig const& config) : _id(config.id), _config(config), _variant(config.variant), _draining(false), _matching(true),
+	_handToAi(false), _desks(_variant),
+	_shuffler(sWorld->getIntConfig(CONFIG_DEAL_SEED) + _id),
+	_dealBatchNext(0), _dealCount(0), _playerCount(0), _deskCount(0), _matchQueueSize(0), _tournamentGauge(nullptr)
 {
+	sTickProfiler->RegisterRoom(_id, &_updateTime);
 
+	/// with a configured seed every deal of the room can be rebuilt by ReplayDeal. Without one the
+	/// shuffler is seeded from the OS, a hand known to a client does not give the deals to come away.
+	if (sWorld->getIntConfig(CONFIG_DEAL_SEED))
+		TC_LOG_INFO("server.deal", "Room %u deals %s with seed %u", _id, _variant->GetName(), _shuffler.GetSeed());
+	else
+	{
+		_shuffler.SeedSecure();
+		TC_LOG_DEBUG("server.deal", "Room %u deals %s from a random seed", _id, _variant->GetName());
+	}
+
+	std::ostringstream roomLabel;
+	roomLabel << "room=\"" << _id << "\"";
+
+	_playersGauge = sMetrics->GetGauge("landlord_room_players", roomLabel.str());
+	_matchQueueGauge = sMetrics->GetGauge("landlord_room_match_queue", roomLabel.str());
+	for (uint32 i = 0; i < MAX_DESK_STATES; ++i)
+		_desksGauge[i] = sMetrics->GetGauge("landlord_room_desks", roomLabel.str() + ",state=\"" + GetDeskStateName(DeskState(i)) + "\"");
+
+	if (_config.tournamentInterval)
+	{
+		_tournament.reset(new Tournament(this));
+		_tournamentGauge = sMetrics->GetGauge("landlord_room_tournament_players", roomLabel.str());
+	}
+}
+
+void Room::SetConfig(RoomConfig const& config)
+{
+	if (config.variant != _variant)
+		TC_LOG_ERROR("server.loading", "Room %u: the game variant can't be changed at reload, the room keeps playing %s", _id, _variant->GetName());
+
+	/// a room keeps its kind, the players of a tournament room are never in the match queue
+	bool tournament = config.tournamentInterval != 0;
+	if (tournament != bool(_tournament))
+		TC_LOG_ERROR("server.loading", "Room %u: a room can't turn into a tournament room or back at reload, it stays a %s room", _id,
+			_tournament ? "tournament" : "cash");
+
+	uint32 tournamentInterval = _config.tournamentInterval;
+	_config = config;
+	_config.variant = _variant;
+	if (tournament != bool(_tournament))
+		_config.tournamentInterval = tournamentInterval;
 }
 
 Room::~Room()
 {
+	RoomTask task;
+	while (_tasks.next(task))
+		task(nullptr);
+
+	sTickProfiler->UnregisterRoom(_id);
 	_playerMap.clear();
 	_OnePlayerList.clear();
 	_twoPlayerList.clear();
-	_threePlayerList.clear();
 }
 
 void Room::Update(const uint32 diff)
 {
+	WatchdogTick watchdogTick("Room::Update", _id);
+	ScopedTickTimer roomTimer(sTickProfiler->IsEnabled() ? &_updateTime : nullptr);
+	PROFILE_TICK_PHASE(TICK_PHASE_ROOM);
+	WorldConfigScope configScope;
+
+	_events.Update(diff);
+	if (_handToAi)
+		PlayDesksByAi();
+	UpdatePlayers(diff);
+	if (_tournament)
+		_tournament->Update();
+	else
+	{
+		UpdateOne(diff);
+		UpdateTwo(diff);
+	}
+	UpdateThree(diff);
+	UpdateMetrics();
+	RunTasks();
+}
+
+void Room::RunTasks()
+{
+	RoomTask task;
+	while (_tasks.next(task))
+		task(this);
+}
+
+Player* Room::FindPlayer(uint32 id) const
+{
+	PlayerMapType::const_iterator itr = _playerMap.find(id);
+	return itr != _playerMap.end() ? itr->second : nullptr;
+}
+
+void Room::UpdateMetrics()
+{
+	uint32 desks[MAX_DESK_STATES] = { 0 };
+	desks[DESK_STATE_WAITING] = _twoPlayerList.size();
+
+	for (uint32 desk = 0; desk < _desks.Size(); ++desk)
+		++desks[GetDeskState(desk)];
+
+	for (uint32 i = 0; i < MAX_DESK_STATES; ++i)
+		_desksGauge[i]->Set(desks[i]);
+
+	_playerCount = _playerMap.size();
+	_deskCount = _desks.Size();
+	_matchQueueSize = _OnePlayerList.size();
+	_playersGauge->Set(_playerCount);
+	_matchQueueGauge->Set(_matchQueueSize);
+	if (_tournament)
+		_tournamentGauge->Set(_tournament->GetPlayerCount());
+}
+
+DeskState Room::GetDeskState(uint32 desk) const
+{
+	/// all seats move through the same states, the slowest one tells where the desk is
+	GameStatus status = _desks.GetLowestStatus(desk);
+
+	if (status < GAME_STATUS_DEALED_CARD)
+		return DESK_STATE_STARTING;
+	if (status < GAME_STATUS_WAIT_OUT_CARD)
+		return DESK_STATE_GRABBING;
+	if (status < GAME_STATUS_ROUNDOVERING)
+		return DESK_STATE_PLAYING;
+	return DESK_STATE_ROUND_OVER;
+}
+
+char const* Room::GetDeskStateName(DeskState state)
+{
+	static char const* names[MAX_DESK_STATES] = { "waiting", "starting", "grabbing", "playing", "round_over" };
+	return state < MAX_DESK_STATES ? names[state] : "unknown";
+}
+
+void Room::UpdatePlayers(uint32 diff)
+{
+	PROFILE_TICK_PHASE(TICK_PHASE_ROOM_PLAYERS);
+
+	/// players only run when an event woke them, the players woken meanwhile run in the same tick
+	/// so the seats of a desk move on together
+	for (uint32 pass = 0; pass < ROOM_PLAYER_PASSES; ++pass)
+	{
+		bool updated = false;
+		for (PlayerMapType::iterator itr = _playerMap.begin(); itr != _playerMap.end(); ++itr)
+		{
+			if (!itr->second->awake())
+				continue;
+
+			sWatchdog->SetCurrentPlayer(itr->first);
+			itr->second->Update(diff);
+			updated = true;
+		}
+
+		if (!updated)
+			break;
+	}
+
 	for (PlayerMapType::iterator itr = _playerMap.begin(),next; itr != _playerMap.end(); itr = next)
 	{
 		next = itr;
 		next++;
 		Player* player = itr->second;
 
-		player->Update(diff);
-
 		if (player->LogOut())
 		{
 			if (!player->inTheGame())
 			{
 				_playerMap.erase(itr);
-				if (player->idle())
+				if (player->idle() && player->getPlayerType() != PLAYER_TYPE_AI)
 					delete player;
 			}	
 			continue;
 		}
 		if (player->getGameStatus() == GAME_STATUS_STARTED && player->getQueueFlags() == QUEUE_FLAGS_NULL)
 		{
+			/// in a tournament room the player waits for the next start
+			if (_tournament)
+			{
+				if (!_tournament->IsRegistered(itr->first) && !_tournament->IsPlaying(itr->first))
+					_tournament->Register(player);
+				continue;
+			}
+
 		   player->setQueueFlags(QUEUE_FLAGS_ONE);
 		   _OnePlayerList.push_back(player);
 		}		
 	}
-	UpdateOne(diff);
-	UpdateTwo(diff);
-	UpdateThree(diff);
 }
 
 void Room::UpdateOne(uint32 diff)
 {
+	PROFILE_TICK_PHASE(TICK_PHASE_ROOM_ONE);
+
+	if (!_matching)
+		return;
+
 	while (!_OnePlayerList.empty())
 	{
 		uint32 number = _OnePlayerList.size();
@@ -76,7 +236,7 @@ void Room::UpdateOne(uint32 diff)
 			p1->addPlayer(p2); 
 			p2->addPlayer(p0); 
 
-			_threePlayerList.push_back(std::make_pair(std::make_pair(p0, p1),p2));
+			_desks.Create(p0, p1, p2);
 		}
 		else if (number == 2)
 		{
@@ -99,9 +259,15 @@ void Room::UpdateOne(uint32 diff)
 			if (p0 == nullptr)
 				break;
 			/// add a ai player
-			if (p0->expiration())
+			if (_config.aiPolicy == ROOM_AI_FILL && p0->expiration())
 			{
-				Player * p1 = sAiPlayerPool->getAiPlayer(p0->getRoomId());
+				Player * p1 = sAiPlayerPool->getAiPlayer(_config);
+				if (!p1)
+				{
+					/// the ai pool is full, the player waits for it or for another player
+					_OnePlayerList.push_back(p0);
+					break;
+				}
 
 				p0->addPlayer(p1);
 				p1->addPlayer(p0);
@@ -129,7 +295,7 @@ Player * Room::getPlayerFromOne()
 
 	if (player->LogOut())
 	{
-		delete player;
+		RELEASE(player);
 		return nullptr;
 	}
 	return player;
@@ -137,6 +303,8 @@ Player * Room::getPlayerFromOne()
 
 void Room::UpdateTwo(uint32 diff)
 {
+	PROFILE_TICK_PHASE(TICK_PHASE_ROOM_TWO);
+
 	for (twoPlayerList::iterator itr = _twoPlayerList.begin(),next; itr != _twoPlayerList.end(); itr = next)
 	{
 		next = itr;
@@ -147,21 +315,27 @@ void Room::UpdateTwo(uint32 diff)
 			_twoPlayerList.erase(itr);
 			continue;
 		}
+		if (!_matching)
+			continue;
+
 		Player * p2 = getPlayerFromOne();
 
-		if (itr->first->expiration() || itr->second->expiration() || p2 != nullptr)
+		if (p2 != nullptr || (_config.aiPolicy == ROOM_AI_FILL && (itr->first->expiration() || itr->second->expiration())))
 		{
 			/// add ai player
 			Player * p0 = itr->first;
 			Player * p1 = itr->second;
 
 			if (p2 == nullptr)
-				p2 = sAiPlayerPool->getAiPlayer(itr->first->getRoomId());
+				p2 = sAiPlayerPool->getAiPlayer(_config);
+			/// the ai pool is full, the two players wait for it or for a third one
+			if (p2 == nullptr)
+				continue;
 
 			p0->addPlayer(p2); 
 			p1->addPlayer(p2);
 
-			_threePlayerList.push_back(std::make_pair(*itr, p2));
+			_desks.Create(p0, p1, p2);
 			_twoPlayerList.erase(itr);
 			AddPlayer(p2->getid(), p2, false);
 		}
@@ -189,182 +363,184 @@ bool Room::LogoutTwo(twoPlayer &twoP)
 
 void Room::UpdateThree(uint32 diff)
 {
-	threePlayerList::iterator itr = _threePlayerList.begin();
-	for (threePlayerList::iterator itr = _threePlayerList.begin(),next; itr != _threePlayerList.end(); itr = next)
+	PROFILE_TICK_PHASE(TICK_PHASE_ROOM_THREE);
+
+	/// the seats mirror their state in the desk table, players are only touched when a desk acts
+	for (uint32 desk = 0; desk < _desks.Size();)
 	{
-		next = itr;
-		next++;
-		if (LogoutThree(*itr))
-		{
-			_threePlayerList.erase(itr);
+		sWatchdog->SetCurrentDesk(desk);
+		if (LogoutThree(desk) || roundOver(desk))
 			continue;
-		}
-		if (allStart(*itr) && allAtThree(*itr) && allWaitDealCards(*itr))
-		{
-			dealCards(*itr);
-		}
-		if (roundOver(*itr))
+
+		/// all players started and know the desk, and the cards were not dealt yet
+		if (_desks.AllSeatFlags(desk, DESK_SEAT_STARTED) && _desks.AllSeatFlags(desk, DESK_SEAT_AT_THREE)
+			&& _desks.AllSeatsBelow(desk, GAME_STATUS_DEALING_CARD))
 		{
-			_threePlayerList.erase(itr);
+			dealCards(_desks.Get(desk));
 		}
+		++desk;
 	}
 }
 
-bool Room::LogoutThree(threePlayer &threeP)
+void Room::PlayDesksByAi()
 {
-	bool logout = true;
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
-
-	bool  logout0 = p0->LogOut();
-	bool  logout1 = p1->LogOut();
-	bool  logout2 = p2->LogOut();
-
-	uint8 logoutStatus = (logout0 ? 1 : 0) | (logout1 ? 1 << 1 : 0) | (logout2 ? 1 << 2 : 0);
-
-	switch (logoutStatus)
+	/// a client playing again takes its seat back, the next update hands it to the ai again
+	for (uint32 desk = 0; desk < _desks.Size(); ++desk)
 	{
-	case 0: logout = false; break;
-
-	case 1:_twoPlayerList.push_back(std::make_pair(p1, p2)); delete p0; break;
-
-	case 2:	_twoPlayerList.push_back(std::make_pair(p0, p2)); delete p1; break;
-
-	case 3: _OnePlayerList.push_back(p2); delete p0; delete p1; break;
-
-	case 4: _twoPlayerList.push_back(std::make_pair(p0, p1)); delete p2; break;
-
-	case 5:_OnePlayerList.push_back(p1); delete p0; delete p2; break;
-
-	case 6:_OnePlayerList.push_back(p0); delete p1; delete p2; break;
-
-	case 7:RELEASE(p0); RELEASE(p1); RELEASE(p2); break;
-
+		for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		{
+			Player* player = _desks.Get(desk)->getSeat(seat);
+			if (player && player->getPlayerType() == PLAYER_TYPE_USER)
+				player->setAutoPlay(true);
+		}
 	}
-	return logout;
 }
 
-bool Room::allStart(threePlayer &threeP)
+bool Room::LogoutThree(uint32 desk)
 {
-	bool allstart = true;
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
+	if (!_desks.AnySeatLoggedOut(desk))
+		return false;
 
-	return p0->started() && p1->started() && p2->started();
-}
+	Player* seats[DESK_SEATS];
+	bool logout[DESK_SEATS];
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		seats[seat] = _desks.Get(desk)->getSeat(seat);
+		logout[seat] = _desks.GetSeatStatus(desk, seat) == GAME_STATUS_LOG_OUTED;
+	}
 
-///synchronous player.sendThreeDesk
-bool Room::allAtThree(threePlayer &threeP)
-{
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
+	/// the seats leave the desk before the players logged out are deleted
+	Desk* removed = _desks.Get(desk);
+	_desks.Remove(desk);
 
-	return p0->getQueueFlags() == QUEUE_FLAGS_THREE 
-		&& p1->getQueueFlags() == QUEUE_FLAGS_THREE 
-		&& p2->getQueueFlags() == QUEUE_FLAGS_THREE;
-}
+	Player* stay[DESK_SEATS];
+	uint32 count = 0;
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		if (seats[seat] == nullptr)
+			continue;
 
-///To prevent repeat deal cards
-bool Room::allWaitDealCards(threePlayer &threeP)
-{
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
+		if (logout[seat])
+		{
+			RELEASE(seats[seat]);
+		}
+		else
+			stay[count++] = seats[seat];
+	}
 
-	return p0->getGameStatus() < GAME_STATUS_DEALING_CARD
-		&& p1->getGameStatus() < GAME_STATUS_DEALING_CARD
-		&& p2->getGameStatus() < GAME_STATUS_DEALING_CARD;
+	/// the tournament seats the table again, the players logged out are replaced
+	if (_tournament)
+		_tournament->OnDeskRemoved(removed, false);
+	else if (count == 2)
+		_twoPlayerList.push_back(std::make_pair(stay[0], stay[1]));
+	else if (count == 1)
+		_OnePlayerList.push_back(stay[0]);
+	return true;
 }
 
-void Room::dealCards(threePlayer &threeP)
+void Room::dealCards(Desk* desk)
 {
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
-
-	uint8 cards[54];
+	uint8 cards[DECK_CARD_NUMBER];
 	shuffleCard(cards);
 
-	p0->dealCards(cards, cards + 51);
-	p1->dealCards(cards + 17, cards + 51);
-	p2->dealCards(cards + 34, cards + 51);
+	TC_LOG_DEBUG("server.deal", "Room %u deal " UI64FMTD " (seed %u) to %u, %u, %u", _id, _dealCount, _shuffler.GetSeed(),
+		desk->getSeat(0)->getid(), desk->getSeat(1)->getid(), desk->getSeat(2)->getid());
+
+	desk->deal(cards);
 }
 
 void Room::shuffleCard(uint8* Cards)
 {
-	for (uint32 color = 0; color < 4; color++)
-	for (uint32 card = 0; card < 13; card++)
+	if (_dealBatchNext * DECK_CARD_NUMBER == _dealBatch.size())
 	{
-		*Cards++ = color << 4 | card;
+		_dealBatch.resize(DEAL_BATCH_SIZE * DECK_CARD_NUMBER);
+		_variant->Deal(_shuffler, _dealBatch.data(), DEAL_BATCH_SIZE);
+		_dealBatchNext = 0;
 	}
-	*Cards++ = 61;
-	*Cards++ = 62;
 
-	uint8 iSwapTmp;
-	Cards -= 54;
-	for (uint32 iIdx = 0; iIdx < 54; iIdx++)
-	{
-		uint32 iRandNum = rand() % 54;
-		if (iIdx != iRandNum)
-		{
-			iSwapTmp = Cards[iIdx];
-			Cards[iIdx] = Cards[iRandNum];
-			Cards[iRandNum] = iSwapTmp;
-		}
-	}
+	memcpy(Cards, &_dealBatch[_dealBatchNext++ * DECK_CARD_NUMBER], DECK_CARD_NUMBER);
+	++_dealCount;
 }
 
-bool Room::roundOver(threePlayer &threeP)
+void Room::PrepareDeals(uint32 count)
 {
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
+	uint32 left = _dealBatch.size() / DECK_CARD_NUMBER - _dealBatchNext;
+	if (left >= count)
+		return;
+
+	/// the decks left are dealt first, the sequence ReplayDeal rebuilds stays the same
+	_dealBatch.erase(_dealBatch.begin(), _dealBatch.begin() + _dealBatchNext * DECK_CARD_NUMBER);
+	_dealBatch.resize(count * DECK_CARD_NUMBER);
+	_variant->Deal(_shuffler, &_dealBatch[left * DECK_CARD_NUMBER], count - left);
+	_dealBatchNext = 0;
+}
 
-	if (p0->roundOver() && p1->roundOver() && p2->roundOver())
-	{
-		releaseAiPlayer(threeP);
-		return true;
-	}
-	return false;
+bool Room::ReplayDeal(GameVariant const* variant, uint32 seed, uint64 dealNumber, uint8* cards)
+{
+	if (dealNumber == 0)
+		return false;
+
+	/// decks are dealt one after the other from the same generator, batching does not change the sequence
+	DeckShuffler shuffler(seed);
+
+	for (uint64 i = 0; i < dealNumber; ++i)
+		variant->Deal(shuffler, cards, 1);
+	return true;
 }
 
-void Room::releaseAiPlayer(threePlayer &threeP)
+bool Room::roundOver(uint32 desk)
 {
-	Player *p0 = threeP.first.first;
-	Player *p1 = threeP.first.second;
-	Player *p2 = threeP.second;
+	if (!_desks.AllSeats(desk, GAME_STATUS_ROUNDOVERED))
+		return false;
+
+	Player* seats[DESK_SEATS];
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		seats[seat] = _desks.Get(desk)->getSeat(seat);
+
+	Desk* removed = _desks.Get(desk);
+	_desks.Remove(desk);
+
+	/// the tournament keeps its players for the next game
+	if (_tournament)
+		_tournament->OnDeskRemoved(removed, true);
+	else
+		releaseAiPlayer(seats);
+	return true;
+}
 
-	if (p0->getPlayerType() & PLAYER_TYPE_AI)
+void Room::releaseAiPlayer(Player* seats[DESK_SEATS])
+{
+	/// the clients left the desk already, the ai seats and the players they replaced are released
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
 	{
-		p0->setGameStatus(GAME_STATUS_LOG_OUTED);
+		Player* player = seats[seat];
+		if (player == nullptr || !(player->getPlayerType() & PLAYER_TYPE_AI))
+			continue;
 
-		if (p0->getPlayerType() == PLAYER_TYPE_AI)
-		   sAiPlayerPool->releasePlayer(p0);
-	}		
-	if (p1->getPlayerType() & PLAYER_TYPE_AI)
-	{
-		p1->setGameStatus(GAME_STATUS_LOG_OUTED);
+		player->setGameStatus(GAME_STATUS_LOG_OUTED);
 
-		if (p1->getPlayerType() == PLAYER_TYPE_AI)
-		sAiPlayerPool->releasePlayer(p1);
+		if (player->getPlayerType() == PLAYER_TYPE_AI)
+			releaseAi(player);
 	}
-	
-	if (p2->getPlayerType() & PLAYER_TYPE_AI)
-	{
-		p2->setGameStatus(GAME_STATUS_LOG_OUTED);
+}
 
-		if (p2->getPlayerType() == PLAYER_TYPE_AI)
-		  sAiPlayerPool->releasePlayer(p2);
-	}		
+void Room::releaseAi(Player *player)
+{
+	/// out of the room first, the pool may hand it to another room right away
+	PlayerMapType::iterator itr = _playerMap.find(player->getid());
+	if (itr != _playerMap.end() && itr->second == player)
+		_playerMap.erase(itr);
+	player->setRoom(nullptr);
+	sAiPlayerPool->releasePlayer(player);
 }
 
 void Room::AddPlayer(uint32 id, Player *player, bool inOne)
 {
 	_playerMap[id] = player;
-	if (inOne)
+	player->setRoom(this);
+
+	/// a player of a tournament room registers when they ask for a game
+	if (inOne && !_tournament)
 	{
 	  player->setQueueFlags(QUEUE_FLAGS_ONE);
 	  _OnePlayerList.push_back(player);
@@ -1,27 +1,111 @@
 #ifndef _ROOM_H
 #define _ROOM_H
 
+#include "DeckShuffler.h"
+#include "Desk.h"
+#include "EventProcessor.h"
+#include "LockedQueue.h"
+#include "RoomConfig.h"
 #include "Timer.h"
+#include "TimingHistogram.h"
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class GameVariant;
+class MetricGauge;
 class Player;
+class Tournament;
+
+#define DECK_CARD_NUMBER   54                  /// largest deck of the variants
+#define DEAL_BATCH_SIZE    16                  /// decks shuffled at once when the room runs out of them
+#define ROOM_PLAYER_PASSES 4                   /// player updates in a tick, a transition wakes the desk
+
+enum DeskState
+{
+	DESK_STATE_WAITING,                /// two players waiting for the third one
+	DESK_STATE_STARTING,               /// three players, cards not dealt yet
+	DESK_STATE_GRABBING,               /// grabbing the landlord
+	DESK_STATE_PLAYING,                /// playing cards
+	DESK_STATE_ROUND_OVER,
+	MAX_DESK_STATES
+};
+
+class Room;
+
+/// Work handed to a room by another thread, run by the room thread at the end of an update where
+/// the state of the room is whole. A room closed first runs it with nullptr.
+typedef std::function<void(Room*)> RoomTask;
 
 class Room
 {
+	friend class Tournament;
 public:
-	Room(uint32 id, uint32 basic_score);
+	explicit Room(RoomConfig const& config);
 	~Room();
 	uint32 getRoomId(){ return _id; };
 	void Update(const uint32 diff);
 
+	/// settings of the room, only changed between two room updates
+	RoomConfig const& GetConfig() const { return _config; }
+	/// new settings from a config reload, the variant of the room stays
+	void SetConfig(RoomConfig const& config);
+
+	/// a draining room takes no new players, it's closed once the ones in it left
+	bool IsDraining() const { return _draining; }
+	void SetDraining(bool draining) { _draining = draining; }
+	/// no player in the room, only called between two room updates
+	bool IsEmpty() const { return _playerMap.empty(); }
+
+	/// a server draining seats no player at a new desk, and at its timeout the ai plays for the
+	/// players still at one. Only called between two room updates.
+	void StopMatching() { _matching = false; }
+	void HandDesksToAi() { _handToAi = true; }
+
+	/// safe to call from any thread
+	void Schedule(RoomTask const& task) { _tasks.add(task); }
+
+	/// room thread only: a player in the room, a desk and what it is doing
+	Player* FindPlayer(uint32 id) const;
+	Desk* GetDesk(uint32 desk) const { return desk < _desks.Size() ? _desks.Get(desk) : nullptr; }
+	DeskState GetDeskState(uint32 desk) const;
+	static char const* GetDeskStateName(DeskState state);
+
+	TimingWheel& GetTimers() { return _events.GetTimers(); }
+
+	/// number of players, desks of three and players waiting for a desk in the room at the end of
+	/// its last update, safe to read from any thread
+	uint32 GetPlayerCount() const { return _playerCount; }
+	uint32 GetDeskCount() const { return _deskCount; }
+	uint32 GetMatchQueueSize() const { return _matchQueueSize; }
+
 	void AddPlayer(uint32 id,Player *player,bool inOne = true);
 
+	/// tournament of the room, nullptr for a cash room
+	Tournament* GetTournament() const { return _tournament.get(); }
+
+	/// shuffles at once the decks of count deals to come, the ones shuffled already count
+	void PrepareDeals(uint32 count);
+
+	/// seed of the room deals and number of decks dealt so far
+	uint32 GetDealSeed() const { return _shuffler.GetSeed(); }
+	uint64 GetDealCount() const { return _dealCount; }
+
+	GameVariant const* GetVariant() const { return _variant; }
+
+	/// rebuilds the deck of the given deal (1 being the first one) of a room of the variant dealing with seed,
+	/// false for deal 0
+	static bool ReplayDeal(GameVariant const* variant, uint32 seed, uint64 dealNumber, uint8* cards);
+
 	typedef std::unordered_map<uint32, Player*> PlayerMapType;
 	typedef std::list<Player *> onePlayerList;
 	typedef std::pair<Player*, Player*> twoPlayer;
 	typedef std::list<twoPlayer> twoPlayerList;
-	typedef std::pair<twoPlayer, Player*> threePlayer;
-	typedef std::list<threePlayer> threePlayerList;
 private:
+	void UpdatePlayers(uint32 diff);
+
 	void UpdateOne(uint32 diff);
 	Player * getPlayerFromOne();
 
@@ -29,24 +113,49 @@ private:
 	bool  LogoutTwo(twoPlayer &twoP);
 
 	void UpdateThree(uint32 diff);
-	bool LogoutThree(threePlayer &threeP);
-	bool allStart(threePlayer &threeP);
-	bool allAtThree(threePlayer &threeP);
-	bool allWaitDealCards(threePlayer &threeP);
-	bool roundOver(threePlayer &threeP);
-	void releaseAiPlayer(threePlayer &threeP);
-
-	void dealCards(threePlayer &threeP);
+	void PlayDesksByAi();
+	bool LogoutThree(uint32 desk);
+	bool roundOver(uint32 desk);
+	void releaseAiPlayer(Player* seats[DESK_SEATS]);
+	void releaseAi(Player *player);
+
+	void dealCards(Desk* desk);
 	void shuffleCard(uint8* Cards);
+	void UpdateMetrics();
+	void RunTasks();
+
 
+	uint32 _id;
+	RoomConfig _config;
+	GameVariant const* _variant;
+	std::atomic<bool> _draining;
+	bool _matching;
+	bool _handToAi;
 
 	PlayerMapType _playerMap;
 	onePlayerList _OnePlayerList;
 	twoPlayerList  _twoPlayerList;
-	threePlayerList _threePlayerList;
-	
-	uint32 _id;
-	uint32 _basic_score;
+	DeskTable _desks;                          /// desks of three players
+
+	TimingHistogram _updateTime;
+	EventProcessor _events;                    /// events of the room, the players run their timers on its wheel
+
+	DeckShuffler _shuffler;
+	std::vector<uint8> _dealBatch;             /// decks shuffled ahead, DECK_CARD_NUMBER bytes each
+	uint32 _dealBatchNext;
+	uint64 _dealCount;
+
+	std::unique_ptr<Tournament> _tournament;
+
+	LockedQueue<RoomTask> _tasks;
+
+	std::atomic<uint32> _playerCount;
+	std::atomic<uint32> _deskCount;
+	std::atomic<uint32> _matchQueueSize;
+	MetricGauge* _playersGauge;
+	MetricGauge* _matchQueueGauge;
+	MetricGauge* _tournamentGauge;
+	MetricGauge* _desksGauge[MAX_DESK_STATES];
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "RoomConfig.h"
+
+#include "Config.h"
+#include "GameVariant.h"
+#include "Log.h"
+#include "Util.h"
+#include "World.h"
+
+#include <sstream>
+
+/// gold of the six rooms the server always had, the rooms past them show the last one
+static uint32 const DefaultRoomGold[] = { 1000, 7000, 12000, 30000, 90000, 300000 };
+
+static std::string RoomKey(uint32 id, char const* name)
+{
+	std::ostringstream key;
+	key << "room" << id + 1 << "." << name;
+	return key.str();
+}
+
+RoomConfig RoomConfig::Load(uint32 id)
+{
+	uint32 number = id + 1;
+
+	RoomConfig config;
+	config.id = id;
+
+	std::string variantKey = RoomKey(id, "Variant");
+	std::string name = sConfigMgr->GetStringDefault(variantKey, "classic");
+	config.variant = GameVariant::Find(name);
+	if (!config.variant)
+	{
+		TC_LOG_ERROR("server.loading", "Room %u: unknown game variant '%s' in %s, the room plays classic", id, name.c_str(), variantKey.c_str());
+		config.variant = GameVariant::GetClassic();
+	}
+
+	uint32 defaultGold = DefaultRoomGold[std::min<uint32>(id, sizeof(DefaultRoomGold) / sizeof(DefaultRoomGold[0]) - 1)];
+	config.gold = sConfigMgr->GetIntDefault(RoomKey(id, "Gold"), defaultGold);
+	config.basicScore = sConfigMgr->GetIntDefault(RoomKey(id, "BasicScore"), sWorld->getIntConfig(CONFIG_BASICSCORE) * number);
+	config.basicGold = sConfigMgr->GetIntDefault(RoomKey(id, "BasicGold"), sWorld->getIntConfig(CONFIG_BASICGOLD) * number);
+	config.waitTime = sConfigMgr->GetIntDefault(RoomKey(id, "WaitTime"), sWorld->getIntConfig(CONFIG_WAIT_TIME));
+	config.aiDelay = sConfigMgr->GetIntDefault(RoomKey(id, "AiDelay"), sWorld->getIntConfig(CONFIG_AI_DELAY));
+	config.aiPolicy = sConfigMgr->GetBoolDefault(RoomKey(id, "AiPlayers"), true) ? ROOM_AI_FILL : ROOM_AI_NONE;
+	config.thread = sConfigMgr->GetIntDefault(RoomKey(id, "Thread"), 0);
+
+	config.tournamentInterval = sConfigMgr->GetIntDefault(RoomKey(id, "TournamentInterval"), 0);
+	config.tournamentGames = std::max(sConfigMgr->GetIntDefault(RoomKey(id, "TournamentGames"), 2), 1);
+	config.tournamentAdvance = std::min(std::max(sConfigMgr->GetIntDefault(RoomKey(id, "TournamentAdvance"), 50), 1), 99);
+	config.tournamentMinPlayers = std::max(sConfigMgr->GetIntDefault(RoomKey(id, "TournamentMinPlayers"), 3), 1);
+	config.tournamentDesksPerTick = std::max(sConfigMgr->GetIntDefault(RoomKey(id, "TournamentDesksPerTick"), 32), 1);
+	return config;
+}
+
+std::set<uint32> RoomConfig::LoadRoomIds()
+{
+	std::set<uint32> ids;
+
+	std::string rooms = sConfigMgr->GetStringDefault("Rooms", "");
+	Tokenizer tokens(rooms, ' ');
+	for (char const* token : tokens)
+	{
+		uint32 number = strtoul(token, nullptr, 10);
+		if (number == 0)
+		{
+			TC_LOG_ERROR("server.loading", "Rooms: '%s' is not a room number, room numbers start at 1", token);
+			continue;
+		}
+		ids.insert(number - 1);
+	}
+
+	if (tokens.size() == 0)
+		for (uint32 id = 0; id < sWorld->getIntConfig(CONFIG_NUMBERROOMS); ++id)
+			ids.insert(id);
+	return ids;
+}
@@ -0,0 +1,48 @@
+#ifndef _ROOM_CONFIG_H
+#define _ROOM_CONFIG_H
+
+#include "Define.h"
+
+#include <set>
+
+class GameVariant;
+
+/// How a room fills the seats its players leave empty
+enum RoomAiPolicy
+{
+	ROOM_AI_NONE = 0,                  /// players only, a desk waits for its third player
+	ROOM_AI_FILL = 1                   /// ai players sit at a desk that waited WaitTime
+};
+
+/// Settings of a room from the room<N>.* keys of worldserver.conf, N being the room id + 1.
+/// A key left out takes the world setting it overrides, scaled by N for the stakes as the
+/// rooms always were.
+struct RoomConfig
+{
+	RoomConfig() : id(0), variant(nullptr), gold(0), basicScore(0), basicGold(0), waitTime(0), aiDelay(0),
+		aiPolicy(ROOM_AI_FILL), thread(0), tournamentInterval(0), tournamentGames(0), tournamentAdvance(0),
+		tournamentMinPlayers(0), tournamentDesksPerTick(0) { }
+
+	uint32 id;
+	GameVariant const* variant;        /// fixed for the life of the room, a reload does not change it
+	uint32 gold;                       /// gold the ai players of the room show
+	uint32 basicScore;                 /// score of a round won, before the doubles
+	uint32 basicGold;                  /// gold at stake in a round, before the multiplier
+	uint32 waitTime;                   /// ms a player waits for the others before the ai fills the desk
+	uint32 aiDelay;                    /// ms an ai player thinks before it grabs or plays
+	RoomAiPolicy aiPolicy;
+	uint32 thread;                     /// room update thread the room is pinned to, 0 for any of them
+	uint32 tournamentInterval;         /// minutes between the starts of two tournaments, 0 for a cash room
+	uint32 tournamentGames;            /// games each table of a tournament stage plays
+	uint32 tournamentAdvance;          /// percent of the players of a stage going on to the next one
+	uint32 tournamentMinPlayers;       /// players a tournament needs to start
+	uint32 tournamentDesksPerTick;     /// desks of a tournament seated by a room update
+
+	/// settings of the room with the id, from the current config
+	static RoomConfig Load(uint32 id);
+
+	/// ids of the rooms the config opens: the Rooms list, rooms 1 to RoomNumbers without one
+	static std::set<uint32> LoadRoomIds();
+};
+
+#endif
@@ -2,27 +2,31 @@
 
 #include "RoomManager.h"
 
+#include "AiPlayerPool.h"
+#include "ClusterNode.h"
+#include "GameVariant.h"
+#include "Handoff.h"
 #include "Log.h"
+#include "Metrics.h"
 #include "Config.h"
 #include "World.h"
 #include "WorldPacket.h"
 #include "Player.h"
+#include "TickProfiler.h"
 #include "WorldSession.h"
 #include "Opcodes.h"
 
 RoomManager::RoomManager()
 {
 	_i_timer.SetInterval(sWorld->getIntConfig(CONFIG_INTERVAL_ROOMUPDATE));
+	_playersGauge = sMetrics->GetGauge("landlord_players_logged_in");
 }
 
 RoomManager::~RoomManager() { }
 
 void RoomManager::Initialize()
 {
-	_num_rooms= sWorld->getIntConfig(CONFIG_NUMBERROOMS);
-	_basic_score= sWorld->getIntConfig(CONFIG_BASICSCORE);
-
-	InitRooms();
+	LoadRooms();
 
    uint32 num_threads(sWorld->getIntConfig(CONFIG_NUMTHREADS));
 
@@ -30,13 +34,71 @@ void RoomManager::Initialize()
         _updater.activate(num_threads);
 }
 
-void RoomManager::InitRooms()
+void RoomManager::LoadRooms()
 {
-	for (uint32 id = 0; id < _num_rooms; ++id)
+	std::set<uint32> ids = RoomConfig::LoadRoomIds();
+
+	for (RoomMapType::iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
 	{
-		Room *room = new Room(id, _basic_score * (id + 1));
+		Room* room = itr->second;
+		if (ids.count(itr->first))
+		{
+			room->SetConfig(RoomConfig::Load(itr->first));
+			sAiPlayerPool->SetRoom(room->GetConfig());
+			if (room->IsDraining())
+			{
+				room->SetDraining(false);
+				TC_LOG_INFO("server.loading", "Room %u is open again", itr->first);
+			}
+		}
+		else if (!room->IsDraining())
+		{
+			room->SetDraining(true);
+			TC_LOG_INFO("server.loading", "Room %u is draining, %u players left in it", itr->first, room->GetPlayerCount());
+		}
+	}
+
+	for (uint32 id : ids)
+	{
+		if (_roomMap.count(id))
+			continue;
+
+		RoomConfig config = RoomConfig::Load(id);
+		TC_LOG_INFO("server.loading", "Opening room %u (room%u.*): %s, basic score %u, basic gold %u%s", id, id + 1, config.variant->GetName(),
+			config.basicScore, config.basicGold, config.aiPolicy == ROOM_AI_FILL ? "" : ", no ai players");
+
+		Room* room = new Room(config);
+		if (sWorld->IsDraining())
+			room->StopMatching();
+		sAiPlayerPool->SetRoom(config);
+
+		std::lock_guard<std::mutex> lock(_roomsLock);
 		_roomMap[id] = room;
 	}
+
+	CloseDrainedRooms();
+	sClusterNode->SendRooms();
+}
+
+void RoomManager::CloseDrainedRooms()
+{
+	for (RoomMapType::iterator itr = _roomMap.begin(); itr != _roomMap.end();)
+	{
+		Room* room = itr->second;
+		if (!room->IsDraining() || !room->IsEmpty())
+		{
+			++itr;
+			continue;
+		}
+
+		TC_LOG_INFO("server.loading", "Room %u is drained and closed", itr->first);
+
+		sAiPlayerPool->RemoveRoom(itr->first);
+
+		std::lock_guard<std::mutex> lock(_roomsLock);
+		delete room;
+		itr = _roomMap.erase(itr);
+	}
 }
 
 void RoomManager::Update(uint32 diff)
@@ -45,8 +107,10 @@ void RoomManager::Update(uint32 diff)
     if (!_i_timer.Passed())
         return;
 
-	RoomMapType::iterator iter = _roomMap.begin();
-	for (; iter != _roomMap.end(); ++iter)
+    PROFILE_TICK_PHASE(TICK_PHASE_ROOMS);
+
+    RoomMapType::iterator iter = _roomMap.begin();
+    for (; iter != _roomMap.end(); ++iter)
     {
         if (_updater.activated())
             _updater.schedule_update(*iter->second, uint32(_i_timer.GetCurrent()));
@@ -56,6 +120,9 @@ void RoomManager::Update(uint32 diff)
     if (_updater.activated())
         _updater.wait();
 
+    CloseDrainedRooms();
+    _playersGauge->Set(_players.Count());
+    sAiPlayerPool->Update(uint32(_i_timer.GetCurrent()));
     _i_timer.SetCurrent(0);
 }
 
@@ -79,22 +146,79 @@ uint32 RoomManager::GetNumPlayers()
 
     uint32 ret = 0;
 	for (RoomMapType::iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
-    {
-        Room* room = itr->second;
-     ///  ??????????????????????????????
-    }
+		ret += itr->second->GetPlayerCount();
+
     return ret;
 }
 
 Player* RoomManager::getPlayer(uint32 id)
 {
-	return nullptr;
+	return _players.Find(id);
+}
+
+bool RoomManager::AddPlayer(uint32 roomid, Player * player)
+{
+	RoomMapType::iterator itr = _roomMap.find(roomid);
+	if (itr == _roomMap.end() || itr->second->IsDraining())
+		return false;
+
+	itr->second->AddPlayer(player->getid(), player);
+	_players.Insert(player->getid(), player);
+	sClusterNode->SendPlayerEnter(player->getid());
+	return true;
 }
 
-void RoomManager::AddPlayer(uint32 roomid, Player * player)
+bool RoomManager::ScheduleForRoom(uint32 roomid, RoomTask const& task)
 {
+	std::lock_guard<std::mutex> lock(_roomsLock);
+
 	RoomMapType::iterator itr = _roomMap.find(roomid);
+	if (itr == _roomMap.end())
+		return false;
+
+	itr->second->Schedule(task);
+	return true;
+}
+
+bool RoomManager::ScheduleForPlayer(uint32 id, RoomTask const& task)
+{
+	/// the room id is set before the player is added, it does not change afterwards
+	uint32 roomid = 0;
+	if (!_players.Visit(id, [&roomid](Player* player) { roomid = player->getRoomId(); }))
+		return false;
+
+	return ScheduleForRoom(roomid, task);
+}
+
+void RoomManager::RemovePlayer(Player * player)
+{
+	/// the account may have logged in again with a new player meanwhile
+	if (!_players.Remove(player->getid(), player))
+		return;
+
+	sClusterNode->SendPlayerLeave(player->getid());
+	if (sHandoff->IsHandedOver())
+		sHandoff->SendRelease(player->getid());
+}
+
+void RoomManager::StopMatching()
+{
+	for (RoomMapType::iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
+		itr->second->StopMatching();
+}
+
+void RoomManager::HandDesksToAi()
+{
+	for (RoomMapType::iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
+		itr->second->HandDesksToAi();
+}
+
+uint32 RoomManager::GetDeskCount()
+{
+	std::lock_guard<std::mutex> lock(_roomsLock);
 
-	if (itr != _roomMap.end())
-	  itr->second->AddPlayer(player->getid(),player);
+	uint32 desks = 0;
+	for (RoomMapType::const_iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
+		desks += itr->second->GetDeskCount();
+	return desks;
 }
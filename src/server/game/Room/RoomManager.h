@@ -3,9 +3,11 @@
 #define _ROOMMANAGER_H
 
 
+#include "PlayerDirectory.h"
 #include "Room.h"
 #include "RoomUpdater.h"
 
+class MetricGauge;
 class Player;
 class Transport;
 struct TransportCreatureProto;
@@ -20,17 +22,52 @@ class RoomManager
         }
 
         void Initialize(void);
-		void InitRooms();
+		/// opens the rooms the config lists and drains the ones it dropped, the rooms left open take
+		/// their new settings. Called between two room updates, at start and at each config reload.
+		void LoadRooms();
         void Update(uint32);
 
 		uint32 GetNumPlayers();
+		/// players logged in, ai players are not counted
+		uint32 GetNumLoggedInPlayers() const { return _players.Count(); }
+		/// player logged in with the account id, still at a room or desk
 		Player * getPlayer(uint32 id);
-		void AddPlayer(uint32 roomid,Player * player);
+		/// false when no open room has the id
+		bool AddPlayer(uint32 roomid,Player * player);
+		/// called when a logged in player is deleted
+		void RemovePlayer(Player * player);
+		/// calls f(id, player) for every player logged in
+		template<class F>
+		void ForEachPlayer(F f) const { _players.ForEach(f); }
+
+		/// draining server: no new desk in any room, then the ai ends the rounds left.
+		/// Called between two room updates.
+		void StopMatching();
+		void HandDesksToAi();
+		/// desks of three in game in all the rooms at the end of their last update
+		uint32 GetDeskCount();
+
+		/// calls f(room) for every room, safe from any thread as long as f only reads what the room
+		/// says is safe to read from any thread
+		template<class F>
+		void ForEachRoom(F f)
+		{
+			std::lock_guard<std::mutex> lock(_roomsLock);
+			for (RoomMapType::const_iterator itr = _roomMap.begin(); itr != _roomMap.end(); ++itr)
+				f(itr->second);
+		}
+		/// hands the task to the room with the id, or to the room of the player logged in with the
+		/// account id. False when there is no such room or player, the task is not run then.
+		bool ScheduleForRoom(uint32 roomid, RoomTask const& task);
+		bool ScheduleForPlayer(uint32 id, RoomTask const& task);
         void UnloadAll();
 
     private:
         typedef std::unordered_map<uint32, Room*> RoomMapType;
 
+        /// deletes the draining rooms the last players left
+        void CloseDrainedRooms();
+
 		RoomManager();
 		~RoomManager();
 
@@ -39,8 +76,8 @@ class RoomManager
         std::mutex _roomsLock;
         RoomUpdater _updater;
 
-		uint32 _num_rooms;
-		uint32 _basic_score;
+        PlayerDirectory _players;
+        MetricGauge* _playersGauge;
 };
 #define sRoomMgr RoomManager::instance()
 #endif
@@ -20,7 +20,9 @@
 #include <condition_variable>
 
 #include "RoomUpdater.h"
+#include "Metrics.h"
 #include "Room.h"
+#include "Watchdog.h"
 
 
 class RoomUpdateRequest
@@ -45,21 +47,30 @@ class RoomUpdateRequest
         }
 };
 
+RoomUpdater::RoomUpdater() : _cancelationToken(false), pending_requests(0)
+{
+    _pendingGauge = sMetrics->GetGauge("landlord_room_update_queue");
+}
+
 void RoomUpdater::activate(size_t num_threads)
 {
+    _pinnedQueues.resize(num_threads);
+
     for (size_t i = 0; i < num_threads; ++i)
     {
-        _workerThreads.push_back(std::thread(&RoomUpdater::WorkerThread, this));
+        _workerThreads.push_back(std::thread(&RoomUpdater::WorkerThread, this, i));
     }
 }
 
 void RoomUpdater::deactivate()
 {
-    _cancelationToken = true;
-
     wait();
 
-    _queue.Cancel();
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _cancelationToken = true;
+    }
+    _workCondition.notify_all();
 
     for (auto& thread : _workerThreads)
     {
@@ -82,8 +93,21 @@ void RoomUpdater::schedule_update(Room& room, uint32 diff)
     std::lock_guard<std::mutex> lock(_lock);
 
     ++pending_requests;
+    _pendingGauge->Add(1);
+
+    RoomUpdateRequest* request = new RoomUpdateRequest(room, *this, diff);
 
-	_queue.Push(new RoomUpdateRequest(room, *this, diff));
+    /// a pinned room waits for its worker, the others go to the first worker free
+    if (uint32 thread = room.GetConfig().thread)
+    {
+        _pinnedQueues[(thread - 1) % _pinnedQueues.size()].push_back(request);
+        _workCondition.notify_all();
+    }
+    else
+    {
+        _queue.push_back(request);
+        _workCondition.notify_one();
+    }
 }
 
 bool RoomUpdater::activated()
@@ -96,20 +120,30 @@ void RoomUpdater::update_finished()
     std::lock_guard<std::mutex> lock(_lock);
 
     --pending_requests;
+    _pendingGauge->Add(-1);
 
     _condition.notify_all();
 }
 
-void RoomUpdater::WorkerThread()
+void RoomUpdater::WorkerThread(size_t index)
 {
+    sWatchdog->SetThreadName("room updater");
+
+    RequestQueue& pinned = _pinnedQueues[index];
     while (1)
     {
         RoomUpdateRequest* request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_lock);
 
-        _queue.WaitAndPop(request);
+            _workCondition.wait(lock, [&]() { return _cancelationToken || !pinned.empty() || !_queue.empty(); });
+            if (_cancelationToken)
+                return;
 
-        if (_cancelationToken)
-            return;
+            RequestQueue& queue = !pinned.empty() ? pinned : _queue;
+            request = queue.front();
+            queue.pop_front();
+        }
 
         request->call();
 
@@ -23,8 +23,10 @@
 #include <mutex>
 #include <thread>
 #include <condition_variable>
-#include "ProducerConsumerQueue.h"
+#include <deque>
+#include <vector>
 
+class MetricGauge;
 class RoomUpdateRequest;
 class Room;
 
@@ -32,7 +34,7 @@ class RoomUpdater
 {
     public:
 
-		RoomUpdater() : _cancelationToken(false), pending_requests(0) {}
+		RoomUpdater();
 		~RoomUpdater() { };
 
 		friend class RoomUpdateRequest;
@@ -49,7 +51,11 @@ class RoomUpdater
 
     private:
 
-        ProducerConsumerQueue<RoomUpdateRequest*> _queue;
+        typedef std::deque<RoomUpdateRequest*> RequestQueue;
+
+        RequestQueue _queue;                       /// rooms any worker updates
+        std::vector<RequestQueue> _pinnedQueues;   /// rooms pinned to each worker by their Thread setting
+        std::condition_variable _workCondition;
 
         std::vector<std::thread> _workerThreads;
         std::atomic<bool> _cancelationToken;
@@ -57,10 +63,11 @@ class RoomUpdater
         std::mutex _lock;
         std::condition_variable _condition;
         size_t pending_requests;
+        MetricGauge* _pendingGauge;
 
         void update_finished();
 
-        void WorkerThread();
+        void WorkerThread(size_t index);
 };
 
 #endif //_ROOM_UPDATER_H_
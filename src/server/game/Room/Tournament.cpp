@@ -0,0 +1,371 @@
+#include "Tournament.h"
+
+#include "AiPlayerPool.h"
+#include "Common.h"
+#include "Log.h"
+#include "Player.h"
+#include "Room.h"
+#include "Util.h"
+#include "WorldSession.h"
+
+#include <algorithm>
+
+Tournament::Tournament(Room* room) : _room(room), _state(TOURNAMENT_STATE_WAITING), _nextStart(0), _serial(0), _stage(0), _tablesDone(0)
+{
+	ScheduleNext();
+
+	TC_LOG_INFO("server.tournament", "Room %u runs a tournament every %u minutes, %u games a stage, the best %u%% go on",
+		_room->getRoomId(), _room->GetConfig().tournamentInterval, _room->GetConfig().tournamentGames, _room->GetConfig().tournamentAdvance);
+}
+
+void Tournament::Update()
+{
+	/// a draining room ends the games in progress and starts no other one
+	if (_state == TOURNAMENT_STATE_PLAYING && (!_room->_matching || _room->IsDraining()))
+	{
+		TC_LOG_INFO("server.tournament", "Room %u: tournament %u is cancelled at stage %u, the room stopped matching", _room->getRoomId(), _serial, _stage);
+		_state = TOURNAMENT_STATE_CANCELLING;
+		_toSeat.clear();
+	}
+
+	switch (_state)
+	{
+		case TOURNAMENT_STATE_WAITING:
+			if (_room->_matching && !_room->IsDraining() && time(nullptr) >= _nextStart)
+				Start();
+			break;
+		case TOURNAMENT_STATE_PLAYING:
+			SeatTables();
+			break;
+		case TOURNAMENT_STATE_CANCELLING:
+			if (_desks.empty())
+				Cancel();
+			break;
+	}
+}
+
+void Tournament::Register(Player* player)
+{
+	_queue.push_back(player->getid());
+	_registered.insert(player->getid());
+
+	if (WorldSession* session = player->GetSession())
+		session->SendServerNotice(SERVER_NOTICE_TOURNAMENT_START, uint32(std::max<time_t>(_nextStart - time(nullptr), 0)));
+}
+
+void Tournament::AddPoints(uint32 id, int32 points)
+{
+	/// the ai seated for an entrant gone plays for nobody
+	std::unordered_map<uint32, Entrant>::iterator itr = _entrants.find(id);
+	if (itr != _entrants.end())
+		itr->second.points += points;
+}
+
+void Tournament::OnDeskRemoved(Desk const* desk, bool played)
+{
+	std::unordered_map<Desk const*, uint32>::iterator itr = _desks.find(desk);
+	if (itr == _desks.end())
+		return;
+
+	Table& table = _tables[itr->second];
+	uint32 index = itr->second;
+	_desks.erase(itr);
+
+	if (_state != TOURNAMENT_STATE_PLAYING)
+		return;
+
+	if (played)
+		++table.gamesPlayed;
+
+	if (table.gamesPlayed < _room->GetConfig().tournamentGames)
+	{
+		_toSeat.push_back(index);
+		return;
+	}
+
+	ReleaseStandIns(table);
+	if (++_tablesDone == _tables.size())
+		EndStage();
+}
+
+void Tournament::Start()
+{
+	RoomConfig const& config = _room->GetConfig();
+
+	/// the players still there and waiting, the others registered in vain
+	std::vector<Player*> players;
+	for (uint32 id : _queue)
+	{
+		Player* player = _room->FindPlayer(id);
+		if (player && player->getPlayerType() == PLAYER_TYPE_USER && player->getGameStatus() == GAME_STATUS_STARTED && player->idle())
+			players.push_back(player);
+	}
+
+	_queue.clear();
+	_registered.clear();
+	ScheduleNext();
+
+	/// without the ai the players past the last table of three wait for the next start
+	uint32 seated = config.aiPolicy == ROOM_AI_FILL ? players.size() : players.size() / DESK_SEATS * DESK_SEATS;
+	if (seated == 0 || seated < config.tournamentMinPlayers)
+	{
+		if (!players.empty())
+			TC_LOG_INFO("server.tournament", "Room %u: %u players registered, the tournament needs %u, it waits for the next start",
+				_room->getRoomId(), uint32(players.size()), config.tournamentMinPlayers);
+
+		for (Player* player : players)
+			Register(player);
+		return;
+	}
+
+	for (uint32 i = seated; i < players.size(); ++i)
+		Register(players[i]);
+	players.resize(seated);
+
+	/// the ai fills the last table
+	std::vector<Player*> ais;
+	while ((players.size() + ais.size()) % DESK_SEATS)
+	{
+		Player* ai = sAiPlayerPool->getAiPlayer(config);
+		if (!ai)
+		{
+			TC_LOG_ERROR("server.tournament", "Room %u: no ai player left to fill the last table, the tournament waits for the next start",
+				_room->getRoomId());
+
+			for (Player* taken : ais)
+				sAiPlayerPool->releasePlayer(taken);
+			for (Player* player : players)
+				Register(player);
+			return;
+		}
+		ais.push_back(ai);
+	}
+
+	for (uint32 i = players.size() - 1; i > 0; --i)
+		std::swap(players[i], players[urand(0, i)]);
+
+	++_serial;
+	_stage = 0;
+	_entrants.clear();
+	_ranking.clear();
+	for (Player* player : players)
+	{
+		_entrants[player->getid()] = Entrant();
+		_ranking.push_back(player->getid());
+	}
+
+	for (Player* ai : ais)
+	{
+		_room->AddPlayer(ai->getid(), ai, false);
+		_entrants[ai->getid()] = Entrant();
+		_ranking.push_back(ai->getid());
+	}
+
+	TC_LOG_INFO("server.tournament", "Room %u: tournament %u starts with %u players, %u of them ai", _room->getRoomId(), _serial,
+		uint32(_ranking.size()), uint32(_ranking.size() - players.size()));
+
+	StartStage();
+}
+
+void Tournament::StartStage()
+{
+	++_stage;
+
+	uint32 count = _ranking.size() / DESK_SEATS;
+	_tables.assign(count, Table());
+
+	/// snake seating on the ranking of the last stage, the best ones are spread over the tables.
+	/// At the first stage the ranking is the random order of the start.
+	for (uint32 rank = 0; rank < _ranking.size(); ++rank)
+	{
+		uint32 seat = rank / count;
+		uint32 table = seat % 2 ? count - 1 - rank % count : rank % count;
+		_tables[table].entrants[seat] = _ranking[rank];
+	}
+
+	_toSeat.clear();
+	for (uint32 table = 0; table < count; ++table)
+		_toSeat.push_back(table);
+	_tablesDone = 0;
+
+	_room->PrepareDeals(count * _room->GetConfig().tournamentGames);
+	_state = TOURNAMENT_STATE_PLAYING;
+
+	TC_LOG_INFO("server.tournament", "Room %u: tournament %u, stage %u at %u tables%s", _room->getRoomId(), _serial, _stage, count,
+		count == 1 ? ", the final" : "");
+}
+
+void Tournament::SeatTables()
+{
+	for (uint32 desks = 0; desks < _room->GetConfig().tournamentDesksPerTick && !_toSeat.empty(); ++desks)
+	{
+		SeatTable(_toSeat.front());
+		_toSeat.pop_front();
+	}
+}
+
+void Tournament::SeatTable(uint32 index)
+{
+	Table& table = _tables[index];
+	Player* seats[DESK_SEATS];
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		uint32 id = table.entrants[seat];
+		Entrant& entrant = _entrants[id];
+		Player* player = _room->FindPlayer(id);
+
+		/// a player gone, logging out or logged in again without asking for a game forfeits, the ai
+		/// plays the seat to the end of the stage
+		if (!entrant.forfeited && (!player || player->LogOut() || (player->getGameStatus() & 0xf0) || player->getDesk()
+			|| player->getGameStatus() == GAME_STATUS_WAIT_START))
+		{
+			entrant.forfeited = true;
+			TC_LOG_DEBUG("server.tournament", "Room %u: player %u forfeits tournament %u at stage %u", _room->getRoomId(), id, _serial, _stage);
+		}
+
+		if (entrant.forfeited)
+		{
+			if (!table.standIns[seat])
+			{
+				/// the ai pool is full, the table is seated at a later update
+				table.standIns[seat] = sAiPlayerPool->getAiPlayer(_room->GetConfig());
+				if (!table.standIns[seat])
+				{
+					_toSeat.push_back(index);
+					return;
+				}
+				_room->AddPlayer(table.standIns[seat]->getid(), table.standIns[seat], false);
+			}
+			player = table.standIns[seat];
+		}
+
+		/// what is left of the last game, the neighbours of a desk left by a player logging out
+		player->resetGame();
+		seats[seat] = player;
+	}
+
+	seats[0]->addPlayer(seats[1]);
+	seats[1]->addPlayer(seats[2]);
+	seats[2]->addPlayer(seats[0]);
+
+	_desks[_room->_desks.Create(seats[0], seats[1], seats[2])] = index;
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		seats[seat]->setStart();
+		if (table.gamesPlayed == 0 && seats[seat]->getPlayerType() == PLAYER_TYPE_USER)
+			seats[seat]->GetSession()->SendServerNotice(SERVER_NOTICE_TOURNAMENT_STAGE, _stage);
+	}
+}
+
+void Tournament::EndStage()
+{
+	/// the points carried over rank the players, the ones who forfeited last
+	std::stable_sort(_ranking.begin(), _ranking.end(), [this](uint32 left, uint32 right)
+	{
+		Entrant const& a = _entrants[left];
+		Entrant const& b = _entrants[right];
+		if (a.forfeited != b.forfeited)
+			return b.forfeited;
+		return a.points > b.points;
+	});
+
+	uint32 count = _ranking.size();
+	uint32 playing = 0;
+	for (uint32 id : _ranking)
+		if (!_entrants[id].forfeited)
+			++playing;
+
+	/// the best TournamentAdvance percent rounded to a table, at least one table less
+	uint32 advance = (count * _room->GetConfig().tournamentAdvance + 150) / 300 * DESK_SEATS;
+	advance = std::max<uint32>(advance, DESK_SEATS);
+	advance = std::min<uint32>(advance, count - DESK_SEATS);
+	advance = std::min<uint32>(advance, playing / DESK_SEATS * DESK_SEATS);
+
+	if (count <= DESK_SEATS || advance == 0)
+	{
+		Finish();
+		return;
+	}
+
+	TC_LOG_INFO("server.tournament", "Room %u: tournament %u, stage %u is over, %u of %u players go on, player %u leads with " SI64FMTD " points",
+		_room->getRoomId(), _serial, _stage, advance, count, _ranking[0], _entrants[_ranking[0]].points);
+
+	for (uint32 rank = advance; rank < count; ++rank)
+		Eliminate(_ranking[rank], rank + 1);
+	_ranking.resize(advance);
+
+	StartStage();
+}
+
+void Tournament::Finish()
+{
+	TC_LOG_INFO("server.tournament", "Room %u: tournament %u is won by player %u with " SI64FMTD " points after %u stages",
+		_room->getRoomId(), _serial, _ranking[0], _entrants[_ranking[0]].points, _stage);
+
+	for (uint32 rank = 0; rank < _ranking.size(); ++rank)
+		Eliminate(_ranking[rank], rank + 1);
+
+	_ranking.clear();
+	_tables.clear();
+	_state = TOURNAMENT_STATE_WAITING;
+}
+
+void Tournament::Cancel()
+{
+	for (Table& table : _tables)
+		ReleaseStandIns(table);
+
+	for (uint32 id : _ranking)
+		Eliminate(id, 0);
+
+	_ranking.clear();
+	_tables.clear();
+	_state = TOURNAMENT_STATE_WAITING;
+}
+
+void Tournament::Eliminate(uint32 id, uint32 rank)
+{
+	_entrants.erase(id);
+
+	Player* player = _room->FindPlayer(id);
+	if (!player)
+		return;
+
+	/// a table cancelled may leave its players with neighbours
+	player->resetGame();
+
+	TC_LOG_DEBUG("server.tournament", "Room %u: player %u leaves tournament %u at rank %u", _room->getRoomId(), id, _serial, rank);
+
+	switch (player->getPlayerType())
+	{
+		case PLAYER_TYPE_USER:
+			/// the player asks for a game again to play the next tournament
+			player->GetSession()->SendServerNotice(SERVER_NOTICE_TOURNAMENT_RANK, rank);
+			break;
+		case PLAYER_TYPE_REPLACE_AI:
+			/// the client never came back, the room deletes the player
+			player->setGameStatus(GAME_STATUS_LOG_OUTED);
+			break;
+		case PLAYER_TYPE_AI:
+			_room->releaseAi(player);
+			break;
+	}
+}
+
+void Tournament::ReleaseStandIns(Table& table)
+{
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		if (table.standIns[seat])
+			_room->releaseAi(table.standIns[seat]);
+		table.standIns[seat] = nullptr;
+	}
+}
+
+void Tournament::ScheduleNext()
+{
+	time_t interval = time_t(_room->GetConfig().tournamentInterval) * MINUTE;
+	_nextStart = (time(nullptr) / interval + 1) * interval;
+}
@@ -0,0 +1,97 @@
+#ifndef _TOURNAMENT_H
+#define _TOURNAMENT_H
+
+#include "Desk.h"
+
+#include <ctime>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Player;
+class Room;
+
+enum TournamentState
+{
+	TOURNAMENT_STATE_WAITING,          /// players register for the next start
+	TOURNAMENT_STATE_PLAYING,          /// the tables of a stage play their games
+	TOURNAMENT_STATE_CANCELLING        /// the room stopped matching, the games in progress end
+};
+
+/// Tournaments of a room with room<N>.TournamentInterval set, run by the room thread.
+/// A player asking for a game registers for the next start, aligned on the interval. At the start
+/// the players are seated at random, the ai fills the last table, and each table plays
+/// TournamentGames games at fixed seats. The points won carry over from stage to stage: after a
+/// stage the best TournamentAdvance percent go on, seated again so the best ones meet late, until
+/// the last table of three plays the final.
+/// The tables of a stage are seated TournamentDesksPerTick a room update, so hundreds of desks
+/// starting at once neither flood the network threads nor take a room update alone. Their decks
+/// are shuffled in one batch when the stage starts.
+class Tournament
+{
+public:
+	explicit Tournament(Room* room);
+
+	void Update();
+
+	/// a player of the room asking for a game, they join the next tournament
+	void Register(Player* player);
+	bool IsRegistered(uint32 id) const { return _registered.count(id) != 0; }
+	/// the player plays in the tournament running, their games are started by it
+	bool IsPlaying(uint32 id) const { return _entrants.count(id) != 0; }
+	/// players still in the tournament running
+	uint32 GetPlayerCount() const { return _ranking.size(); }
+
+	/// points of a game settled, the gold of the players does not change
+	void AddPoints(uint32 id, int32 points);
+	/// a desk of the room is removed, played to the end or left by a player logging out
+	void OnDeskRemoved(Desk const* desk, bool played);
+
+private:
+	struct Entrant
+	{
+		Entrant() : points(0), forfeited(false) { }
+
+		int64 points;
+		bool forfeited;                /// logged out, an ai plays their seat until the stage ends
+	};
+
+	struct Table
+	{
+		uint32 entrants[DESK_SEATS];   /// account ids, the table is seated again from them
+		Player* standIns[DESK_SEATS];  /// ai players seated for the entrants gone
+		uint32 gamesPlayed;
+	};
+
+	void Start();
+	void StartStage();
+	void SeatTables();
+	void SeatTable(uint32 table);
+	void EndStage();
+	void Finish();
+	void Cancel();
+
+	/// an entrant leaves the tournament with their final rank, 0 when it is cancelled
+	void Eliminate(uint32 id, uint32 rank);
+	void ReleaseStandIns(Table& table);
+	void ScheduleNext();
+
+	Room* _room;
+	TournamentState _state;
+	time_t _nextStart;
+	uint32 _serial;                            /// tournaments the room ran
+	uint32 _stage;
+
+	std::vector<uint32> _queue;                /// registered for the next start, in order
+	std::unordered_set<uint32> _registered;
+
+	std::unordered_map<uint32, Entrant> _entrants;
+	std::vector<uint32> _ranking;              /// entrants still in, by rank at the last stage
+	std::vector<Table> _tables;
+	std::deque<uint32> _toSeat;                /// tables waiting for the desk of their next game
+	std::unordered_map<Desk const*, uint32> _desks;
+	uint32 _tablesDone;
+};
+
+#endif
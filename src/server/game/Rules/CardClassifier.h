@@ -0,0 +1,183 @@
+#ifndef _CARD_CLASSIFIER_H
+#define _CARD_CLASSIFIER_H
+
+#include "GameRules.h"
+#include "Player.h"
+
+/// Type of a play under the rules of a variant, from the rank counts of its cards.
+/// Runs never go past the ace, the twos and the jokers only play alone, in pairs, triples or bombs.
+template<class Rules>
+class CardClassifier
+{
+public:
+	/// cards end at the first CARD_TERMINATE or after size cards, CARD_TYPE_END when they are no play
+	static CardType Classify(uint8 const* cards, uint32 size)
+	{
+		uint8 counts[CARD_RANKS] = { 0 };
+		uint32 total = 0;
+		for (; total < size && cards[total] != CARD_TERMINATE; ++total)
+		{
+			uint8 rank = CardRank(cards[total]);
+			if (rank >= CARD_RANKS || ++counts[rank] > (rank >= CARD_RANK_SMALL_JOKER ? 1 : CARD_COLORS))
+				return CARD_TYPE_END;
+		}
+
+		/// groups[n]: ranks played n times
+		uint32 groups[CARD_COLORS + 1] = { 0 };
+		for (uint8 rank = 0; rank < CARD_RANKS; ++rank)
+			++groups[counts[rank]];
+
+		switch (total)
+		{
+			case 0:
+				return CARD_TYPE_PASS;
+			case 1:
+				return CARD_TYPE_SINGLE;
+			case 2:
+				if (counts[CARD_RANK_SMALL_JOKER] && counts[CARD_RANK_BIG_JOKER])
+					return CARD_TYPE_ROCKET;
+				return groups[2] ? CARD_TYPE_PAIR : CARD_TYPE_END;
+			case 3:
+				return groups[3] ? CARD_TYPE_TRPILE : CARD_TYPE_END;
+			case 4:
+				if (groups[4])
+					return CARD_TYPE_BOMB;
+				return groups[3] ? CARD_TYPE_TRIPLE_ONE : CARD_TYPE_END;
+			case 5:
+				if (groups[3] && groups[2])
+					return CARD_TYPE_TRIPLE_TWO;
+				break;
+			default:
+				break;
+		}
+
+		if (groups[1] == total && total >= Rules::MIN_SINGLE_RUN && IsRun(counts, 1, total))
+			return CARD_TYPE_SINGLE_PROGRESSION;
+		if (groups[2] * 2 == total && groups[2] >= Rules::MIN_PAIR_RUN && IsRun(counts, 2, groups[2]))
+			return CARD_TYPE_PAIR_PROGRESSION;
+		if (groups[3] * 3 == total && groups[3] >= Rules::MIN_TRIPLE_RUN && IsRun(counts, 3, groups[3]))
+			return CARD_TYPE_TRIPLE_PROGRESSION;
+		if (Rules::FOUR_WITH_TWO && groups[4] == 1 && (total == 6 || (total == 8 && groups[2] == 2)))
+			return CARD_TYPE_FOUR_TWO;
+		if (AirplaneTop(counts, total) != CARD_RANKS)
+			return CARD_TYPE_AIRPLANE;
+		return CARD_TYPE_END;
+	}
+
+	/// type of the cards a player plays from hand, CARD_TYPE_END when they can't be played: cards of
+	/// no type, not all held, or neither beating the last play nor a pass. last is nullptr when the
+	/// player leads, a lead can't be a pass.
+	static CardType CheckPlay(uint8 const* hand, uint8 const* cards, uint8 const* last, uint32 size)
+	{
+		CardType type = Classify(cards, size);
+		if (type == CARD_TYPE_END || !Holds(hand, cards, size))
+			return CARD_TYPE_END;
+
+		if (!last)
+			return type == CARD_TYPE_PASS ? CARD_TYPE_END : type;
+		if (type == CARD_TYPE_PASS || Beats(cards, type, last, Classify(last, size), size))
+			return type;
+		return CARD_TYPE_END;
+	}
+
+	/// every card played is in the hand, terminated by CARD_TERMINATE, and none is played twice
+	static bool Holds(uint8 const* hand, uint8 const* cards, uint32 size)
+	{
+		bool taken[HAND_CARD_NUMBER] = { false };
+		for (uint32 i = 0; i < size && cards[i] != CARD_TERMINATE; ++i)
+		{
+			uint32 slot = 0;
+			while (slot < HAND_CARD_NUMBER && hand[slot] != CARD_TERMINATE && (hand[slot] != cards[i] || taken[slot]))
+				++slot;
+
+			if (slot == HAND_CARD_NUMBER || hand[slot] != cards[i])
+				return false;
+			taken[slot] = true;
+		}
+		return true;
+	}
+
+	/// a rocket beats anything, a bomb any other play but a higher bomb, the other plays only beat
+	/// a play of the same type and as many cards with a higher rank
+	static bool Beats(uint8 const* cards, CardType type, uint8 const* last, CardType lastType, uint32 size)
+	{
+		if (lastType == CARD_TYPE_ROCKET)
+			return false;
+		if (type == CARD_TYPE_ROCKET || (type == CARD_TYPE_BOMB && lastType != CARD_TYPE_BOMB))
+			return true;
+		if (type != lastType)
+			return false;
+
+		uint32 total, lastTotal;
+		uint8 top = Top(cards, type, size, total);
+		uint8 lastTop = Top(last, lastType, size, lastTotal);
+		return total == lastTotal && top > lastTop;
+	}
+
+private:
+	/// length ranks played width times each, one after the other and no higher than the ace
+	static bool IsRun(uint8 const* counts, uint8 width, uint32 length)
+	{
+		uint8 first = 0;
+		while (counts[first] != width)
+			++first;
+
+		if (first + length - 1 > CARD_RANK_ACE)
+			return false;
+		for (uint32 i = 0; i < length; ++i)
+			if (counts[first + i] != width)
+				return false;
+		return true;
+	}
+
+	/// rank a classified play is compared by, and its number of cards: the highest rank of the run of
+	/// triples of an airplane, the highest of the ranks played the most for the others
+	static uint8 Top(uint8 const* cards, CardType type, uint32 size, uint32& total)
+	{
+		uint8 counts[CARD_RANKS] = { 0 };
+		for (total = 0; total < size && cards[total] != CARD_TERMINATE; ++total)
+			++counts[CardRank(cards[total])];
+
+		if (type == CARD_TYPE_AIRPLANE)
+			return AirplaneTop(counts, total);
+
+		uint8 top = 0;
+		for (uint8 rank = 1; rank < CARD_RANKS; ++rank)
+			if (counts[rank] >= counts[top])
+				top = rank;
+		return top;
+	}
+
+	/// a run of triples with a single or a pair for each of them, the highest rank of the run or
+	/// CARD_RANKS when the cards are no airplane
+	static uint8 AirplaneTop(uint8 const* counts, uint32 total)
+	{
+		for (uint8 first = 0; first <= CARD_RANK_ACE; ++first)
+		{
+			uint8 last = first;
+			while (last <= CARD_RANK_ACE && counts[last] >= 3)
+				++last;
+
+			for (uint32 length = last - first; length >= Rules::MIN_TRIPLE_RUN; --length)
+			{
+				if (total == length * 4)
+					return first + length - 1;
+				if (total != length * 5)
+					continue;
+
+				/// the wings are pairs: every card left over pairs up
+				bool pairs = true;
+				for (uint8 rank = 0; rank < CARD_RANKS && pairs; ++rank)
+				{
+					uint8 left = counts[rank] - (rank >= first && rank < first + length ? 3 : 0);
+					pairs = left % 2 == 0;
+				}
+				if (pairs)
+					return first + length - 1;
+			}
+		}
+		return CARD_RANKS;
+	}
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "DealTable.h"
+
+#include "GameRules.h"
+#include "Log.h"
+
+#if PLATFORM == PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void* MapFile(std::string const& fileName, size_t& size)
+{
+#if PLATFORM == PLATFORM_WINDOWS
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	LARGE_INTEGER fileSize;
+	void* map = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		/// the view outlives the handles
+		if (HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+		{
+			map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		size = size_t(fileSize.QuadPart);
+	}
+	CloseHandle(file);
+	return map;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	void* map = nullptr;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+			map = nullptr;
+		else
+		{
+			/// every entry is as likely as the others, read ahead is of no use
+			madvise(map, st.st_size, MADV_RANDOM);
+			size = size_t(st.st_size);
+		}
+	}
+	close(fd);
+	return map;
+#endif
+}
+
+static void UnmapFile(void* map, size_t size)
+{
+#if PLATFORM == PLATFORM_WINDOWS
+	UnmapViewOfFile(map);
+#else
+	munmap(map, size);
+#endif
+}
+
+bool DealTable::Load(std::string const& fileName)
+{
+	Unload();
+
+	size_t size = 0;
+	void* map = MapFile(fileName, size);
+	if (!map)
+	{
+		TC_LOG_ERROR("server.loading", "DealTable: can't map %s", fileName.c_str());
+		return false;
+	}
+
+	DealTableHeader const* header = static_cast<DealTableHeader const*>(map);
+	uint8 const* deals = static_cast<uint8 const*>(map) + sizeof(DealTableHeader);
+	uint64 dealsSize = size >= sizeof(DealTableHeader) ? size - sizeof(DealTableHeader) : 0;
+
+	char const* error = nullptr;
+	if (size < sizeof(DealTableHeader) || header->magic != DEAL_TABLE_MAGIC)
+		error = "not a deal table";
+	else if (header->version != DEAL_TABLE_VERSION || header->deckSize != DEAL_TABLE_DECK)
+		error = "made by another version of the generator";
+	else if (header->count == 0 || dealsSize != uint64(header->count) * DEAL_TABLE_DECK)
+		error = "truncated";
+	else if (DealTableChecksum(deals, dealsSize) != header->checksum)
+		error = "damaged";
+	else
+	{
+		for (uint32 i = 0; i < header->count && !error; ++i)
+			if (!CheckDeal(deals + uint64(i) * DEAL_TABLE_DECK))
+				error = "holding a deal that is not a deck";
+	}
+
+	if (error)
+	{
+		TC_LOG_ERROR("server.loading", "DealTable: %s is %s", fileName.c_str(), error);
+		UnmapFile(map, size);
+		return false;
+	}
+
+	_map = map;
+	_mapSize = size;
+	_deals = deals;
+	_count = header->count;
+
+	TC_LOG_INFO("server.loading", "Mapped %u deals from %s (generator seed %u)", _count, fileName.c_str(), header->seed);
+	return true;
+}
+
+void DealTable::Unload()
+{
+	if (!_map)
+		return;
+
+	UnmapFile(_map, _mapSize);
+	_map = nullptr;
+	_mapSize = 0;
+	_deals = nullptr;
+	_count = 0;
+}
+
+bool DealTable::CheckDeal(uint8 const* ranks)
+{
+	uint8 counts[CARD_RANKS] = { 0 };
+	for (uint32 i = 0; i < DEAL_TABLE_DECK; ++i)
+	{
+		if (ranks[i] >= CARD_RANKS)
+			return false;
+		++counts[ranks[i]];
+	}
+
+	for (uint8 rank = 0; rank < CARD_RANKS; ++rank)
+		if (counts[rank] != (rank >= CARD_RANK_SMALL_JOKER ? 1 : CARD_COLORS))
+			return false;
+	return true;
+}
+
+void DealTable::Deal(DeckShuffler& shuffler, uint8* deck) const
+{
+	uint8 const* ranks = _deals + uint64(shuffler.Bounded(_count)) * DEAL_TABLE_DECK;
+
+	/// the hands go round the seats and the suits are relabeled, the clusters of ranks stay
+	uint32 turn = shuffler.Bounded(3);
+	uint8 colors[CARD_COLORS] = { 0, 1, 2, 3 };
+	shuffler.Shuffle(colors, CARD_COLORS);
+
+	uint8 seen[CARD_RANKS] = { 0 };
+	for (uint32 i = 0; i < DEAL_TABLE_DECK; ++i)
+	{
+		uint32 hand = i / DEAL_TABLE_HAND;
+		uint32 pos = hand < 3 ? (hand + turn) % 3 * DEAL_TABLE_HAND + i % DEAL_TABLE_HAND : i;
+
+		/// the jokers are 61 and 62, the color of both is 3
+		uint8 rank = ranks[i];
+		deck[pos] = rank >= CARD_RANK_SMALL_JOKER ? (3 << 4 | rank) : (colors[seen[rank]++] << 4 | rank);
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef _DEAL_TABLE_H
+#define _DEAL_TABLE_H
+
+#include "DeckShuffler.h"
+
+#include <string>
+
+#define DEAL_TABLE_MAGIC    0x4C414544   /// "DEAL"
+#define DEAL_TABLE_VERSION  1
+#define DEAL_TABLE_DECK     54           /// ranks of a deal: the hands in seat order, then the base cards
+#define DEAL_TABLE_HAND     17
+
+/// File written by the dealtable_generator tool, followed by count deals of DEAL_TABLE_DECK ranks
+struct DealTableHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 deckSize;
+	uint32 count;
+	uint32 seed;                 /// seed the generator drew from, for the record
+	uint32 checksum;             /// of the deals
+};
+
+/// FNV-1a, the generator and the server check the deals with it
+inline uint32 DealTableChecksum(uint8 const* deals, uint64 size)
+{
+	uint32 hash = 2166136261U;
+	for (uint64 i = 0; i < size; ++i)
+		hash = (hash ^ deals[i]) * 16777619U;
+	return hash;
+}
+
+/// Precomputed no-shuffle deals mapped from a file. A deal is a lookup of a random entry, the
+/// seats are turned and the suits relabeled so the same entry deals different cards each time.
+/// Loaded before the rooms start and read-only afterwards, the room threads share it.
+class DealTable
+{
+public:
+	static DealTable* instance()
+	{
+		static DealTable instance;
+		return &instance;
+	}
+
+	/// maps the file and checks every deal, false (and nothing loaded) for a missing or damaged table
+	bool Load(std::string const& fileName);
+	void Unload();
+
+	bool IsLoaded() const { return _deals != nullptr; }
+	uint32 GetCount() const { return _count; }
+
+	/// fills a deck laid out as the game deals it, the base cards last
+	void Deal(DeckShuffler& shuffler, uint8* deck) const;
+
+private:
+	DealTable() : _map(nullptr), _mapSize(0), _deals(nullptr), _count(0) { }
+	~DealTable() { Unload(); }
+
+	static bool CheckDeal(uint8 const* ranks);
+
+	void* _map;
+	size_t _mapSize;
+	uint8 const* _deals;
+	uint32 _count;
+};
+
+#define sDealTable DealTable::instance()
+
+#endif
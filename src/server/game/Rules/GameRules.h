@@ -0,0 +1,119 @@
+#ifndef _GAME_RULES_H
+#define _GAME_RULES_H
+
+#include "DealTable.h"
+#include "DeckShuffler.h"
+
+#include <algorithm>
+#include <cstring>
+
+/// card values are color << 4 | rank, the ranks go from 3 (0) to 2 (12), the jokers are 61 and 62
+#define CARD_RANK_ACE          11
+#define CARD_RANK_TWO          12
+#define CARD_RANK_SMALL_JOKER  13
+#define CARD_RANK_BIG_JOKER    14
+#define CARD_RANKS             15
+#define CARD_COLORS             4
+
+inline uint8 CardRank(uint8 card) { return card & 0x0f; }
+
+/// Rules of a game variant, a policy of RulesVariant resolved at compile time.
+/// A variant names its sizes and limits in the enum and deals its decks, the card classifier,
+/// the ai and the settlement of the variant are built from them.
+
+/// one deck, fully shuffled, grab scores from 0 to 3
+struct ClassicRules
+{
+	enum
+	{
+		SEATS           = 3,
+		DECK_CARDS      = 54,
+		HAND_CARDS      = 17,
+		BASE_CARDS      = 3,
+		MAX_GRAB_SCORE  = 3,
+		BOMB_DOUBLES    = 1,           /// doubles of the stake by a bomb or a rocket
+		SPRING_DOUBLES  = 1,
+		MAX_DOUBLES     = 16,
+		MIN_SINGLE_RUN  = 5,
+		MIN_PAIR_RUN    = 3,
+		MIN_TRIPLE_RUN  = 2,
+		FOUR_WITH_TWO   = 1
+	};
+
+	static char const* Name() { return "classic"; }
+
+	static void NewDeck(uint8* deck)
+	{
+		for (uint8 color = 0; color < CARD_COLORS; ++color)
+			for (uint8 rank = 0; rank < CARD_RANK_SMALL_JOKER; ++rank)
+				*deck++ = color << 4 | rank;
+		*deck++ = 61;
+		*deck++ = 62;
+	}
+
+	/// count decks shuffled one after the other, batched or not the sequence is the same
+	static void Deal(DeckShuffler& shuffler, uint8* decks, uint32 count)
+	{
+		uint8 deck[DECK_CARDS];
+		NewDeck(deck);
+		shuffler.ShuffleBatch(deck, decks, DECK_CARDS, count);
+	}
+};
+
+/// the deck is not shuffled: it stays sorted by rank but for a few swaps and a cut, and is
+/// dealt in packets of four, so the hands hold many bombs. The doubles of the stake are capped lower.
+/// With a deal table loaded the deals come from the table, built offline from the same shapes.
+struct NoShuffleRules : public ClassicRules
+{
+	enum
+	{
+		MAX_DOUBLES     = 6,
+		DEAL_PACKET     = 4,
+		SWAPS           = 8
+	};
+
+	static char const* Name() { return "no_shuffle"; }
+
+	static void Deal(DeckShuffler& shuffler, uint8* decks, uint32 count)
+	{
+		static_assert(DECK_CARDS == DEAL_TABLE_DECK && HAND_CARDS == DEAL_TABLE_HAND, "the deal table holds classic decks");
+
+		for (uint32 i = 0; i < count; ++i, decks += DECK_CARDS)
+		{
+			if (sDealTable->IsLoaded())
+				sDealTable->Deal(shuffler, decks);
+			else
+				Shape(shuffler, decks);
+		}
+	}
+
+	/// one deal built from the sorted deck, drawn from the shuffler
+	static void Shape(DeckShuffler& shuffler, uint8* deck)
+	{
+		uint8 pile[DECK_CARDS];
+		uint32 size = 0;
+		for (uint8 rank = 0; rank < CARD_RANK_SMALL_JOKER; ++rank)
+			for (uint8 color = 0; color < CARD_COLORS; ++color)
+				pile[size++] = color << 4 | rank;
+		pile[size++] = 61;
+		pile[size++] = 62;
+
+		/// one draw a statement, a replay must draw in the same order
+		for (uint32 swap = 0; swap < SWAPS; ++swap)
+		{
+			uint32 a = shuffler.Bounded(DECK_CARDS);
+			uint32 b = shuffler.Bounded(DECK_CARDS);
+			std::swap(pile[a], pile[b]);
+		}
+		std::rotate(pile, pile + shuffler.Bounded(DECK_CARDS), pile + DECK_CARDS);
+
+		/// packets go round the seats, the hands are laid out one after the other in the deck
+		uint32 filled[SEATS] = { 0 };
+		for (uint32 card = 0, seat = 0; card < SEATS * HAND_CARDS; seat = (seat + 1) % SEATS)
+			for (uint32 k = 0; k < DEAL_PACKET && filled[seat] < HAND_CARDS; ++k)
+				deck[seat * HAND_CARDS + filled[seat]++] = pile[card++];
+		memcpy(deck + SEATS * HAND_CARDS, pile + SEATS * HAND_CARDS, BASE_CARDS);
+	}
+};
+
+#endif
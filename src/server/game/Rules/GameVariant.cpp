@@ -0,0 +1,22 @@
+#include "GameVariant.h"
+
+namespace
+{
+	RulesVariant<ClassicRules> const ClassicVariant;
+	RulesVariant<NoShuffleRules> const NoShuffleVariant;
+
+	GameVariant const* const Variants[] = { &ClassicVariant, &NoShuffleVariant };
+}
+
+GameVariant const* GameVariant::Find(std::string const& name)
+{
+	for (GameVariant const* variant : Variants)
+		if (name == variant->GetName())
+			return variant;
+	return nullptr;
+}
+
+GameVariant const* GameVariant::GetClassic()
+{
+	return &ClassicVariant;
+}
@@ -0,0 +1,81 @@
+#ifndef _GAME_VARIANT_H
+#define _GAME_VARIANT_H
+
+#include "CardClassifier.h"
+#include "Util.h"
+
+#include <string>
+
+/// Rules a room plays by. A room picks its variant once, every call on it runs code compiled
+/// for the rules of the variant: the only dispatch is the virtual call itself.
+class GameVariant
+{
+public:
+	virtual ~GameVariant() { }
+
+	virtual char const* GetName() const = 0;
+
+	/// count decks dealt one after the other from the shuffler, the seats get HAND_CARDS each
+	/// in seat order and the base cards come last
+	virtual void Deal(DeckShuffler& shuffler, uint8* decks, uint32 count) const = 0;
+	virtual uint32 GetDeckSize() const = 0;
+
+	/// type of the cards played, CARD_TYPE_END for cards that are no play
+	virtual CardType Classify(uint8 const* cards, uint32 size) const = 0;
+	/// type of the cards a player plays from hand, CARD_TYPE_END unless they are all held and beat
+	/// the last play or pass on it. last is nullptr when the player leads.
+	virtual CardType CheckPlay(uint8 const* hand, uint8 const* cards, uint8 const* last, uint32 size) const = 0;
+
+	virtual int32 GetMaxGrabScore() const = 0;
+	/// score the ai grabs with, from the scores of its neighbours (-1 when they did not grab yet)
+	virtual int32 AiGrabScore(int32 leftScore, int32 rightScore) const = 0;
+
+	/// grab score, from 1 to the max grab score, doubled by the bombs and the spring of the round
+	virtual uint64 GetMultiplier(int32 grabScore, uint32 bombs, bool spring) const = 0;
+
+	/// variant of the given name, nullptr for a name no variant has
+	static GameVariant const* Find(std::string const& name);
+	static GameVariant const* GetClassic();
+};
+
+template<class Rules>
+class RulesVariant : public GameVariant
+{
+	/// the desks, the packets and the hands of the players are sized for these
+	static_assert(Rules::SEATS == 3 && Rules::HAND_CARDS == CARD_NUMBER && Rules::BASE_CARDS == 3,
+		"a desk seats three players with 17 cards and 3 base cards");
+	static_assert(Rules::SEATS * Rules::HAND_CARDS + Rules::BASE_CARDS == Rules::DECK_CARDS,
+		"the deck must be dealt out");
+
+public:
+	char const* GetName() const override { return Rules::Name(); }
+
+	void Deal(DeckShuffler& shuffler, uint8* decks, uint32 count) const override { Rules::Deal(shuffler, decks, count); }
+	uint32 GetDeckSize() const override { return Rules::DECK_CARDS; }
+
+	CardType Classify(uint8 const* cards, uint32 size) const override { return CardClassifier<Rules>::Classify(cards, size); }
+	CardType CheckPlay(uint8 const* hand, uint8 const* cards, uint8 const* last, uint32 size) const override
+	{
+		return CardClassifier<Rules>::CheckPlay(hand, cards, last, size);
+	}
+
+	int32 GetMaxGrabScore() const override { return Rules::MAX_GRAB_SCORE; }
+
+	int32 AiGrabScore(int32 leftScore, int32 rightScore) const override
+	{
+		if (leftScore == -1 && rightScore == -1)
+			return urand(0, Rules::MAX_GRAB_SCORE);
+		if (leftScore == 0 && rightScore == 0)
+			return 1;
+		return 0;
+	}
+
+	uint64 GetMultiplier(int32 grabScore, uint32 bombs, bool spring) const override
+	{
+		uint32 doubles = std::min<uint32>(bombs * Rules::BOMB_DOUBLES + (spring ? Rules::SPRING_DOUBLES : 0), Rules::MAX_DOUBLES);
+		int32 score = std::min<int32>(std::max(grabScore, 1), Rules::MAX_GRAB_SCORE);
+		return uint64(score) << doubles;
+	}
+};
+
+#endif
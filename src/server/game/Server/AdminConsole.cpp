@@ -0,0 +1,266 @@
+#include "AdminConsole.h"
+
+#include "GameVariant.h"
+#include "Log.h"
+#include "Player.h"
+#include "Room.h"
+#include "RoomManager.h"
+#include "TickProfiler.h"
+#include "Util.h"
+#include "World.h"
+
+#include <algorithm>
+#include <sstream>
+
+AdminConsole::Command const AdminConsole::Commands[] =
+{
+	{ "help",    "",                                    "this list",                                           &AdminConsole::HandleHelp },
+	{ "status",  "",                                    "players, desks and state of the world",               &AdminConsole::HandleStatus },
+	{ "rooms",   "",                                    "rooms with their players and desks",                  &AdminConsole::HandleRooms },
+	{ "player",  "<account>",                           "player logged in with the account",                   &AdminConsole::HandlePlayer },
+	{ "desk",    "<room> <desk>",                       "desk of a room, numbered from 0",                     &AdminConsole::HandleDesk },
+	{ "profile", "[reset]",                             "tick profiler statistics",                            &AdminConsole::HandleProfile },
+	{ "log",     "<logger|appender> <name> <level>",    "log level, 0 (disabled) to 6 (fatal)",                &AdminConsole::HandleLog },
+	{ "reload",  "",                                    "reloads worldserver.conf at the next world tick",     &AdminConsole::HandleReload },
+	{ "drain",   "",                                    "drains the server as SIGTERM does",                   &AdminConsole::HandleDrain },
+};
+
+void AdminConsole::Execute(std::string const& line, AdminReply const& reply)
+{
+	Arguments args;
+	Tokenizer tokens(line, ' ');
+	for (char const* token : tokens)
+		args.push_back(token);
+
+	if (args.empty())
+	{
+		reply("");
+		return;
+	}
+
+	for (Command const& command : Commands)
+	{
+		if (args[0] != command.name)
+			continue;
+
+		TC_LOG_DEBUG("server.admin", "Admin command: %s", line.c_str());
+		args.erase(args.begin());
+		(this->*command.handler)(args, reply);
+		return;
+	}
+
+	reply("unknown command '" + args[0] + "', try help\n");
+}
+
+bool AdminConsole::CheckSecret(std::string const& line) const
+{
+	if (_secret.empty())
+		return false;
+
+	uint8 diff = line.length() != _secret.length();
+	for (size_t i = 0; i < line.length(); ++i)
+		diff |= uint8(line[i] ^ _secret[i % _secret.length()]);
+	return diff == 0;
+}
+
+void AdminConsole::HandleHelp(Arguments const& /*args*/, AdminReply const& reply)
+{
+	std::ostringstream out;
+	for (Command const& command : Commands)
+	{
+		std::string usage = std::string(command.name) + (*command.usage ? " " : "") + command.usage;
+		out << usage << std::string(usage.length() < 40 ? 40 - usage.length() : 1, ' ') << command.help << "\n";
+	}
+	reply(out.str());
+}
+
+void AdminConsole::HandleStatus(Arguments const& /*args*/, AdminReply const& reply)
+{
+	uint32 rooms = 0;
+	sRoomMgr->ForEachRoom([&rooms](Room* /*room*/) { ++rooms; });
+
+	std::ostringstream out;
+	out << "players logged in: " << sRoomMgr->GetNumLoggedInPlayers() << "\n"
+		<< "rooms: " << rooms << ", desks in game: " << sRoomMgr->GetDeskCount() << "\n"
+		<< "config generation: " << sWorld->GetConfig()->generation << "\n"
+		<< "world loop: " << World::m_worldLoopCounter << (sWorld->IsDraining() ? ", draining" : "") << "\n";
+	reply(out.str());
+}
+
+void AdminConsole::HandleRooms(Arguments const& /*args*/, AdminReply const& reply)
+{
+	struct RoomLine
+	{
+		uint32 id;
+		char const* variant;
+		uint32 players;
+		uint32 desks;
+		uint32 waiting;
+		bool draining;
+
+		bool operator<(RoomLine const& other) const { return id < other.id; }
+	};
+
+	std::vector<RoomLine> lines;
+	sRoomMgr->ForEachRoom([&lines](Room* room)
+	{
+		RoomLine line;
+		line.id = room->getRoomId();
+		line.variant = room->GetVariant()->GetName();
+		line.players = room->GetPlayerCount();
+		line.desks = room->GetDeskCount();
+		line.waiting = room->GetMatchQueueSize();
+		line.draining = room->IsDraining();
+		lines.push_back(line);
+	});
+	std::sort(lines.begin(), lines.end());
+
+	std::ostringstream out;
+	out << "room  variant       players  desks  waiting\n";
+	for (RoomLine const& line : lines)
+	{
+		char text[128];
+		snprintf(text, sizeof(text), "%4u  %-12s  %7u  %5u  %7u%s\n", line.id, line.variant, line.players, line.desks, line.waiting,
+			line.draining ? "  draining" : "");
+		out << text;
+	}
+	reply(out.str());
+}
+
+/// seat of a desk, or a player out of a desk
+static void DescribePlayer(std::ostringstream& out, Player* player)
+{
+	out << player->getid() << " " << player->GetName()
+		<< (player->getPlayerType() == PLAYER_TYPE_USER ? "" : player->getPlayerType() == PLAYER_TYPE_AI ? " (ai)" : " (ai for the player)")
+		<< ": " << Player::getStateName(player->getGameStatus())
+		<< ", gold " << player->getPlayerInfo()->gold
+		<< ", cards " << player->getCardCount()
+		<< (player->autoPlay() ? ", auto-play" : "")
+		<< (player->GetSession() ? "" : ", no session");
+}
+
+void AdminConsole::HandlePlayer(Arguments const& args, AdminReply const& reply)
+{
+	if (args.size() != 1)
+	{
+		reply("usage: player <account>\n");
+		return;
+	}
+
+	uint32 id = strtoul(args[0].c_str(), nullptr, 10);
+	bool scheduled = sRoomMgr->ScheduleForPlayer(id, [id, reply](Room* room)
+	{
+		Player* player = room ? room->FindPlayer(id) : nullptr;
+		if (!player)
+		{
+			reply("player " + std::to_string(id) + " left meanwhile\n");
+			return;
+		}
+
+		std::ostringstream out;
+		out << "player ";
+		DescribePlayer(out, player);
+		out << "\nroom " << room->getRoomId();
+		if (Desk* desk = player->getDesk())
+			out << ", desk " << desk->getIndex() << " (" << Room::GetDeskStateName(room->GetDeskState(desk->getIndex())) << ")";
+		out << "\n";
+		reply(out.str());
+	});
+
+	if (!scheduled)
+		reply("no player logged in with account " + args[0] + "\n");
+}
+
+void AdminConsole::HandleDesk(Arguments const& args, AdminReply const& reply)
+{
+	if (args.size() != 2)
+	{
+		reply("usage: desk <room> <desk>\n");
+		return;
+	}
+
+	uint32 roomid = strtoul(args[0].c_str(), nullptr, 10);
+	uint32 index = strtoul(args[1].c_str(), nullptr, 10);
+	bool scheduled = sRoomMgr->ScheduleForRoom(roomid, [roomid, index, reply](Room* room)
+	{
+		Desk* desk = room ? room->GetDesk(index) : nullptr;
+		if (!desk)
+		{
+			reply("room " + std::to_string(roomid) + " has no desk " + std::to_string(index) + "\n");
+			return;
+		}
+
+		std::ostringstream out;
+		out << "desk " << index << " of room " << roomid << ": " << Room::GetDeskStateName(room->GetDeskState(index))
+			<< ", landlord " << desk->getLandlordId() << ", bombs " << desk->getBombCount() << "\n";
+		for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		{
+			out << "  seat " << uint32(seat) << ": ";
+			if (Player* player = desk->getSeat(seat))
+				DescribePlayer(out, player);
+			else
+				out << "left";
+			out << "\n";
+		}
+		reply(out.str());
+	});
+
+	if (!scheduled)
+		reply("no room " + args[0] + "\n");
+}
+
+void AdminConsole::HandleProfile(Arguments const& args, AdminReply const& reply)
+{
+	if (!sTickProfiler->IsEnabled())
+	{
+		reply("the tick profiler is off, see Profiler.Enable\n");
+		return;
+	}
+
+	reply(sTickProfiler->GetReport(!args.empty() && args[0] == "reset"));
+}
+
+void AdminConsole::HandleLog(Arguments const& args, AdminReply const& reply)
+{
+	if (args.size() != 3 || (args[0] != "logger" && args[0] != "appender"))
+	{
+		reply("usage: log <logger|appender> <name> <level>\n");
+		return;
+	}
+
+	uint32 level = strtoul(args[2].c_str(), nullptr, 10);
+	if (level > LOG_LEVEL_FATAL)
+	{
+		reply("log levels go from 0 (disabled) to 6 (fatal)\n");
+		return;
+	}
+
+	if (!sLog->SetLogLevel(args[1], args[2].c_str(), args[0] == "logger"))
+	{
+		reply("no " + args[0] + " " + args[1] + "\n");
+		return;
+	}
+
+	TC_LOG_INFO("server.admin", "Admin console: %s %s log level set to %u", args[0].c_str(), args[1].c_str(), level);
+	reply(args[0] + " " + args[1] + " logs at level " + args[2] + " until the next reload\n");
+}
+
+void AdminConsole::HandleReload(Arguments const& /*args*/, AdminReply const& reply)
+{
+	TC_LOG_INFO("server.admin", "Admin console: reloading worldserver.conf");
+	sWorld->RequestConfigReload();
+	reply("worldserver.conf is reloaded at the next world tick\n");
+}
+
+void AdminConsole::HandleDrain(Arguments const& /*args*/, AdminReply const& reply)
+{
+	if (sWorld->IsDraining())
+	{
+		reply("already draining\n");
+		return;
+	}
+
+	TC_LOG_INFO("server.admin", "Admin console: draining");
+	sWorld->RequestDrain();
+	reply("the server drains from the next world tick\n");
+}
@@ -0,0 +1,65 @@
+#ifndef _ADMIN_CONSOLE_H
+#define _ADMIN_CONSOLE_H
+
+#include "Define.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Takes the text answering a command, called once for each command, by the io thread that read
+/// the command or by the room thread that looked at the room
+typedef std::function<void(std::string const&)> AdminReply;
+
+/// Commands of the admin connections, one a line. They run on the thread reading the connection,
+/// never on the world thread: what they read about the world is safe to read from any thread, what
+/// they change is asked of the world for its next tick, and what they look at inside a room is read
+/// by the room thread at the end of its next update.
+class AdminConsole
+{
+public:
+	static AdminConsole* instance()
+	{
+		static AdminConsole instance;
+		return &instance;
+	}
+
+	void Execute(std::string const& line, AdminReply const& reply);
+
+	/// Admin.Secret, set before the console listens
+	void SetSecret(std::string const& secret) { _secret = secret; }
+	/// the line is the secret, compared in a time that does not depend on where they differ
+	bool CheckSecret(std::string const& line) const;
+
+private:
+	typedef std::vector<std::string> Arguments;
+	typedef void (AdminConsole::*Handler)(Arguments const& args, AdminReply const& reply);
+
+	struct Command
+	{
+		char const* name;
+		char const* usage;
+		char const* help;
+		Handler handler;
+	};
+
+	static Command const Commands[];
+
+	AdminConsole() { }
+
+	void HandleHelp(Arguments const& args, AdminReply const& reply);
+	void HandleStatus(Arguments const& args, AdminReply const& reply);
+	void HandleRooms(Arguments const& args, AdminReply const& reply);
+	void HandlePlayer(Arguments const& args, AdminReply const& reply);
+	void HandleDesk(Arguments const& args, AdminReply const& reply);
+	void HandleProfile(Arguments const& args, AdminReply const& reply);
+	void HandleLog(Arguments const& args, AdminReply const& reply);
+	void HandleReload(Arguments const& args, AdminReply const& reply);
+	void HandleDrain(Arguments const& args, AdminReply const& reply);
+
+	std::string _secret;
+};
+
+#define sAdminConsole AdminConsole::instance()
+
+#endif
@@ -0,0 +1,60 @@
+#include "AdminSocket.h"
+
+#if PLATFORM != PLATFORM_WINDOWS
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+
+AdminLocalAcceptor::AdminLocalAcceptor(boost::asio::io_service& ioService, std::string const& path) :
+	_acceptor(ioService), _socket(ioService), _path(path), _inode(0)
+{
+	unlink(path.c_str());
+
+	boost::system::error_code error;
+	_acceptor.open(Local(), error);
+	if (!error)
+		_acceptor.bind(Local::endpoint(path), error);
+	/// the user running the server only, before anyone can connect
+	if (!error && chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0)
+		error = boost::system::error_code(errno, boost::system::system_category());
+	if (!error)
+		_acceptor.listen(boost::asio::socket_base::max_connections, error);
+
+	if (error)
+	{
+		TC_LOG_ERROR("server.admin", "Admin console: can't listen at %s (%s)", path.c_str(), error.message().c_str());
+		_acceptor.close(error);
+		return;
+	}
+
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0)
+		_inode = st.st_ino;
+
+	AsyncAccept();
+}
+
+AdminLocalAcceptor::~AdminLocalAcceptor()
+{
+	if (!_acceptor.is_open())
+		return;
+
+	struct stat st;
+	if (stat(_path.c_str(), &st) == 0 && uint64(st.st_ino) == _inode)
+		unlink(_path.c_str());
+}
+
+void AdminLocalAcceptor::AsyncAccept()
+{
+	_acceptor.async_accept(_socket, [this](boost::system::error_code error)
+	{
+		if (error == boost::asio::error::operation_aborted)
+			return;
+
+		if (!error)
+			std::make_shared<AdminSocket<Local>>(std::move(_socket))->Start();
+
+		AsyncAccept();
+	});
+}
+#endif
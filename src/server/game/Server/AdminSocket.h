@@ -0,0 +1,109 @@
+#ifndef _ADMIN_SOCKET_H
+#define _ADMIN_SOCKET_H
+
+#include "AdminConsole.h"
+#include "Log.h"
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#define ADMIN_MAX_LINE_SIZE 1024
+
+/// Connection to the admin console, a command a line and its answer before the next line is read.
+/// Protocol is boost::asio::ip::tcp for the localhost port, or the Unix socket protocol.
+/// Any local user can connect to the port, its first line has to be Admin.Secret: a wrong one
+/// closes the connection. The Unix socket is left to the permissions of its file.
+/// The answer may be written from a room thread, the socket has no other operation pending then.
+template<class Protocol>
+class AdminSocket : public std::enable_shared_from_this<AdminSocket<Protocol>>
+{
+public:
+	typedef typename Protocol::socket SocketType;
+
+	explicit AdminSocket(SocketType&& socket) : _socket(std::move(socket)), _request(ADMIN_MAX_LINE_SIZE),
+		_authenticated(!std::is_same<Protocol, boost::asio::ip::tcp>::value) { }
+
+	void Start()
+	{
+		AsyncReadLine();
+	}
+
+private:
+	void AsyncReadLine()
+	{
+		std::shared_ptr<AdminSocket> self(this->shared_from_this());
+		boost::asio::async_read_until(_socket, _request, '\n', [self](boost::system::error_code error, std::size_t /*bytes*/)
+		{
+			/// a line longer than the buffer ends the connection as well
+			if (error)
+				return;
+
+			std::istream request(&self->_request);
+			std::string line;
+			std::getline(request, line);
+			if (!line.empty() && line[line.length() - 1] == '\r')
+				line.erase(line.length() - 1);
+
+			if (!self->_authenticated)
+			{
+				if (!sAdminConsole->CheckSecret(line))
+				{
+					TC_LOG_WARN("server.admin", "Admin console: wrong secret, connection closed");
+					return;
+				}
+
+				self->_authenticated = true;
+				self->AsyncWrite("welcome, try help\n");
+				return;
+			}
+
+			sAdminConsole->Execute(line, [self](std::string const& answer) { self->AsyncWrite(answer); });
+		});
+	}
+
+	void AsyncWrite(std::string const& answer)
+	{
+		_answer = answer;
+
+		std::shared_ptr<AdminSocket> self(this->shared_from_this());
+		boost::asio::async_write(_socket, boost::asio::buffer(_answer), [self](boost::system::error_code error, std::size_t /*bytes*/)
+		{
+			if (!error)
+				self->AsyncReadLine();
+		});
+	}
+
+	SocketType _socket;
+	boost::asio::streambuf _request;
+	std::string _answer;
+	bool _authenticated;
+};
+
+#if PLATFORM != PLATFORM_WINDOWS
+/// Accepts the admin connections on a Unix socket only the user running the server can use.
+/// The TCP ones go through AsyncAcceptor<AdminSocket<tcp>> bound to localhost.
+class AdminLocalAcceptor
+{
+public:
+	typedef boost::asio::local::stream_protocol Local;
+
+	/// replaces a socket file left at path, as a server taking over binds the path again
+	AdminLocalAcceptor(boost::asio::io_service& ioService, std::string const& path);
+	/// removes the socket file, unless another server bound the path since
+	~AdminLocalAcceptor();
+
+	bool IsOpen() const { return _acceptor.is_open(); }
+
+private:
+	void AsyncAccept();
+
+	Local::acceptor _acceptor;
+	Local::socket _socket;
+	std::string _path;
+	uint64 _inode;
+};
+#endif
+
+#endif
@@ -0,0 +1,296 @@
+#include "ClusterNode.h"
+
+#include "Log.h"
+#include "Player.h"
+#include "Room.h"
+#include "RoomManager.h"
+#include "World.h"
+#include "WorldSocket.h"
+
+void RoutedClient::CloseSocket()
+{
+	if (_closed.exchange(true))
+		return;
+
+	if (std::shared_ptr<ClusterNodeSocket> link = _link.lock())
+	{
+		link->SendMessage(CLUSTER_CLIENT_CLOSE, _id, nullptr, 0);
+		link->RemoveClient(_id);
+	}
+}
+
+void RoutedClient::AsyncWrite(WorldPacket& packet)
+{
+	if (_closed)
+		return;
+
+	AsyncWriteShared(SerializePacket(packet));
+}
+
+void RoutedClient::AsyncWriteShared(SharedPacketBuffer const& buffer)
+{
+	if (_closed)
+		return;
+
+	std::shared_ptr<ClusterNodeSocket> link = _link.lock();
+	if (!link)
+		return;
+
+	RecordOutgoing(buffer);
+	link->SendMessage(CLUSTER_CLIENT_DATA, _id, buffer->data(), buffer->size());
+}
+
+std::string RoutedClient::GetRemoteAddress() const
+{
+	return "router client " + std::to_string(_id);
+}
+
+void RoutedClient::HandlePacket(uint8 const* data, std::size_t size)
+{
+	ClientPktHeader const* header = reinterpret_cast<ClientPktHeader const*>(data);
+	if (size < sizeof(ClientPktHeader) || !header->IsValid() || header->size != size)
+	{
+		TC_LOG_ERROR("network", "RoutedClient::HandlePacket: router client %u sent a malformed packet (%u bytes)", _id, uint32(size));
+		CloseSocket();
+		return;
+	}
+
+	WorldPacket packet(header->cmd, size - sizeof(ClientPktHeader));
+	packet.append(data + sizeof(ClientPktHeader), size - sizeof(ClientPktHeader));
+
+	RecordIncoming(header->cmd, header->size);
+
+	if (!ProcessIncoming(packet))
+		CloseSocket();
+}
+
+void ClusterNodeSocket::CloseSocket()
+{
+	Base::CloseSocket();
+
+	ClientMapType clients;
+	{
+		std::lock_guard<std::mutex> lock(_clientsLock);
+		clients.swap(_clients);
+	}
+
+	/// their sessions end at the next world update, the players at a desk can resume
+	for (ClientMapType::iterator itr = clients.begin(); itr != clients.end(); ++itr)
+		itr->second->CloseByRouter();
+
+	sClusterNode->OnLinkClosed(this);
+}
+
+void ClusterNodeSocket::SendMessage(uint16 type, uint32 client, void const* data, std::size_t size)
+{
+	if (!IsOpen())
+		return;
+
+	std::lock_guard<std::mutex> guard(_writeLock);
+
+	bool needsWriteStart = _writeQueue.empty();
+
+	_writeQueue.push(BuildClusterMessage(type, client, data, size));
+
+	if (needsWriteStart)
+		AsyncWrite(_writeQueue.front());
+}
+
+void ClusterNodeSocket::SendIds(uint16 type, std::vector<uint32> const& ids)
+{
+	/// one message at least, an empty room list means no new player
+	std::size_t offset = 0;
+	do
+	{
+		std::size_t count = std::min<std::size_t>(ids.size() - offset, CLUSTER_MAX_IDS);
+		SendMessage(type, 0, ids.data() + offset, count * sizeof(uint32));
+		offset += count;
+	} while (offset < ids.size());
+}
+
+void ClusterNodeSocket::RemoveClient(uint32 id)
+{
+	std::lock_guard<std::mutex> lock(_clientsLock);
+	_clients.erase(id);
+}
+
+void ClusterNodeSocket::ReadHeaderHandler()
+{
+	ClusterHeader* header = reinterpret_cast<ClusterHeader*>(GetHeaderBuffer());
+	if (header->type != CLUSTER_CLIENT_DATA && header->type != CLUSTER_CLIENT_CLOSE)
+	{
+		TC_LOG_ERROR("server.cluster", "Cluster: the router sent an unknown message (type %u), closing the link", uint32(header->type));
+		CloseSocket();
+		return;
+	}
+
+	AsyncReadData(header->size);
+}
+
+void ClusterNodeSocket::ReadDataHandler()
+{
+	ClusterHeader* header = reinterpret_cast<ClusterHeader*>(GetHeaderBuffer());
+
+	if (header->type == CLUSTER_CLIENT_DATA)
+	{
+		std::shared_ptr<RoutedClient> client;
+		{
+			std::lock_guard<std::mutex> lock(_clientsLock);
+			std::shared_ptr<RoutedClient>& routed = _clients[header->client];
+			if (!routed)
+				routed = std::make_shared<RoutedClient>(shared_from_this(), header->client);
+			client = routed;
+		}
+
+		client->HandlePacket(GetDataBuffer(), GetDataSize());
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(_clientsLock);
+		ClientMapType::iterator itr = _clients.find(header->client);
+		if (itr != _clients.end())
+		{
+			itr->second->CloseByRouter();
+			_clients.erase(itr);
+		}
+	}
+
+	AsyncReadHeader();
+}
+
+void ClusterNode::Start(boost::asio::io_service& ioService, std::string const& router, uint32 nodeId)
+{
+	_ioService = &ioService;
+	_nodeId = nodeId;
+
+	std::string::size_type colon = router.rfind(':');
+	boost::system::error_code error;
+	tcp::resolver::iterator endpoint;
+	if (colon != std::string::npos)
+	{
+		tcp::resolver resolver(ioService);
+		endpoint = resolver.resolve(tcp::resolver::query(router.substr(0, colon), router.substr(colon + 1)), error);
+	}
+
+	if (colon == std::string::npos || error || endpoint == tcp::resolver::iterator())
+	{
+		TC_LOG_ERROR("server.cluster", "Cluster: can't resolve the router %s, Cluster.Router is host:port", router.c_str());
+		return;
+	}
+
+	_router = *endpoint;
+	_reconnectTimer.reset(new boost::asio::steady_timer(ioService));
+	TC_LOG_INFO("server.cluster", "Cluster: node %u, connecting to the router at %s", _nodeId, router.c_str());
+	AsyncConnect();
+}
+
+void ClusterNode::Stop()
+{
+	std::shared_ptr<ClusterNodeSocket> link;
+	{
+		std::lock_guard<std::mutex> lock(_linkLock);
+		_stopped = true;
+		link.swap(_link);
+	}
+
+	if (link)
+		link->CloseSocket();
+}
+
+void ClusterNode::AsyncConnect()
+{
+	_connecting.reset(new tcp::socket(*_ioService));
+	_connecting->async_connect(_router, [this](boost::system::error_code const& error)
+	{
+		std::lock_guard<std::mutex> lock(_linkLock);
+		if (_stopped)
+			return;
+
+		if (error)
+		{
+			TC_LOG_DEBUG("server.cluster", "Cluster: the router does not answer (%s)", error.message().c_str());
+			_reconnectTimer->expires_from_now(std::chrono::milliseconds(CLUSTER_RECONNECT_DELAY));
+			_reconnectTimer->async_wait([this](boost::system::error_code const& timerError)
+			{
+				if (!timerError)
+					AsyncConnect();
+			});
+			return;
+		}
+
+		boost::system::error_code optionError;
+		_connecting->set_option(tcp::no_delay(true), optionError);
+
+		_link = std::make_shared<ClusterNodeSocket>(std::move(*_connecting));
+		_link->Start();
+		TC_LOG_INFO("server.cluster", "Cluster: connected to the router as node %u", _nodeId);
+
+		uint32 hello[2] = { CLUSTER_PROTOCOL_VERSION, _nodeId };
+		_link->SendMessage(CLUSTER_NODE_HELLO, 0, hello, sizeof(hello));
+		SendRoomsLocked();
+
+		/// the router may have restarted, it learns again where the players in game are
+		std::vector<uint32> players;
+		sRoomMgr->ForEachPlayer([&players](uint32 id, Player* /*player*/) { players.push_back(id); });
+		if (!players.empty())
+			_link->SendIds(CLUSTER_PLAYER_ENTER, players);
+	});
+}
+
+void ClusterNode::OnLinkClosed(ClusterNodeSocket* link)
+{
+	std::lock_guard<std::mutex> lock(_linkLock);
+	if (_link.get() != link)
+		return;
+
+	_link.reset();
+	if (_stopped)
+		return;
+
+	TC_LOG_ERROR("server.cluster", "Cluster: lost the router, the clients it routed are closed, connecting again");
+	_reconnectTimer->expires_from_now(std::chrono::milliseconds(CLUSTER_RECONNECT_DELAY));
+	_reconnectTimer->async_wait([this](boost::system::error_code const& error)
+	{
+		if (!error)
+			AsyncConnect();
+	});
+}
+
+void ClusterNode::SendRooms()
+{
+	std::lock_guard<std::mutex> lock(_linkLock);
+	SendRoomsLocked();
+}
+
+void ClusterNode::SendRoomsLocked()
+{
+	if (!_link)
+		return;
+
+	/// a draining server or room finishes the games in progress, new players go to another node
+	std::vector<uint32> rooms;
+	if (!sWorld->IsDraining())
+	{
+		sRoomMgr->ForEachRoom([&rooms](Room* room)
+		{
+			if (!room->IsDraining())
+				rooms.push_back(room->getRoomId());
+		});
+	}
+
+	_link->SendIds(CLUSTER_NODE_ROOMS, rooms);
+}
+
+void ClusterNode::SendPlayerEnter(uint32 id)
+{
+	std::lock_guard<std::mutex> lock(_linkLock);
+	if (_link)
+		_link->SendIds(CLUSTER_PLAYER_ENTER, std::vector<uint32>(1, id));
+}
+
+void ClusterNode::SendPlayerLeave(uint32 id)
+{
+	std::lock_guard<std::mutex> lock(_linkLock);
+	if (_link)
+		_link->SendIds(CLUSTER_PLAYER_LEAVE, std::vector<uint32>(1, id));
+}
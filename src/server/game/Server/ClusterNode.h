@@ -0,0 +1,122 @@
+#ifndef _CLUSTER_NODE_H
+#define _CLUSTER_NODE_H
+
+#include "ClusterProtocol.h"
+#include "Socket.h"
+#include "WorldConnection.h"
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define CLUSTER_RECONNECT_DELAY 5000              /// ms between two attempts to reach the router
+
+class ClusterNodeSocket;
+
+/// Client connected to the router, its packets come over the link of the node
+class RoutedClient : public WorldConnection, public std::enable_shared_from_this<RoutedClient>
+{
+public:
+	RoutedClient(std::shared_ptr<ClusterNodeSocket> const& link, uint32 id) : _link(link), _id(id), _closed(false) { }
+
+	bool IsOpen() const override { return !_closed; }
+	/// has the router close the client connection
+	void CloseSocket() override;
+	void AsyncWrite(WorldPacket& packet) override;
+	void AsyncWriteShared(SharedPacketBuffer const& buffer) override;
+	std::string GetRemoteAddress() const override;
+
+	/// packet of the client, as it came over the link
+	void HandlePacket(uint8 const* data, std::size_t size);
+	/// the router closed the client connection, or the link to it is gone
+	void CloseByRouter() { _closed = true; }
+
+protected:
+	std::shared_ptr<WorldConnection> GetSharedConnection() override { return shared_from_this(); }
+
+private:
+	std::weak_ptr<ClusterNodeSocket> _link;
+	uint32 _id;
+	std::atomic<bool> _closed;
+};
+
+/// Connection of the node to the router, one for all the clients routed to the node
+class ClusterNodeSocket : public Socket<ClusterNodeSocket, std::vector<uint8>>
+{
+	typedef Socket<ClusterNodeSocket, std::vector<uint8>> Base;
+
+public:
+	explicit ClusterNodeSocket(tcp::socket&& socket) : Base(std::move(socket), sizeof(ClusterHeader)) { }
+
+	void Start() override { AsyncReadHeader(); }
+	/// the routed clients are closed with the link, the node connects again
+	void CloseSocket() override;
+
+	void SendMessage(uint16 type, uint32 client, void const* data, std::size_t size);
+	void SendIds(uint16 type, std::vector<uint32> const& ids);
+	void RemoveClient(uint32 id);
+
+protected:
+	void ReadHeaderHandler() override;
+	void ReadDataHandler() override;
+
+private:
+	typedef std::unordered_map<uint32, std::shared_ptr<RoutedClient>> ClientMapType;
+
+	std::mutex _clientsLock;
+	ClientMapType _clients;
+};
+
+/// Game node of a cluster: the server connects to the router at Cluster.Router, which sends it the
+/// players of the rooms it opens. The router learns from the node the rooms taking new players, the
+/// ones of a draining room or server go to another node, and the accounts in game at the node, they
+/// come back to it when they log in again or resume.
+/// The link is set up again while the router is down, the clients routed are closed with it.
+class ClusterNode
+{
+public:
+	static ClusterNode* instance()
+	{
+		static ClusterNode instance;
+		return &instance;
+	}
+
+	/// router is host:port
+	void Start(boost::asio::io_service& ioService, std::string const& router, uint32 nodeId);
+	void Stop();
+
+	/// the rooms taking new players changed: rooms opened or drained at a reload, server draining
+	void SendRooms();
+	void SendPlayerEnter(uint32 id);
+	void SendPlayerLeave(uint32 id);
+
+private:
+	friend class ClusterNodeSocket;
+
+	ClusterNode() : _ioService(nullptr), _nodeId(0), _stopped(false) { }
+
+	void AsyncConnect();
+	void OnLinkClosed(ClusterNodeSocket* link);
+	/// under _linkLock
+	void SendRoomsLocked();
+
+	boost::asio::io_service* _ioService;
+	tcp::endpoint _router;
+	uint32 _nodeId;
+	std::unique_ptr<tcp::socket> _connecting;
+	std::unique_ptr<boost::asio::steady_timer> _reconnectTimer;
+
+	/// the link and what is sent on it: the lists sent when the link comes up and the changes
+	/// after them keep their order
+	std::mutex _linkLock;
+	std::shared_ptr<ClusterNodeSocket> _link;
+	bool _stopped;
+};
+
+#define sClusterNode ClusterNode::instance()
+
+#endif
@@ -23,4 +23,8 @@ OpcodeHandler opcodeTable[NUM_MSG_TYPES] =
 	/*0x0F*/{ "CMSG_PING",                       &WorldSession::Handle_NULL },
 	/*0x10*/{ "CMSG_LOG_OUT",                    &WorldSession::HandlLogout },
 	/*0x11*/{ "CMSG_INCREMENT_GOLD",             &WorldSession::Handle_NULL },
+	/*0x12*/{ "CMSG_PLAYER_RESUME",              &WorldSession::HandlePlayerResume },
+	/*0x13*/{ "CMSG_AUTO_PLAY",                  &WorldSession::HandleAutoPlay },
+	/*0x14*/{ "SMSG_SERVER_NOTICE",              &WorldSession::Handle_NULL },
+	/*0x15*/{ "CMSG_SPECTATE",                   &WorldSession::Handle_NULL },
 };
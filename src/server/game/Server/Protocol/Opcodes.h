@@ -47,7 +47,11 @@ enum Opcodes
 	CMSG_PING                       = 0x0F,                           /// 15
 	CMSG_LOG_OUT                    = 0x10,						      /// 16˳
 	CMSG_INCREMENT_GOLD             = 0x11,                           /// 17ӽҷ
-    NUM_MSG_TYPES                   = 0x12
+	CMSG_PLAYER_RESUME              = 0x12,                           /// 18
+	CMSG_AUTO_PLAY                  = 0x13,                           /// 19й
+	SMSG_SERVER_NOTICE              = 0x14,                           /// 20 server notice, see ServerNotice
+	CMSG_SPECTATE                   = 0x15,                           /// 21 watch the desk of an account, see SpectateResult
+    NUM_MSG_TYPES                   = 0x16
 };
 
 
@@ -0,0 +1,165 @@
+#include "WorldConnection.h"
+
+#include "Log.h"
+#include "Metrics.h"
+#include "Opcodes.h"
+#include "ServerPktHeader.h"
+#include "SpectatorMgr.h"
+#include "WorldPacket.h"
+#include "WorldSession.h"
+#include "World.h"
+
+#include <sstream>
+
+namespace
+{
+	/// packets and bytes per opcode and direction, registered once on first use
+	struct OpcodeMetrics
+	{
+		explicit OpcodeMetrics(char const* direction)
+		{
+			for (uint32 opcode = 0; opcode < NUM_MSG_TYPES; ++opcode)
+			{
+				std::ostringstream labels;
+				labels << "opcode=\"" << LookupOpcodeName(opcode) << "\",direction=\"" << direction << "\"";
+
+				packets[opcode] = sMetrics->GetCounter("landlord_packets_total", labels.str());
+				bytes[opcode] = sMetrics->GetCounter("landlord_packet_bytes_total", labels.str());
+			}
+		}
+
+		void Record(uint32 opcode, std::size_t size)
+		{
+			if (opcode >= NUM_MSG_TYPES)
+				return;
+
+			packets[opcode]->Add();
+			bytes[opcode]->Add(size);
+		}
+
+		MetricCounter* packets[NUM_MSG_TYPES];
+		MetricCounter* bytes[NUM_MSG_TYPES];
+	};
+
+	OpcodeMetrics& IncomingMetrics()
+	{
+		static OpcodeMetrics metrics("in");
+		return metrics;
+	}
+
+	OpcodeMetrics& OutgoingMetrics()
+	{
+		static OpcodeMetrics metrics("out");
+		return metrics;
+	}
+} // namespace
+
+void WorldConnection::RecordIncoming(uint32 opcode, std::size_t size)
+{
+	IncomingMetrics().Record(opcode, size);
+}
+
+void WorldConnection::RecordOutgoing(uint32 opcode, std::size_t size)
+{
+	OutgoingMetrics().Record(opcode, size);
+}
+
+void WorldConnection::RecordOutgoing(SharedPacketBuffer const& buffer)
+{
+	uint32 opcode;
+	memcpy(&opcode, buffer->data() + sizeof(uint32), sizeof(opcode));
+	OutgoingMetrics().Record(opcode, buffer->size());
+}
+
+SharedPacketBuffer WorldConnection::SerializePacket(WorldPacket const& packet)
+{
+	uint32 opcode = packet.GetOpcode();
+	/// the size counts the header, as WorldSocket writes it
+	ServerPktHeader header(packet.size() + sizeof(opcode) * 2, opcode);
+
+	std::shared_ptr<std::vector<uint8>> buffer = std::make_shared<std::vector<uint8>>(header.getHeaderLength() + packet.size());
+	memcpy(buffer->data(), header.header, header.getHeaderLength());
+	if (!packet.empty())
+		memcpy(buffer->data() + header.getHeaderLength(), packet.contents(), packet.size());
+	return buffer;
+}
+
+bool WorldConnection::ProcessIncoming(WorldPacket& packet)
+{
+	packet.read_skip<uint32[2]>();
+
+	switch (packet.GetOpcode())
+	{
+		case CMSG_PLAYER_LOGIN:
+			if (_worldSession)
+			{
+				TC_LOG_ERROR("network", "WorldSocket::ProcessIncoming: received duplicate CMSG_AUTH_SESSION from %s", _worldSession->GetPlayerInfo().c_str());
+				break;
+			}
+
+			StopSpectating();
+			AddSession(packet.peek<uint32>(20), packet);
+			break;
+		case CMSG_PLAYER_RESUME:
+			if (_worldSession)
+			{
+				TC_LOG_ERROR("network", "WorldSocket::ProcessIncoming: received CMSG_PLAYER_RESUME from logged in %s", _worldSession->GetPlayerInfo().c_str());
+				break;
+			}
+
+			StopSpectating();
+			AddSession(packet.peek<uint32>(8), packet);
+			break;
+		case CMSG_SPECTATE:
+		{
+			if (_worldSession)
+			{
+				TC_LOG_ERROR("network", "WorldSocket::ProcessIncoming: received CMSG_SPECTATE from logged in %s", _worldSession->GetPlayerInfo().c_str());
+				break;
+			}
+
+			/// handled here, the room updating the desk does not see its spectators
+			StopSpectating();
+			_spectating = sSpectatorMgr->Subscribe(packet.peek<uint32>(8), GetSharedConnection());
+			break;
+		}
+		case CMSG_PING:
+			if (_worldSession)
+				_worldSession->ResetTimeOutTime();
+			break;
+
+		default:
+		{
+			if (!_worldSession)
+			{
+				TC_LOG_ERROR("network.opcode", "ProcessIncoming: Client not authed opcode = %u", uint32(packet.GetOpcode()));
+				return false;
+			}
+
+			// Our Idle timer will reset on any non PING opcodes.
+			// Catches people idling on the login screen and any lingering ingame connections.
+			_worldSession->ResetTimeOutTime();
+
+			// Copy the packet to the heap before enqueuing
+			_worldSession->QueuePacket(new WorldPacket(std::move(packet)));
+			break;
+		}
+	}
+
+	return true;
+}
+
+void WorldConnection::AddSession(uint32 accountId, WorldPacket& recvPacket)
+{
+	_worldSession = new WorldSession(accountId, GetSharedConnection());
+	_worldSession->QueuePacket(new WorldPacket(std::move(recvPacket)));
+	_worldSession->ResetTimeOutTime();
+	sWorld->AddSession(_worldSession);
+}
+
+void WorldConnection::StopSpectating()
+{
+	if (std::shared_ptr<SpectatorChannel> channel = _spectating.lock())
+		channel->Unsubscribe(this);
+	_spectating.reset();
+}
@@ -0,0 +1,57 @@
+#ifndef _WORLD_CONNECTION_H
+#define _WORLD_CONNECTION_H
+
+#include "Define.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class SpectatorChannel;
+class WorldPacket;
+class WorldSession;
+
+/// packet serialized with its header once, written as is to any number of clients
+typedef std::shared_ptr<std::vector<uint8> const> SharedPacketBuffer;
+
+/// Connection of a WorldSession to its client: a WorldSocket the server accepted, or a client the
+/// cluster router forwards over the link of the node (RoutedClient).
+class WorldConnection
+{
+public:
+	WorldConnection() : _worldSession(nullptr) { }
+	virtual ~WorldConnection() { }
+
+	virtual bool IsOpen() const = 0;
+	virtual void CloseSocket() = 0;
+	virtual void AsyncWrite(WorldPacket& packet) = 0;
+	/// buffer from SerializePacket, shared with the other clients it goes to
+	virtual void AsyncWriteShared(SharedPacketBuffer const& buffer) = 0;
+	virtual std::string GetRemoteAddress() const = 0;
+
+	/// the packet with the header the client expects
+	static SharedPacketBuffer SerializePacket(WorldPacket const& packet);
+
+protected:
+	/// hands a packet of the client to its session, the login or the resume creates the session.
+	/// False when the client sent anything else before, the connection has to close then.
+	bool ProcessIncoming(WorldPacket& packet);
+
+	/// landlord_packets_total and landlord_packet_bytes_total, per opcode and direction
+	static void RecordIncoming(uint32 opcode, std::size_t size);
+	static void RecordOutgoing(uint32 opcode, std::size_t size);
+	static void RecordOutgoing(SharedPacketBuffer const& buffer);
+
+	virtual std::shared_ptr<WorldConnection> GetSharedConnection() = 0;
+
+	WorldSession* _worldSession;
+
+private:
+	void AddSession(uint32 accountId, WorldPacket& recvPacket);
+	/// a connection watches one desk at a time, and none once logged in
+	void StopSpectating();
+
+	std::weak_ptr<SpectatorChannel> _spectating;
+};
+
+#endif
@@ -20,13 +20,21 @@
     \ingroup u2w
 */
 
-#include "WorldSocket.h"
+#include "WorldConnection.h"
+#include "AiPlayerPool.h"
 #include "Config.h"
 #include "Common.h"
+#include "Desk.h"
+#include "EventProcessor.h"
+#include "GameVariant.h"
+#include "Handoff.h"
 #include "Log.h"
 #include "Opcodes.h"
 #include "Player.h"
+#include "PlayerStore.h"
 #include "RoomManager.h"
+#include "Tournament.h"
+#include "Util.h"
 #include "WorldPacket.h"
 #include "WorldSession.h"
 #include "World.h"
@@ -34,18 +42,45 @@
 namespace 
 {
 	char const * DefaultPlayerName = "<none>";
+
+	/// Closes the socket of a session which received nothing for SocketTimeOutTime
+	class SessionTimeOutEvent : public BasicEvent
+	{
+	public:
+		SessionTimeOutEvent(WorldSession* session, EventProcessor& events) : _session(session), _events(events) { }
+
+		bool Execute(uint64 e_time, uint32 /*p_time*/) override
+		{
+			uint32 timeout = sWorld->getIntConfig(CONFIG_SOCKET_TIMEOUTTIME);
+			uint32 idle = GetMSTimeDiffToNow(_session->GetLastActivity());
+
+			/// a packet came meanwhile, due again when the session would have been silent long enough
+			if (idle < timeout)
+				_events.AddEvent(this, e_time + timeout - idle);
+			else
+				_session->TimeOut();
+
+			/// owned by the session
+			return false;
+		}
+
+	private:
+		WorldSession* _session;
+		EventProcessor& _events;
+	};
 } // namespace
 
 /// WorldSession constructor
-WorldSession::WorldSession(uint32 id, std::shared_ptr<WorldSocket> sock):
+WorldSession::WorldSession(uint32 id, std::shared_ptr<WorldConnection> sock):
     _Socket(sock),
     _accountId(id),
 	_player(nullptr),
+	_timeOutEvent(nullptr),
 	_forceExit(false)
 {
     if (sock)
     {
-        _Address = sock->GetRemoteIpAddress().to_string();
+        _Address = sock->GetRemoteAddress();
 		ResetTimeOutTime();
     }
 }
@@ -56,7 +91,7 @@ WorldSession::~WorldSession()
 	/// not login game
 	if (_player != nullptr)
 	{
-		_player->logOutPlayer();
+		_player->disconnect();
 	}
     /// - If have unclosed socket, close it
     if (_Socket)
@@ -69,6 +104,23 @@ WorldSession::~WorldSession()
     WorldPacket* packet = NULL;
     while (_recvQueue.next(packet))
         delete packet;
+
+    delete _timeOutEvent;
+}
+
+void WorldSession::StartTimeOutTimer(EventProcessor& events)
+{
+	if (_timeOutEvent)
+		return;
+
+	_timeOutEvent = new SessionTimeOutEvent(this, events);
+	events.AddEvent(_timeOutEvent, events.CalculateTime(sWorld->getIntConfig(CONFIG_SOCKET_TIMEOUTTIME)));
+}
+
+void WorldSession::TimeOut()
+{
+	if (_Socket)
+		_Socket->CloseSocket();
 }
 
 char const * WorldSession::GetPlayerName() const
@@ -137,14 +189,8 @@ void WorldSession::QueuePacket(WorldPacket* new_packet)
 
 /// Update the WorldSession (triggered by World update)
 
-bool WorldSession::Update(uint32 diff)
+bool WorldSession::Update(uint32 /*diff*/)
 {   
-	/// Update Timeout timer.
-	UpdateTimeOutTime(diff);
-
-	if (IsTimeOutTime())
-		_Socket->CloseSocket();
-
     WorldPacket* packet = NULL;
 
     uint32 processedPackets = 0;
@@ -191,6 +237,17 @@ void WorldSession::SendLoginError(uint8 code)
 	SendPacket(&packet);
 }
 
+void WorldSession::SendServerNotice(ServerNotice notice, uint32 value)
+{
+	WorldPacket packet(SMSG_SERVER_NOTICE, 16);
+	packet << uint32(0);
+	packet << uint32(0);
+	packet << uint32(notice);
+	packet << uint32(value);
+
+	SendPacket(&packet);
+}
+
 void WorldSession::HandlePlayerLogin(WorldPacket& recvPacket)
 {
 	uint32 spaceid,roomid, SameRoom;
@@ -198,20 +255,58 @@ void WorldSession::HandlePlayerLogin(WorldPacket& recvPacket)
 
 	recvPacket >>spaceid>> roomid >> SameRoom;
 	recvPacket.read((uint8 *)&pInfo, sizeof(PlayerInfo));
-	if (sRoomMgr->getPlayer(pInfo.id))
+	if (sWorld->IsDraining())
 	{
+		/// the client connects to the server taking over
+		SendServerNotice(SERVER_NOTICE_DRAIN, 0);
+		SendLoginError(LOGIN_RESULT_FAILED);
+		TC_LOG_INFO("server.worldserver", "Account %u login refused, the server is draining, remote IP: %s", getAccountId(), _Address.c_str());
+		return;
+	}
 
+	if (pInfo.id >= AI_PLAYER_BASE_ID)
+	{
+		/// the ids with the high bit set are the ai players'
+		SendLoginError(LOGIN_RESULT_FAILED);
+		TC_LOG_INFO("server.worldserver", "Account %u login refused, the id belongs to the ai players, remote IP: %s", pInfo.id, _Address.c_str());
+		return;
+	}
+
+	Player* player = sRoomMgr->getPlayer(pInfo.id);
+	if ((player && !player->LogOut()) || sHandoff->IsHeldByPredecessor(pInfo.id))
+	{
+		/// the desk of the old connection is still playing, a new player would take the same seat id
+		SendLoginError(LOGIN_RESULT_IN_GAME);
+		TC_LOG_INFO("server.worldserver", "Account %u login refused, still in game, remote IP: %s", getAccountId(), _Address.c_str());
+		return;
 	}
 	else
 	{
+		/// progress saved by the server wins over the one sent by the client
+		PlayerRecord record;
+		if (sPlayerStore->Load(pInfo.id, record))
+			PlayerStore::ApplyRecord(record, pInfo);
+		else
+			sPlayerStore->Save(pInfo);
+
 		_player = new Player(this);
 		_player->loadData(pInfo);
 		_player->setRoomId(roomid);
-		sRoomMgr->AddPlayer(roomid, _player);
+		_player->setResumeToken(rand_secure());
+		if (!sRoomMgr->AddPlayer(roomid, _player))
+		{
+			/// the room is closed or draining, the client picks another one
+			delete _player;
+			_player = nullptr;
+			SendLoginError(LOGIN_RESULT_FAILED);
+			TC_LOG_INFO("server.worldserver", "Account %u login refused, room %u is not open, remote IP: %s", getAccountId(), roomid, _Address.c_str());
+			return;
+		}
 
 		WorldPacket packet(CMSG_PLAYER_LOGIN,600);
 
-		packet << uint32(0) << uint32(0) << uint32(1);
+		packet << uint32(0) << uint32(0) << uint32(LOGIN_RESULT_OK);
+		packet << _player->getResumeToken();
 
 		packet.resize(600);
 
@@ -222,33 +317,118 @@ void WorldSession::HandlePlayerLogin(WorldPacket& recvPacket)
 
 void WorldSession::HandleWaitStart(WorldPacket& recvPacket)
 {
-	getPlayer()->setStart();
+	Player* player = getPlayer();
+
+	/// the tournament starts the games of its players
+	Tournament* tournament = player->getRoom() ? player->getRoom()->GetTournament() : nullptr;
+	if (tournament && tournament->IsPlaying(player->getid()))
+		return;
+
+	player->setStart();
 }
 
 void WorldSession::HandleGrabLandlord(WorldPacket& recvPacket)
 {
-	recvPacket >> getPlayer()->_grabLandlordScore;
+	Player * player = getPlayer();
 
-	getPlayer()->setGameStatus(GAME_STATUS_GRABING_LANDLORD);
+	/// the player is back, a turn the ai already played for them is not played twice
+	if (player->autoPlay())
+	{
+		player->setAutoPlay(false);
+		if (!player->isTurnToGrab())
+			return;
+	}
+
+	int32 score;
+	recvPacket >> score;
+
+	/// the stake of the round is multiplied by the score, it is taken only in turn and in range
+	Desk* desk = player->getDesk();
+	if (!desk || !player->isTurnToGrab() || score < -1 || score > desk->getVariant()->GetMaxGrabScore())
+	{
+		TC_LOG_DEBUG("network.opcode", "Dropped grab score %d sent out of turn or out of range by %s", score, GetPlayerInfo().c_str());
+		return;
+	}
+
+	player->_grabLandlordScore = score;
+	player->setGameStatus(GAME_STATUS_GRABING_LANDLORD);
 }
 
 void WorldSession::HandleOutCards(WorldPacket& recvPacket)
 {
 	Player * player = getPlayer();
 
-	recvPacket.read((uint8 *)&player->_cardType,4);
-	recvPacket.read((uint8 *)player->_outCards, 24);
+	if (player->autoPlay())
+	{
+		player->setAutoPlay(false);
+		if (!player->isTurnToOutCard())
+			return;
+	}
+
+	uint32 claimedType;
+	uint8 outCards[24];
+	recvPacket >> claimedType;
+	recvPacket.read(outCards, 24);
+
+	Desk* desk = player->getDesk();
+	if (!desk || !player->isTurnToOutCard())
+	{
+		TC_LOG_DEBUG("network.opcode", "Dropped cards played out of turn by %s", GetPlayerInfo().c_str());
+		return;
+	}
+
+	/// the type is read from the cards by the rules of the room. Cards of no type, not in the hand,
+	/// or not beating the last play are no play, the player is still to play.
+	CardType cardType = desk->getVariant()->CheckPlay(player->_cards, outCards,
+		desk->leads(player->getid()) ? nullptr : desk->getLastPlay(), 24);
+	if (cardType == CARD_TYPE_END)
+	{
+		TC_LOG_DEBUG("network.opcode", "Dropped cards that are no play (claimed %u) played by %s", claimedType, GetPlayerInfo().c_str());
+		return;
+	}
 
+	player->_cardType = cardType;
+	memcpy(player->_outCards, outCards, 24);
 	player->setGameStatus(GAME_STATUS_OUT_CARDING);
 }
 
-void WorldSession::HandleRoundOver(WorldPacket& recvPacket)
+void WorldSession::HandleRoundOver(WorldPacket& /*recvPacket*/)
 {
-	Player * player = getPlayer();
+	/// rounds are settled by the server when a hand is emptied, the gold reported by the client is not trusted
+	TC_LOG_DEBUG("network.opcode", "Ignored round result reported by %s", GetPlayerInfo().c_str());
+}
+
+void WorldSession::HandlePlayerResume(WorldPacket& recvPacket)
+{
+	uint32 accountId;
+	uint64 token;
+
+	recvPacket >> accountId >> token;
 
-	recvPacket >> player->_winGold;
+	/// a failed resume leaves the session without player, it is closed and the client logs in again
+	Player* player = sRoomMgr->getPlayer(accountId);
+	if (!player || !player->resume(this, token))
+	{
+		WorldPacket packet(CMSG_PLAYER_RESUME, 12);
+		packet << uint32(0) << uint32(0) << uint32(LOGIN_RESULT_FAILED);
+		SendPacket(&packet);
+
+		TC_LOG_INFO("server.worldserver", "Account %u resume refused, remote IP: %s", accountId, _Address.c_str());
+		return;
+	}
+
+	_player = player;
+	_player->sendResumeState();
+
+	TC_LOG_INFO("server.worldserver", "Player: %s resumed,remote IP: %s", GetPlayerInfo().c_str(), _Address.c_str());
+}
+
+void WorldSession::HandleAutoPlay(WorldPacket& recvPacket)
+{
+	uint32 on;
+	recvPacket >> on;
 
-	player->setGameStatus(GAME_STATUS_ROUNDOVERING);
+	getPlayer()->setAutoPlay(on != 0);
 }
 
 void WorldSession::HandlLogout(WorldPacket& recvPacket)
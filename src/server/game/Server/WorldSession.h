@@ -30,17 +30,35 @@
 
 #include <unordered_set>
 
+class BasicEvent;
+class EventProcessor;
 class Player;
 class Unit;
 class WorldPacket;
-class WorldSocket;
+class WorldConnection;
 
 
+enum LoginResult
+{
+	LOGIN_RESULT_FAILED            = 0,
+	LOGIN_RESULT_OK                = 1,
+	LOGIN_RESULT_IN_GAME           = 2        /// still at a desk, the client has to resume
+};
+
+/// Notices of SMSG_SERVER_NOTICE, sent with the value they concern
+enum ServerNotice
+{
+	SERVER_NOTICE_DRAIN            = 1,       /// the server closes: no new game starts, the one in progress ends (or the ai ends it) within the seconds
+	SERVER_NOTICE_TOURNAMENT_START = 2,       /// the player is registered, the next tournament of the room starts within the seconds
+	SERVER_NOTICE_TOURNAMENT_STAGE = 3,       /// the player is seated for the stage of the tournament, 1 for the first one
+	SERVER_NOTICE_TOURNAMENT_RANK  = 4        /// the player is out of the tournament at the rank, 1 for the winner, 0 when it is cancelled
+};
+
 /// Player session in the World
 class WorldSession
 {
     public:
-        WorldSession(uint32 id, std::shared_ptr<WorldSocket> sock);
+        WorldSession(uint32 id, std::shared_ptr<WorldConnection> sock);
         ~WorldSession();
 
 		uint32 getAccountId() const { return _accountId; }
@@ -54,22 +72,18 @@ class WorldSession
 
 		bool Update(uint32 diffr);
 
-		std::atomic<int32> m_timeOutTime;
-
-		void UpdateTimeOutTime(uint32 diff)
-		{
-			m_timeOutTime -= int32(diff);
-		}
+		/// called by the socket for each packet received, the timeout event checks it when due
 		void ResetTimeOutTime()
 		{
-			m_timeOutTime = int32(sWorld->getIntConfig(CONFIG_SOCKET_TIMEOUTTIME));
+			_lastActivity = getMSTime();
 		}
 
-		bool IsTimeOutTime() const
-		{
-			return m_timeOutTime <= 0;
-		}
+		uint32 GetLastActivity() const { return _lastActivity; }
+		/// queues the socket timeout on the events of the world, the session owns the event
+		void StartTimeOutTimer(EventProcessor& events);
+		void TimeOut();
 		void SendLoginError(uint8 code);
+		void SendServerNotice(ServerNotice notice, uint32 value);
 
     public:                                                 // opcodes handlers
 		void Handle_NULL(WorldPacket& recvPacket);          // not used
@@ -79,15 +93,19 @@ class WorldSession
 		void HandleOutCards(WorldPacket& recvPacket);
 		void HandleRoundOver(WorldPacket& recvPacket);
 		void HandlLogout(WorldPacket& recvPacket);
+		void HandlePlayerResume(WorldPacket& recvPacket);
+		void HandleAutoPlay(WorldPacket& recvPacket);
     friend class World;
  
 
     private:
 
-        std::shared_ptr<WorldSocket> _Socket;
+        std::shared_ptr<WorldConnection> _Socket;
         std::string _Address;                // Current Remote Address
 		uint32 _accountId;
 		Player* _player;
+		std::atomic<uint32> _lastActivity;
+		BasicEvent* _timeOutEvent;
 
         LockedQueue<WorldPacket*> _recvQueue;
 
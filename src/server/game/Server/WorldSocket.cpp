@@ -8,7 +8,7 @@
 using boost::asio::ip::tcp;
 
 WorldSocket::WorldSocket(tcp::socket&& socket)
-    : Socket(std::move(socket), sizeof(ClientPktHeader)), _worldSession(nullptr)
+    : Socket(std::move(socket), sizeof(ClientPktHeader))
 {
 }
 
@@ -50,43 +50,17 @@ void WorldSocket::ReadDataHandler()
 
     WorldPacket packet(opcode, MoveData());
 
+    RecordIncoming(opcode, header->size);
+
     if (sPacketLog->CanLogPacket())
         sPacketLog->LogPacket(packet, CLIENT_TO_SERVER, GetRemoteIpAddress(), GetRemotePort());
 
    // TC_LOG_TRACE("network.opcode", "C->S: %s %s", (_worldSession ? _worldSession->GetPlayerInfo() : GetRemoteIpAddress().to_string()).c_str(), opcodeName.c_str());
-	
-	packet.read_skip<uint32[2]>();
 
-    switch (opcode)
+    if (!ProcessIncoming(packet))
     {
-		case CMSG_PLAYER_LOGIN:
-            if (_worldSession)
-            {
-                TC_LOG_ERROR("network", "WorldSocket::ProcessIncoming: received duplicate CMSG_AUTH_SESSION from %s", _worldSession->GetPlayerInfo().c_str());
-                break;
-            }
-
-            AddSession(packet);
-            break;
-		case CMSG_PING:_worldSession->ResetTimeOutTime(); break;
-
-        default:
-        {
-            if (!_worldSession)
-            {
-                TC_LOG_ERROR("network.opcode", "ProcessIncoming: Client not authed opcode = %u", uint32(opcode));
-                CloseSocket();
-                return;
-            }
-
-            // Our Idle timer will reset on any non PING opcodes.
-            // Catches people idling on the login screen and any lingering ingame connections.
-            _worldSession->ResetTimeOutTime();
-
-            // Copy the packet to the heap before enqueuing
-            _worldSession->QueuePacket(new WorldPacket(std::move(packet)));
-            break;
-        }
+        CloseSocket();
+        return;
     }
 
     AsyncReadHeader();
@@ -106,6 +80,8 @@ void WorldSocket::AsyncWrite(WorldPacket& packet)
 	/// fix my stupid client,sizeof(Opcode) * 2
 	ServerPktHeader header(packet.size() + sizeof(Opcode) * 2, Opcode);
 
+	RecordOutgoing(Opcode, header.getHeaderLength() + packet.size());
+
 
 	std::lock_guard<std::mutex> guard(_writeLock);
 
@@ -117,12 +93,22 @@ void WorldSocket::AsyncWrite(WorldPacket& packet)
         AsyncWrite(_writeQueue.front());
 }
 
-void WorldSocket::AddSession(WorldPacket& recvPacket)
+void WorldSocket::AsyncWriteShared(SharedPacketBuffer const& buffer)
 {
-	_worldSession = new WorldSession(recvPacket.peek<uint32>(20), shared_from_this());
-	_worldSession->QueuePacket(new WorldPacket(std::move(recvPacket)));
-	_worldSession->ResetTimeOutTime();
-	sWorld->AddSession(_worldSession);
+    if (!IsOpen())
+        return;
+
+    /// not in the packet log, the packet went to the seats of the desk already
+    RecordOutgoing(buffer);
+
+    std::lock_guard<std::mutex> guard(_writeLock);
+
+    bool needsWriteStart = _writeQueue.empty();
+
+    _writeQueue.emplace(buffer);
+
+    if (needsWriteStart)
+        AsyncWrite(_writeQueue.front());
 }
 
 void WorldSocket::CloseSocket()
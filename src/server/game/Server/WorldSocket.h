@@ -33,6 +33,7 @@ namespace boost
 #include "ServerPktHeader.h"
 #include "Socket.h"
 #include "Util.h"
+#include "WorldConnection.h"
 #include "WorldPacket.h"
 #include "WorldSession.h"
 #include <chrono>
@@ -66,6 +67,12 @@ struct WorldPacketBuffer
             _buffers[1] = boost::asio::const_buffer(_packet.contents(), _packet.size());
     }
 
+    /// packet serialized with its header already, shared with the other sockets writing it
+    explicit WorldPacketBuffer(SharedPacketBuffer const& shared) : _header(0, 0), _shared(shared)
+    {
+        _buffers[0] = boost::asio::const_buffer(_shared->data(), _shared->size());
+    }
+
     const_iterator begin() const
     {
         return _buffers;
@@ -73,13 +80,14 @@ struct WorldPacketBuffer
 
     const_iterator end() const
     {
-        return _buffers + (_packet.empty() ? 1 : 2);
+        return _buffers + (_shared || _packet.empty() ? 1 : 2);
     }
 
 private:
     boost::asio::const_buffer _buffers[2];
     ServerPktHeader _header;
     WorldPacket _packet;
+    SharedPacketBuffer _shared;
 };
 
 namespace boost
@@ -93,7 +101,7 @@ namespace boost
     }
 }
 
-class WorldSocket : public Socket<WorldSocket, WorldPacketBuffer>
+class WorldSocket : public Socket<WorldSocket, WorldPacketBuffer>, public WorldConnection
 {
     typedef Socket<WorldSocket, WorldPacketBuffer> Base;
 
@@ -105,21 +113,23 @@ public:
 
     void Start() override;
 
+    bool IsOpen() const override { return Base::IsOpen(); }
     void CloseSocket() override;
 
     using Base::AsyncWrite;
-    void AsyncWrite(WorldPacket& packet);
+    void AsyncWrite(WorldPacket& packet) override;
+    void AsyncWriteShared(SharedPacketBuffer const& buffer) override;
+
+    std::string GetRemoteAddress() const override { return GetRemoteIpAddress().to_string(); }
 
 protected:
     void ReadHeaderHandler() override;
     void ReadDataHandler() override;
 
-private:
-    void AddSession(WorldPacket& recvPacket);
+    std::shared_ptr<WorldConnection> GetSharedConnection() override { return shared_from_this(); }
 
+private:
     std::chrono::steady_clock::time_point _LastPingTime;
-
-    WorldSession* _worldSession;
 };
 
 #endif
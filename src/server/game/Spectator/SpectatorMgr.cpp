@@ -0,0 +1,315 @@
+#include "SpectatorMgr.h"
+
+#include "Log.h"
+#include "Metrics.h"
+#include "Opcodes.h"
+#include "WorldPacket.h"
+#include "World.h"
+
+#include <algorithm>
+
+namespace
+{
+	SharedPacketBuffer BuildSpectateResult(SpectateResult result)
+	{
+		WorldPacket data(CMSG_SPECTATE, 12);
+		data << uint32(0) << uint32(0);
+		data << uint32(result);
+		return WorldConnection::SerializePacket(data);
+	}
+} // namespace
+
+SpectatorChannel::SpectatorChannel(Desk const* desk, uint32 delay, uint32 capacity) : _delay(delay),
+	_ring(std::max<uint32>(capacity, 1)), _first(0), _released(0), _next(0), _closed(false), _ended(false),
+	_viewers(std::make_shared<std::vector<std::shared_ptr<WorldConnection>>>())
+{
+	WorldPacket data(CMSG_SPECTATE, 16 + DESK_SEATS * sizeof(PlayerInfo));
+	data << uint32(0) << uint32(0);
+	data << uint32(SPECTATE_RESULT_OK);
+	data << uint32(delay);
+
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+	{
+		Player* player = desk->getSeat(seat);
+		_accounts[seat] = player->getPlayerType() == PLAYER_TYPE_USER ? player->getid() : 0;
+		data.append((uint8 const*)player->getPlayerInfo(), sizeof(PlayerInfo));
+	}
+
+	_deskPacket = WorldConnection::SerializePacket(data);
+}
+
+void SpectatorChannel::Publish(WorldPacket const& packet)
+{
+	Event event;
+	event.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(_delay);
+	event.packet = WorldConnection::SerializePacket(packet);
+
+	std::lock_guard<std::mutex> lock(_lock);
+
+	if (_next - _first == _ring.size())
+	{
+		/// the viewers miss the oldest event when it was not released yet
+		if (_released == _first)
+		{
+			++_released;
+			sSpectatorMgr->_droppedEvents->Add();
+		}
+		++_first;
+	}
+
+	_ring[_next++ % _ring.size()] = std::move(event);
+}
+
+void SpectatorChannel::Close()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_closed = true;
+	_closeDue = std::chrono::steady_clock::now() + std::chrono::milliseconds(_delay);
+}
+
+void SpectatorChannel::Subscribe(std::shared_ptr<WorldConnection> const& viewer)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	/// queued under the lock: a release after it writes to the viewer, the events of one before are here
+	viewer->AsyncWriteShared(_deskPacket);
+	for (uint64 i = _first; i < _released; ++i)
+		viewer->AsyncWriteShared(_ring[i % _ring.size()].packet);
+
+	if (_ended)
+	{
+		viewer->AsyncWriteShared(sSpectatorMgr->_overPacket);
+		return;
+	}
+
+	std::shared_ptr<std::vector<std::shared_ptr<WorldConnection>>> viewers =
+		std::make_shared<std::vector<std::shared_ptr<WorldConnection>>>(*_viewers);
+	viewers->push_back(viewer);
+	_viewers = viewers;
+	sSpectatorMgr->_viewersGauge->Add(1);
+}
+
+void SpectatorChannel::Unsubscribe(WorldConnection* viewer)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	std::shared_ptr<std::vector<std::shared_ptr<WorldConnection>>> viewers =
+		std::make_shared<std::vector<std::shared_ptr<WorldConnection>>>();
+	viewers->reserve(_viewers->size());
+	for (std::shared_ptr<WorldConnection> const& other : *_viewers)
+		if (other.get() != viewer)
+			viewers->push_back(other);
+
+	sSpectatorMgr->_viewersGauge->Add(int64(viewers->size()) - int64(_viewers->size()));
+	_viewers = viewers;
+}
+
+bool SpectatorChannel::Release(TimePoint now, std::vector<SharedPacketBuffer>& events, ViewerList& viewers)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	while (_released < _next && _ring[_released % _ring.size()].due <= now)
+		events.push_back(_ring[_released++ % _ring.size()].packet);
+
+	bool ended = _closed && _released == _next && _closeDue <= now;
+	if (ended)
+	{
+		events.push_back(sSpectatorMgr->_overPacket);
+		_ended = true;
+	}
+
+	if (events.empty())
+		return true;
+
+	/// closed connections are let go with the next events
+	bool closedViewer = false;
+	for (std::shared_ptr<WorldConnection> const& viewer : *_viewers)
+		closedViewer = closedViewer || !viewer->IsOpen();
+
+	if (closedViewer || ended)
+	{
+		std::shared_ptr<std::vector<std::shared_ptr<WorldConnection>>> open =
+			std::make_shared<std::vector<std::shared_ptr<WorldConnection>>>();
+		for (std::shared_ptr<WorldConnection> const& viewer : *_viewers)
+			if (viewer->IsOpen())
+				open->push_back(viewer);
+
+		sSpectatorMgr->_viewersGauge->Add(int64(open->size()) - int64(_viewers->size()));
+		_viewers = open;
+	}
+
+	viewers = _viewers;
+
+	if (ended)
+	{
+		sSpectatorMgr->_viewersGauge->Add(-int64(_viewers->size()));
+		_viewers = std::make_shared<std::vector<std::shared_ptr<WorldConnection>>>();
+	}
+
+	return !ended;
+}
+
+SpectatorMgr::SpectatorMgr() : _ioService(nullptr), _stopped(false), _pendingChunks(0)
+{
+	_overPacket = BuildSpectateResult(SPECTATE_RESULT_OVER);
+	_failedPacket = BuildSpectateResult(SPECTATE_RESULT_FAILED);
+	_viewersGauge = sMetrics->GetGauge("landlord_spectators");
+	_droppedEvents = sMetrics->GetCounter("landlord_spectator_events_dropped_total");
+}
+
+void SpectatorMgr::Start(boost::asio::io_service& ioService)
+{
+	_ioService = &ioService;
+	_timer.reset(new boost::asio::steady_timer(ioService));
+	ScheduleTick();
+}
+
+void SpectatorMgr::Stop()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_stopped = true;
+	if (_timer)
+		_timer->cancel();
+
+	_byAccount.clear();
+	_channels.clear();
+}
+
+std::shared_ptr<SpectatorChannel> SpectatorMgr::OpenChannel(Desk const* desk)
+{
+	if (!sWorld->getIntConfig(CONFIG_SPECTATOR_ENABLE))
+		return nullptr;
+
+	std::shared_ptr<SpectatorChannel> channel = std::make_shared<SpectatorChannel>(desk,
+		sWorld->getIntConfig(CONFIG_SPECTATOR_DELAY), sWorld->getIntConfig(CONFIG_SPECTATOR_BUFFER_SIZE));
+
+	std::lock_guard<std::mutex> lock(_lock);
+	if (_stopped)
+		return nullptr;
+
+	/// a player seated again is watched at the new desk
+	for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		if (channel->_accounts[seat])
+			_byAccount[channel->_accounts[seat]] = channel;
+
+	_channels.push_back(channel);
+	return channel;
+}
+
+void SpectatorMgr::CloseChannel(std::shared_ptr<SpectatorChannel> const& channel)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		for (uint8 seat = 0; seat < DESK_SEATS; ++seat)
+		{
+			auto itr = _byAccount.find(channel->_accounts[seat]);
+			if (itr != _byAccount.end() && itr->second == channel)
+				_byAccount.erase(itr);
+		}
+	}
+
+	channel->Close();
+}
+
+std::shared_ptr<SpectatorChannel> SpectatorMgr::Subscribe(uint32 accountId, std::shared_ptr<WorldConnection> const& viewer)
+{
+	std::shared_ptr<SpectatorChannel> channel;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		auto itr = _byAccount.find(accountId);
+		if (itr != _byAccount.end())
+			channel = itr->second;
+	}
+
+	if (!channel)
+	{
+		viewer->AsyncWriteShared(_failedPacket);
+		TC_LOG_DEBUG("server.spectator", "%s can't watch account %u, it is at no desk", viewer->GetRemoteAddress().c_str(), accountId);
+		return nullptr;
+	}
+
+	channel->Subscribe(viewer);
+	TC_LOG_DEBUG("server.spectator", "%s watches the desk of account %u", viewer->GetRemoteAddress().c_str(), accountId);
+	return channel;
+}
+
+void SpectatorMgr::ScheduleTick()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	if (_stopped)
+		return;
+
+	_timer->expires_from_now(std::chrono::milliseconds(SPECTATOR_TICK_INTERVAL));
+	_timer->async_wait([this](boost::system::error_code const& error)
+	{
+		if (!error)
+			Tick();
+	});
+}
+
+void SpectatorMgr::Tick()
+{
+	std::vector<std::shared_ptr<SpectatorChannel>> channels;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		channels = _channels;
+	}
+
+	SpectatorChannel::TimePoint now = std::chrono::steady_clock::now();
+	std::vector<SpectatorChannel*> ended;
+
+	/// the tick counts as a chunk, the ones posted meanwhile can't schedule the next tick
+	_pendingChunks = 1;
+
+	for (std::shared_ptr<SpectatorChannel> const& channel : channels)
+	{
+		std::vector<SharedPacketBuffer> released;
+		SpectatorChannel::ViewerList viewers;
+		if (!channel->Release(now, released, viewers))
+			ended.push_back(channel.get());
+
+		if (released.empty() || viewers->empty())
+			continue;
+
+		/// the first chunk here, the others on whichever network threads are free
+		std::shared_ptr<std::vector<SharedPacketBuffer> const> events =
+			std::make_shared<std::vector<SharedPacketBuffer>>(std::move(released));
+		for (std::size_t begin = SPECTATOR_FANOUT_CHUNK; begin < viewers->size(); begin += SPECTATOR_FANOUT_CHUNK)
+		{
+			std::size_t end = std::min<std::size_t>(begin + SPECTATOR_FANOUT_CHUNK, viewers->size());
+			++_pendingChunks;
+			_ioService->post([this, events, viewers, begin, end]()
+			{
+				FanOut(*events, viewers, begin, end);
+				ChunkDone();
+			});
+		}
+
+		FanOut(*events, viewers, 0, std::min<std::size_t>(SPECTATOR_FANOUT_CHUNK, viewers->size()));
+	}
+
+	if (!ended.empty())
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_channels.erase(std::remove_if(_channels.begin(), _channels.end(), [&ended](std::shared_ptr<SpectatorChannel> const& channel)
+		{
+			return std::find(ended.begin(), ended.end(), channel.get()) != ended.end();
+		}), _channels.end());
+	}
+
+	ChunkDone();
+}
+
+void SpectatorMgr::FanOut(std::vector<SharedPacketBuffer> const& events, SpectatorChannel::ViewerList const& viewers,
+	std::size_t begin, std::size_t end)
+{
+	for (std::size_t i = begin; i < end; ++i)
+		for (SharedPacketBuffer const& event : events)
+			(*viewers)[i]->AsyncWriteShared(event);
+}
+
+void SpectatorMgr::ChunkDone()
+{
+	if (--_pendingChunks == 0)
+		ScheduleTick();
+}
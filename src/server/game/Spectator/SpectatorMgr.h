@@ -0,0 +1,134 @@
+#ifndef _SPECTATOR_MGR_H
+#define _SPECTATOR_MGR_H
+
+#include "Desk.h"
+#include "WorldConnection.h"
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define SPECTATOR_TICK_INTERVAL   100             /// ms between two releases of the delayed events
+#define SPECTATOR_FANOUT_CHUNK    256             /// viewers a network thread writes the events to in one go
+
+class MetricCounter;
+class MetricGauge;
+class WorldPacket;
+
+/// Replies of CMSG_SPECTATE, sent after the two uint32 the client leaves at 0
+enum SpectateResult
+{
+	SPECTATE_RESULT_FAILED         = 0,       /// the account is at no desk of this server
+	SPECTATE_RESULT_OK             = 1,       /// then uint32 delay in ms and the PlayerInfo of the three seats
+	SPECTATE_RESULT_OVER           = 2        /// the desk is gone, the events stop
+};
+
+/// Events of one desk as its spectators see them: what the seats are sent, but the dealt hands,
+/// released Spectator.Delay after the room published them.
+/// The room only serializes an event once and puts it in a ring of Spectator.BufferSize events,
+/// the network threads write it to the viewers. When the ring is full the oldest event is dropped,
+/// released or not. A viewer joining gets the released events still in the ring first.
+class SpectatorChannel
+{
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+	typedef std::shared_ptr<std::vector<std::shared_ptr<WorldConnection>> const> ViewerList;
+
+	SpectatorChannel(Desk const* desk, uint32 delay, uint32 capacity);
+
+	/// room thread
+	void Publish(WorldPacket const& packet);
+	/// room thread, the desk is gone: the viewers are told once the events before are released
+	void Close();
+
+	/// network threads
+	void Subscribe(std::shared_ptr<WorldConnection> const& viewer);
+	void Unsubscribe(WorldConnection* viewer);
+
+private:
+	friend class SpectatorMgr;
+
+	struct Event
+	{
+		TimePoint due;
+		SharedPacketBuffer packet;
+	};
+
+	/// events due at now and the viewers to write them to, false once the end of the desk is released
+	bool Release(TimePoint now, std::vector<SharedPacketBuffer>& events, ViewerList& viewers);
+
+	uint32 _delay;
+	uint32 _accounts[DESK_SEATS];             /// the desk is found by, 0 for an ai seat
+	SharedPacketBuffer _deskPacket;           /// reply to CMSG_SPECTATE, the seats as at the start
+
+	std::mutex _lock;
+	std::vector<Event> _ring;
+	uint64 _first;                            /// oldest event still in the ring
+	uint64 _released;                         /// events before are written to the viewers
+	uint64 _next;
+	bool _closed;
+	TimePoint _closeDue;
+	bool _ended;                              /// the end is released, a viewer joining late is told at once
+	ViewerList _viewers;                      /// copied at each change, the fan-out reads a snapshot
+};
+
+/// Spectators of the desks. The desks of a room open a channel when they are created, found by
+/// the accounts at their seats until the desk is removed.
+/// A timer on the network threads releases the delayed events: an event goes to the viewers of a
+/// desk in chunks of SPECTATOR_FANOUT_CHUNK, spread on the network threads, and the next release
+/// waits for the chunks of the previous one so a viewer gets the events in order.
+class SpectatorMgr
+{
+public:
+	static SpectatorMgr* instance()
+	{
+		static SpectatorMgr instance;
+		return &instance;
+	}
+
+	void Start(boost::asio::io_service& ioService);
+	void Stop();
+
+	/// room thread, nullptr when Spectator.Enable is off
+	std::shared_ptr<SpectatorChannel> OpenChannel(Desk const* desk);
+	void CloseChannel(std::shared_ptr<SpectatorChannel> const& channel);
+
+	/// network threads: the viewer watches the desk of the account, nullptr when it is at none.
+	/// The reply to CMSG_SPECTATE is sent either way.
+	std::shared_ptr<SpectatorChannel> Subscribe(uint32 accountId, std::shared_ptr<WorldConnection> const& viewer);
+
+private:
+	friend class SpectatorChannel;
+
+	SpectatorMgr();
+
+	void ScheduleTick();
+	void Tick();
+	/// writes the events to viewers [begin, end), the last chunk done schedules the next tick
+	void FanOut(std::vector<SharedPacketBuffer> const& events, SpectatorChannel::ViewerList const& viewers,
+		std::size_t begin, std::size_t end);
+	void ChunkDone();
+
+	boost::asio::io_service* _ioService;
+	std::unique_ptr<boost::asio::steady_timer> _timer;
+
+	std::mutex _lock;
+	std::unordered_map<uint32, std::shared_ptr<SpectatorChannel>> _byAccount;
+	std::vector<std::shared_ptr<SpectatorChannel>> _channels;   /// closed ones until their end is released
+	bool _stopped;
+
+	std::atomic<uint32> _pendingChunks;
+	SharedPacketBuffer _overPacket;
+	SharedPacketBuffer _failedPacket;
+
+	MetricGauge* _viewersGauge;
+	MetricCounter* _droppedEvents;
+};
+
+#define sSpectatorMgr SpectatorMgr::instance()
+
+#endif
@@ -0,0 +1,514 @@
+#include "Handoff.h"
+
+#include "Log.h"
+#include "PlayerStore.h"
+#include "RoomManager.h"
+#include "World.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if PLATFORM != PLATFORM_WINDOWS
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+Handoff::Handoff() : _ioService(nullptr), _predecessorFd(-1), _successorWaiting(false), _handedOver(false), _sending(false)
+{
+	memset(&_readHeader, 0, sizeof(_readHeader));
+}
+
+Handoff::~Handoff()
+{
+#if PLATFORM != PLATFORM_WINDOWS
+	if (_predecessorFd >= 0)
+		close(_predecessorFd);
+#endif
+}
+
+#if PLATFORM != PLATFORM_WINDOWS
+
+static bool ReadAll(int fd, void* data, size_t size)
+{
+	uint8* pos = static_cast<uint8*>(data);
+	while (size > 0)
+	{
+		ssize_t read = recv(fd, pos, size, MSG_WAITALL);
+		if (read < 0 && errno == EINTR)
+			continue;
+		if (read <= 0)
+			return false;
+
+		pos += read;
+		size -= size_t(read);
+	}
+	return true;
+}
+
+static bool WriteAll(int fd, void const* data, size_t size)
+{
+	uint8 const* pos = static_cast<uint8 const*>(data);
+	while (size > 0)
+	{
+		ssize_t written = send(fd, pos, size, MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+
+		pos += written;
+		size -= size_t(written);
+	}
+	return true;
+}
+
+/// the process at the other end of a local socket runs as the same user as this server
+static bool IsSameUser(int fd)
+{
+#ifdef SO_PEERCRED
+	ucred credentials;
+	socklen_t length = sizeof(credentials);
+	return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == geteuid();
+#else
+	uid_t uid;
+	gid_t gid;
+	return getpeereid(fd, &uid, &gid) == 0 && uid == geteuid();
+#endif
+}
+
+bool Handoff::TakeOver(std::string const& path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	if (path.length() >= sizeof(address.sun_path))
+	{
+		TC_LOG_ERROR("server.worldserver", "Handoff: socket path %s is too long", path.c_str());
+		return false;
+	}
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+
+	/// no server is running, or it left its socket file behind
+	if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	/// listening sockets handed over by another user's process are not taken
+	if (!IsSameUser(fd))
+	{
+		TC_LOG_ERROR("server.worldserver", "Handoff: the process at %s runs as another user, the server does not take over", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	TC_LOG_INFO("server.worldserver", "Handoff: a server runs at %s, taking over from it", path.c_str());
+
+	timeval timeout;
+	timeout.tv_sec = HANDOFF_TIMEOUT;
+	timeout.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	/// header and counts come in one message with the listening sockets, the held accounts follow
+	HandoffHeader header;
+	uint32 counts[2];                  /// listeners, accounts held
+	iovec iov[2];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = counts;
+	iov[1].iov_len = sizeof(counts);
+
+	char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_LISTENERS)];
+	memset(control, 0, sizeof(control));
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ssize_t read;
+	do
+		read = recvmsg(fd, &msg, MSG_WAITALL);
+	while (read < 0 && errno == EINTR);
+
+	/// every descriptor received is kept, to be closed below if the handoff fails. The control
+	/// buffer holds HANDOFF_MAX_LISTENERS of them at most, the kernel truncates the rest.
+	if (read > 0)
+	{
+		for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len < CMSG_LEN(0))
+				continue;
+
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (size_t i = 0; i < count; ++i)
+			{
+				int received;
+				memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+				_received.push_back(received);
+			}
+		}
+	}
+
+	std::vector<uint32> held;
+	bool valid = read == ssize_t(sizeof(header) + sizeof(counts)) && !(msg.msg_flags & MSG_CTRUNC) && header.type == HANDOFF_LISTENERS
+		&& counts[0] == _received.size() && header.size == sizeof(counts) + counts[1] * sizeof(uint32);
+	if (valid)
+	{
+		held.resize(counts[1]);
+		valid = held.empty() || ReadAll(fd, held.data(), held.size() * sizeof(uint32));
+	}
+
+	if (!valid)
+	{
+		TC_LOG_ERROR("server.worldserver", "Handoff: the server at %s did not hand over", path.c_str());
+		for (int listener : _received)
+			close(listener);
+		_received.clear();
+		close(fd);
+		return false;
+	}
+
+	_held.insert(held.begin(), held.end());
+	_predecessorFd = fd;
+
+	TC_LOG_INFO("server.worldserver", "Handoff: took %u listening sockets, %u accounts are still in game at the old server",
+		uint32(_received.size()), uint32(held.size()));
+	return true;
+}
+
+void Handoff::Start(boost::asio::io_service& ioService, std::string const& path, std::vector<int> const& listeners,
+	std::function<void()> stopAccepting)
+{
+	_ioService = &ioService;
+	_path = path;
+	_listeners = listeners;
+	if (_listeners.size() > HANDOFF_MAX_LISTENERS)
+		_listeners.resize(HANDOFF_MAX_LISTENERS);
+	_stopAccepting = stopAccepting;
+
+	if (_predecessorFd >= 0)
+	{
+		_predecessor.reset(new Local::socket(ioService, Local(), _predecessorFd));
+		_predecessorFd = -1;
+		AsyncReadHeader();
+	}
+
+	/// the file of the old server is replaced, it keeps its socket for the messages to this one
+	unlink(path.c_str());
+
+	boost::system::error_code error;
+	_acceptor.reset(new Local::acceptor(ioService));
+	_acceptor->open(Local(), error);
+	if (!error)
+		_acceptor->bind(Local::endpoint(path), error);
+	/// the user running the server only, before anyone can connect
+	if (!error && chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0)
+		error = boost::system::error_code(errno, boost::system::system_category());
+	if (!error)
+		_acceptor->listen(boost::asio::socket_base::max_connections, error);
+
+	if (error)
+	{
+		TC_LOG_ERROR("server.worldserver", "Handoff: can't listen at %s (%s), the server can't hand over", path.c_str(), error.message().c_str());
+		_acceptor.reset();
+		return;
+	}
+
+	AsyncAcceptSuccessor();
+}
+
+void Handoff::Stop()
+{
+	if (!_handedOver)
+	{
+		if (_acceptor)
+			unlink(_path.c_str());
+		return;
+	}
+
+	/// the io threads stop with the world, the messages still queued are sent first
+	for (uint32 waited = 0; waited < HANDOFF_TIMEOUT * 1000; waited += 10)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_sendLock);
+			if (!_sending)
+				return;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	TC_LOG_ERROR("server.worldserver", "Handoff: the new server does not read, messages to it are lost");
+}
+
+void Handoff::AsyncAcceptSuccessor()
+{
+	std::shared_ptr<Local::socket> socket = std::make_shared<Local::socket>(*_ioService);
+	_acceptor->async_accept(*socket, [this, socket](boost::system::error_code const& error)
+	{
+		if (error == boost::asio::error::operation_aborted)
+			return;
+
+		/// the listening sockets go to a process of the user running the server only
+		if (!error && !IsSameUser(socket->native_handle()))
+			TC_LOG_WARN("server.worldserver", "Handoff: a process of another user connected, it is not handed over to");
+		/// the world thread owns the successor until it handed over or gave up
+		else if (!error && !_handedOver && !_successorWaiting)
+		{
+			TC_LOG_INFO("server.worldserver", "Handoff: a new server connected, handing over to it");
+			_successor.reset(new Local::socket(std::move(*socket)));
+			_successorWaiting = true;
+		}
+
+		if (!_handedOver)
+			AsyncAcceptSuccessor();
+	});
+}
+
+void Handoff::Update()
+{
+	if (!_successorWaiting || _handedOver)
+		return;
+
+	std::vector<uint32> held;
+	sRoomMgr->ForEachPlayer([&held](uint32 id, Player* /*player*/) { held.push_back(id); });
+
+	/// the files are flushed before the new server loads them, what is saved from now on follows them
+	sPlayerStore->HandOff([this](PlayerRecord const& record) { SendRecord(record); });
+
+	if (!SendListeners(held))
+	{
+		TC_LOG_ERROR("server.worldserver", "Handoff: the new server left during the handover, the server goes on");
+		sPlayerStore->Open();
+
+		boost::system::error_code error;
+		_successor->close(error);
+		_successorWaiting = false;
+		return;
+	}
+
+	_handedOver = true;
+	_ioService->post([this]()
+	{
+		boost::system::error_code error;
+		_acceptor->close(error);
+	});
+	_stopAccepting();
+
+	TC_LOG_INFO("server.worldserver", "Handoff: handed over, %u accounts still in game here", uint32(held.size()));
+	sWorld->RequestDrain();
+}
+
+bool Handoff::SendListeners(std::vector<uint32> const& held)
+{
+	HandoffHeader header;
+	uint32 counts[2] = { uint32(_listeners.size()), uint32(held.size()) };
+	header.type = HANDOFF_LISTENERS;
+	header.size = sizeof(counts) + held.size() * sizeof(uint32);
+
+	iovec iov[2];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = counts;
+	iov[1].iov_len = sizeof(counts);
+
+	char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_LISTENERS)];
+	memset(control, 0, sizeof(control));
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	if (!_listeners.empty())
+	{
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * _listeners.size());
+
+		cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * _listeners.size());
+		memcpy(CMSG_DATA(cmsg), _listeners.data(), sizeof(int) * _listeners.size());
+	}
+
+	/// no asynchronous operation ran on the socket yet, it still blocks
+	int fd = _successor->native_handle();
+	ssize_t written;
+	do
+		written = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	while (written < 0 && errno == EINTR);
+
+	if (written != ssize_t(sizeof(header) + sizeof(counts)))
+		return false;
+	return held.empty() || WriteAll(fd, held.data(), held.size() * sizeof(uint32));
+}
+
+void Handoff::SendRecord(PlayerRecord const& record)
+{
+	Send(HANDOFF_RECORD, &record, sizeof(record));
+}
+
+void Handoff::SendRelease(uint32 accountId)
+{
+	Send(HANDOFF_RELEASE, &accountId, sizeof(accountId));
+}
+
+void Handoff::Send(uint32 type, void const* data, uint32 size)
+{
+	HandoffHeader header;
+	header.type = type;
+	header.size = size;
+
+	std::vector<uint8> message(sizeof(header) + size);
+	memcpy(message.data(), &header, sizeof(header));
+	memcpy(message.data() + sizeof(header), data, size);
+
+	/// called from the room threads, one write at a time goes through the io threads
+	std::lock_guard<std::mutex> lock(_sendLock);
+	if (!_successor)
+		return;
+
+	_sendQueue.push_back(std::move(message));
+	if (!_sending)
+	{
+		_sending = true;
+		AsyncWrite();
+	}
+}
+
+void Handoff::AsyncWrite()
+{
+	/// called with _sendLock held, the message stays at the front of the queue until written
+	boost::asio::async_write(*_successor, boost::asio::buffer(_sendQueue.front()),
+		[this](boost::system::error_code const& error, std::size_t /*written*/)
+	{
+		std::lock_guard<std::mutex> lock(_sendLock);
+		if (error)
+		{
+			TC_LOG_ERROR("server.worldserver", "Handoff: the new server is gone (%s), %u messages to it are lost",
+				error.message().c_str(), uint32(_sendQueue.size()));
+			_sendQueue.clear();
+			_successor.reset();
+			_sending = false;
+			return;
+		}
+
+		_sendQueue.pop_front();
+		if (_sendQueue.empty())
+			_sending = false;
+		else
+			AsyncWrite();
+	});
+}
+
+void Handoff::AsyncReadHeader()
+{
+	boost::asio::async_read(*_predecessor, boost::asio::buffer(&_readHeader, sizeof(_readHeader)),
+		[this](boost::system::error_code const& error, std::size_t /*read*/)
+	{
+		if (error)
+		{
+			ReleaseAll();
+			return;
+		}
+
+		if (_readHeader.size > sizeof(PlayerRecord))
+		{
+			TC_LOG_ERROR("server.worldserver", "Handoff: message %u of %u bytes from the old server, it's dropped", _readHeader.type, _readHeader.size);
+			ReleaseAll();
+			return;
+		}
+
+		AsyncReadBody();
+	});
+}
+
+void Handoff::AsyncReadBody()
+{
+	_readBody.resize(_readHeader.size);
+	boost::asio::async_read(*_predecessor, boost::asio::buffer(_readBody),
+		[this](boost::system::error_code const& error, std::size_t /*read*/)
+	{
+		if (error)
+		{
+			ReleaseAll();
+			return;
+		}
+
+		HandleMessage();
+		AsyncReadHeader();
+	});
+}
+
+void Handoff::HandleMessage()
+{
+	switch (_readHeader.type)
+	{
+		case HANDOFF_RECORD:
+		{
+			if (_readBody.size() != sizeof(PlayerRecord))
+				break;
+
+			PlayerRecord record;
+			memcpy(&record, _readBody.data(), sizeof(record));
+			sPlayerStore->SaveRecord(record);
+			break;
+		}
+		case HANDOFF_RELEASE:
+		{
+			if (_readBody.size() != sizeof(uint32))
+				break;
+
+			uint32 accountId;
+			memcpy(&accountId, _readBody.data(), sizeof(accountId));
+
+			std::lock_guard<std::mutex> lock(_heldLock);
+			_held.erase(accountId);
+			break;
+		}
+		default:
+			TC_LOG_ERROR("server.worldserver", "Handoff: unknown message %u from the old server", _readHeader.type);
+			break;
+	}
+}
+
+void Handoff::ReleaseAll()
+{
+	/// the old server stopped, nothing is held there any more
+	std::lock_guard<std::mutex> lock(_heldLock);
+	TC_LOG_INFO("server.worldserver", "Handoff: the old server stopped, %u accounts were still held", uint32(_held.size()));
+	_held.clear();
+}
+
+bool Handoff::IsHeldByPredecessor(uint32 accountId)
+{
+	std::lock_guard<std::mutex> lock(_heldLock);
+	return _held.count(accountId) != 0;
+}
+
+#else
+
+bool Handoff::TakeOver(std::string const& /*path*/) { return false; }
+void Handoff::Start(boost::asio::io_service& /*ioService*/, std::string const& /*path*/, std::vector<int> const& /*listeners*/,
+	std::function<void()> /*stopAccepting*/) { }
+void Handoff::Stop() { }
+void Handoff::Update() { }
+bool Handoff::IsHeldByPredecessor(uint32 /*accountId*/) { return false; }
+void Handoff::SendRecord(PlayerRecord const& /*record*/) { }
+void Handoff::SendRelease(uint32 /*accountId*/) { }
+
+#endif
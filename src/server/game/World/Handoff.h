@@ -0,0 +1,122 @@
+#ifndef _HANDOFF_H
+#define _HANDOFF_H
+
+#include "Define.h"
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct PlayerRecord;
+
+#define HANDOFF_MAX_LISTENERS 4
+#define HANDOFF_TIMEOUT       30                /// s the new server waits for the old one to answer
+
+/// Messages from the old server to the new one, each is a HandoffHeader and size bytes
+enum HandoffMessageType
+{
+	HANDOFF_LISTENERS = 1,             /// the listening sockets ride along, then the accounts still in game
+	HANDOFF_RECORD    = 2,             /// a PlayerRecord, progress the old server saved while draining
+	HANDOFF_RELEASE   = 3              /// an account id, the player left the old server
+};
+
+struct HandoffHeader
+{
+	uint32 type;
+	uint32 size;
+};
+
+/// Restart without downtime: a new server connects to the Handoff.Socket of the running one, which
+/// passes it the listening sockets and drains. Clients connect to the new server meanwhile, the
+/// players at a desk finish their round on the old one.
+/// The new server owns the player store from the handover: the old one flushes and closes it before
+/// the new one loads it, then sends the progress saved during the drain, and the accounts still in
+/// game at the old server can't log in at the new one until it released them.
+/// The socket is for the user running the server, and both ends check the other runs as that user.
+/// Only on the platforms with Unix sockets, elsewhere the servers never hand over.
+class Handoff
+{
+public:
+	static Handoff* instance()
+	{
+		static Handoff instance;
+		return &instance;
+	}
+
+	/// new server, before the world loads: connects to the server at path and takes its listening
+	/// sockets, false when no server answered (a plain start)
+	bool TakeOver(std::string const& path);
+	/// listening socket handed over at index, -1 past the ones received
+	int GetListener(uint32 index) const { return index < _received.size() ? _received[index] : -1; }
+
+	/// once the world is up: reads what the old server still sends, and waits at path for the server
+	/// to hand over to. The listeners are handed over in their order, stopAccepting is called once
+	/// they are gone.
+	void Start(boost::asio::io_service& ioService, std::string const& path, std::vector<int> const& listeners,
+		std::function<void()> stopAccepting);
+	/// removes the socket file, unless it belongs to the new server already
+	void Stop();
+
+	/// called by the world thread between two ticks: hands over to the new server that connected
+	void Update();
+
+	/// the account is still in game at the old server
+	bool IsHeldByPredecessor(uint32 accountId);
+
+	/// old server after the handover, what follows goes to the new server
+	bool IsHandedOver() const { return _handedOver; }
+	void SendRecord(PlayerRecord const& record);
+	void SendRelease(uint32 accountId);
+
+private:
+	Handoff();
+	~Handoff();
+
+#if PLATFORM != PLATFORM_WINDOWS
+	typedef boost::asio::local::stream_protocol Local;
+
+	void AsyncAcceptSuccessor();
+	bool SendListeners(std::vector<uint32> const& held);
+	void Send(uint32 type, void const* data, uint32 size);
+	void AsyncWrite();
+
+	void AsyncReadHeader();
+	void AsyncReadBody();
+	void HandleMessage();
+	void ReleaseAll();
+
+	std::unique_ptr<Local::acceptor> _acceptor;
+	std::unique_ptr<Local::socket> _successor;      /// new server waiting for the handover
+	std::unique_ptr<Local::socket> _predecessor;    /// old server still draining
+#endif
+
+	boost::asio::io_service* _ioService;
+	std::string _path;
+	std::vector<int> _listeners;
+	std::vector<int> _received;
+	std::function<void()> _stopAccepting;
+
+	int _predecessorFd;                             /// from TakeOver to Start
+	std::atomic<bool> _successorWaiting;
+	std::atomic<bool> _handedOver;
+
+	std::mutex _heldLock;
+	std::set<uint32> _held;
+
+	std::mutex _sendLock;
+	std::deque<std::vector<uint8>> _sendQueue;
+	bool _sending;
+
+	HandoffHeader _readHeader;
+	std::vector<uint8> _readBody;
+};
+
+#define sHandoff Handoff::instance()
+
+#endif
@@ -0,0 +1,133 @@
+#include "TickProfiler.h"
+
+#include "Config.h"
+#include "Log.h"
+#include "Metrics.h"
+
+TickProfiler::TickProfiler() : _enabled(false), _dumpInterval(0), _dumpTimer(0), _slowTickThreshold(0)
+{
+	for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+	{
+		_tickTotals[i] = 0;
+		sMetrics->RegisterHistogram("landlord_tick_phase_seconds", std::string("phase=\"") + GetPhaseName(TickPhase(i)) + "\"", &_phases[i]);
+	}
+}
+
+void TickProfiler::LoadConfig()
+{
+	_enabled = sConfigMgr->GetBoolDefault("Profiler.Enable", true);
+	_dumpInterval = sConfigMgr->GetIntDefault("Profiler.DumpInterval", 60) * IN_MILLISECONDS;
+	_slowTickThreshold = sConfigMgr->GetIntDefault("Profiler.SlowTickThreshold", 100);
+	_dumpTimer = 0;
+}
+
+char const* TickProfiler::GetPhaseName(TickPhase phase)
+{
+	switch (phase)
+	{
+	case TICK_PHASE_WORLD:          return "World::Update";
+	case TICK_PHASE_SESSIONS:       return "World::UpdateSessions";
+	case TICK_PHASE_ROOMS:          return "RoomManager::Update";
+	case TICK_PHASE_ROOM:           return "Room::Update";
+	case TICK_PHASE_ROOM_PLAYERS:   return "Room::Update(players)";
+	case TICK_PHASE_ROOM_ONE:       return "Room::UpdateOne";
+	case TICK_PHASE_ROOM_TWO:       return "Room::UpdateTwo";
+	case TICK_PHASE_ROOM_THREE:     return "Room::UpdateThree";
+	case TICK_PHASE_AI_DECISION:    return "AI decision";
+	default:                        return "unknown";
+	}
+}
+
+void TickProfiler::RegisterRoom(uint32 roomId, TimingHistogram* histogram)
+{
+	std::lock_guard<std::mutex> lock(_roomsLock);
+	RoomHistogram& room = _rooms[roomId];
+	room.histogram = histogram;
+	room.window = TimingWindow();
+
+	sMetrics->RegisterHistogram("landlord_room_tick_seconds", RoomLabel(roomId), histogram);
+}
+
+void TickProfiler::UnregisterRoom(uint32 roomId)
+{
+	std::lock_guard<std::mutex> lock(_roomsLock);
+	_rooms.erase(roomId);
+
+	sMetrics->UnregisterHistogram("landlord_room_tick_seconds", RoomLabel(roomId));
+}
+
+std::string TickProfiler::RoomLabel(uint32 roomId)
+{
+	std::ostringstream ss;
+	ss << "room=\"" << roomId << "\"";
+	return ss.str();
+}
+
+void TickProfiler::BeginTick()
+{
+	if (!_enabled)
+		return;
+
+	for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+		_tickTotals[i].store(0, std::memory_order_relaxed);
+}
+
+void TickProfiler::EndTick(uint32 tickTime)
+{
+	if (!_enabled || !_slowTickThreshold || tickTime < _slowTickThreshold)
+		return;
+
+	/// room phases run on several updater threads, so their totals may exceed the wall time of the tick
+	std::ostringstream ss;
+	for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+	{
+		if (i)
+			ss << ", ";
+		ss << GetPhaseName(TickPhase(i)) << ": " << _tickTotals[i].load(std::memory_order_relaxed) << "us";
+	}
+
+	TC_LOG_WARN("server.profiler", "Slow world tick (%u ms, threshold %u ms): %s", tickTime, _slowTickThreshold, ss.str().c_str());
+}
+
+void TickProfiler::Update(uint32 diff)
+{
+	if (!_enabled || !_dumpInterval)
+		return;
+
+	_dumpTimer += diff;
+	if (_dumpTimer < _dumpInterval)
+		return;
+
+	_dumpTimer = 0;
+
+	static LogFilter const profilerFilter("server.profiler");
+	if (!profilerFilter.IsEnabled(LOG_LEVEL_INFO))
+		return;
+
+	for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+		TC_LOG_INFO("server.profiler", "%s: %s", GetPhaseName(TickPhase(i)), _phases[i].Snapshot(_phaseWindows[i]).ToString().c_str());
+
+	std::lock_guard<std::mutex> lock(_roomsLock);
+	for (RoomHistogramMap::iterator itr = _rooms.begin(); itr != _rooms.end(); ++itr)
+		TC_LOG_INFO("server.profiler", "Room %u: %s", itr->first, itr->second.histogram->Snapshot(itr->second.window).ToString().c_str());
+}
+
+std::string TickProfiler::GetReport(bool reset)
+{
+	std::ostringstream ss;
+
+	if (!_enabled)
+	{
+		ss << "Tick profiler is disabled (Profiler.Enable = 0)\n";
+		return ss.str();
+	}
+
+	for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+		ss << GetPhaseName(TickPhase(i)) << ": " << _phases[i].Snapshot(reset).ToString() << "\n";
+
+	std::lock_guard<std::mutex> lock(_roomsLock);
+	for (RoomHistogramMap::iterator itr = _rooms.begin(); itr != _rooms.end(); ++itr)
+		ss << "Room " << itr->first << ": " << itr->second.histogram->Snapshot(reset).ToString() << "\n";
+
+	return ss.str();
+}
@@ -0,0 +1,90 @@
+#ifndef _TICK_PROFILER_H
+#define _TICK_PROFILER_H
+
+#include "TimingHistogram.h"
+#include "Watchdog.h"
+
+#include <mutex>
+#include <map>
+
+enum TickPhase
+{
+	TICK_PHASE_WORLD,                  /// World::Update
+	TICK_PHASE_SESSIONS,               /// World::UpdateSessions
+	TICK_PHASE_ROOMS,                  /// RoomManager::Update, including the wait for the updater threads
+	TICK_PHASE_ROOM,                   /// Room::Update of any room
+	TICK_PHASE_ROOM_PLAYERS,           /// Player::Update loop of a room
+	TICK_PHASE_ROOM_ONE,               /// Room::UpdateOne
+	TICK_PHASE_ROOM_TWO,               /// Room::UpdateTwo
+	TICK_PHASE_ROOM_THREE,             /// Room::UpdateThree
+	TICK_PHASE_AI_DECISION,            /// ai grab landlord or out card
+	MAX_TICK_PHASES
+};
+
+class TickProfiler
+{
+public:
+	static TickProfiler* instance()
+	{
+		static TickProfiler instance;
+		return &instance;
+	}
+
+	void LoadConfig();
+	bool IsEnabled() const { return _enabled; }
+
+	TimingHistogram* GetPhase(TickPhase phase) { return _enabled ? &_phases[phase] : nullptr; }
+	std::atomic<uint64>* GetPhaseAccumulator(TickPhase phase) { return _enabled ? &_tickTotals[phase] : nullptr; }
+
+	void RegisterRoom(uint32 roomId, TimingHistogram* histogram);
+	void UnregisterRoom(uint32 roomId);
+
+	/// marks the beginning and the end of a world tick, used to find the phase of an overrun tick
+	void BeginTick();
+	void EndTick(uint32 tickTime);
+
+	/// periodic dump through the logging system, of the ticks since the last dump
+	void Update(uint32 diff);
+
+	/// human readable statistics of every phase and room since the start or the last reset.
+	/// The histograms are exported as metrics, only the admin console resets them.
+	std::string GetReport(bool reset = false);
+
+	static char const* GetPhaseName(TickPhase phase);
+
+private:
+	static std::string RoomLabel(uint32 roomId);
+
+	TickProfiler();
+	~TickProfiler() { }
+
+	bool _enabled;
+	uint32 _dumpInterval;
+	uint32 _dumpTimer;
+	uint32 _slowTickThreshold;
+
+	TimingHistogram _phases[MAX_TICK_PHASES];
+	std::atomic<uint64> _tickTotals[MAX_TICK_PHASES];
+
+	/// the periodic dump reports the ticks since the last one, the histograms keep counting
+	TimingWindow _phaseWindows[MAX_TICK_PHASES];
+
+	struct RoomHistogram
+	{
+		TimingHistogram* histogram;
+		TimingWindow window;
+	};
+
+	typedef std::map<uint32, RoomHistogram> RoomHistogramMap;
+	RoomHistogramMap _rooms;
+	std::mutex _roomsLock;
+};
+
+#define sTickProfiler TickProfiler::instance()
+
+/// Times the enclosing scope into the given tick phase and tells the watchdog about it
+#define PROFILE_TICK_PHASE(phase) \
+	WatchdogContext tickPhaseContext__(TickProfiler::GetPhaseName(phase)); \
+	ScopedTickTimer tickPhaseTimer__(sTickProfiler->GetPhase(phase), sTickProfiler->GetPhaseAccumulator(phase))
+
+#endif
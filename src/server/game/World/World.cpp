@@ -1,18 +1,40 @@
 #include "World.h"
 
+#include "ClusterNode.h"
 #include "Configuration/Config.h"
+#include "DealTable.h"
+#include "Handoff.h"
+#include "Metrics.h"
+#include "Player.h"
+#include "PlayerStore.h"
 #include "RoomManager.h"
+#include "TickProfiler.h"
 #include "WorldSession.h"
 
+#include <algorithm>
 
 std::atomic<bool> World::m_stopEvent(false);
 uint8 World::m_ExitCode = SHUTDOWN_EXIT_CODE;
 std::atomic<uint32> World::m_worldLoopCounter(0);
+thread_local std::shared_ptr<WorldConfig const> World::m_tickConfig;
 
+WorldConfigScope::WorldConfigScope() : _previous(std::move(World::m_tickConfig))
+{
+	World::m_tickConfig = std::atomic_load(&sWorld->m_config);
+}
 
-World::World()
+WorldConfigScope::~WorldConfigScope()
 {
+	World::m_tickConfig = std::move(_previous);
+}
 
+/// ms after the drain notice before the players not at a desk are let go, so the clients show it
+#define DRAIN_NOTICE_DELAY 3000
+
+World::World() : m_configReloadRequested(false), m_drainRequested(false), m_draining(false),
+	m_drainTime(0), m_drainHandedToAi(false)
+{
+	_sessionsGauge = sMetrics->GetGauge("landlord_sessions");
 }
 
 World::~World()
@@ -29,10 +51,13 @@ World::~World()
 /// Remove a given session
 bool World::RemoveSession(uint32 id)
 {
-	SessionMap::const_iterator itr = m_sessions.find(id);
+	SessionMap::iterator itr = m_sessions.find(id);
 
 	if (itr != m_sessions.end() && itr->second)
 	{
+		/// a player in game is left to the ai at the desk, where a new connection can resume it
+		delete itr->second;
+		m_sessions.erase(itr);
 		return true;
 	}
 
@@ -48,14 +73,12 @@ void World::AddSession_(WorldSession* s)
 {
 	ASSERT(s);
 
+	/// the newest connection of an account wins, a dropped mobile connection is often not seen closed yet
 	if (RemoveSession(s->getAccountId()))
-	{
-		//s->KickPlayer();
-		delete s;                                   
-		return;
-	}
+		TC_LOG_INFO("server.worldserver", "Account %u reconnected, the previous session is closed", s->getAccountId());
 
 	m_sessions[s->getAccountId()] = s;
+	s->StartTimeOutTimer(m_events);
 }
 
 /// Initialize the World
@@ -64,12 +87,21 @@ void World::SetInitialWorldSettings()
 	///- Server startup begin
 	uint32 startupBegin = getMSTime();
 
-	///- Initialize the random number generator
-	srand((unsigned int)time(NULL));
-
 	///- Initialize config settings
 	LoadConfigSettings();
 
+	///- Load the player progress
+	TC_LOG_INFO("server.loading", "Loading Player Store");
+	sPlayerStore->Open();
+
+	///- Map the deal table of the no-shuffle rooms, without one they shape each deal
+	std::string dealTable = sConfigMgr->GetStringDefault("DealTable.Path", "");
+	if (!dealTable.empty())
+	{
+		TC_LOG_INFO("server.loading", "Loading Deal Table");
+		sDealTable->Load(dealTable);
+	}
+
 	///- Initialize RoomManager
 	TC_LOG_INFO("server.loading", "Starting Room System");
 	sRoomMgr->Initialize();
@@ -79,6 +111,33 @@ void World::SetInitialWorldSettings()
 	TC_LOG_INFO("server.worldserver", "World initialized in %u minutes %u seconds", (startupDuration / 60000), ((startupDuration % 60000) / 1000));
 }
 
+/// Called from the main thread once the world loop is over
+void World::CleanupsBeforeStop()
+{
+	/// the sessions leave their desks before the rooms go
+	while (!m_sessions.empty())
+		RemoveSession(m_sessions.begin()->first);
+
+	sRoomMgr->UnloadAll();
+	sPlayerStore->Close();
+}
+
+/// Options read once at start, a reload keeps the values the server runs with
+struct StartupConfig
+{
+	WorldIntConfigs index;
+	char const* name;
+};
+
+static StartupConfig const StartupConfigs[] =
+{
+	{ CONFIG_PORT_WORLD, "WorldServerPort" },
+	{ CONFIG_INTERVAL_ROOMUPDATE, "RoomUpdateInterval" },
+	{ CONFIG_NUMTHREADS, "RoomUpdate.Threads" },
+	{ CONFIG_AI_PLAYER_COUNT, "aiPlayerCount" },
+	{ CONFIG_DEAL_SEED, "Deal.Seed" },
+};
+
 /// Initialize config values
 void World::LoadConfigSettings(bool reload)
 {
@@ -92,42 +151,92 @@ void World::LoadConfigSettings(bool reload)
 		}
 		sLog->LoadFromConfig();
 	}
+
+	/// only the world thread publishes
+	std::shared_ptr<WorldConfig const> current = std::atomic_load(&m_config);
+	std::shared_ptr<WorldConfig> config = std::make_shared<WorldConfig>();
+	config->generation = current ? current->generation + 1 : 0;
+
+	config->ints[CONFIG_PORT_WORLD] = sConfigMgr->GetIntDefault("WorldServerPort", 8085);
+	config->ints[CONFIG_SOCKET_TIMEOUTTIME] = sConfigMgr->GetIntDefault("SocketTimeOutTime", 30000);
+	config->ints[CONFIG_INTERVAL_ROOMUPDATE] = sConfigMgr->GetIntDefault("RoomUpdateInterval", 100);
+	config->ints[CONFIG_NUMTHREADS] = sConfigMgr->GetIntDefault("RoomUpdate.Threads", 1);
+	config->ints[CONFIG_NUMBERROOMS] = sConfigMgr->GetIntDefault("RoomNumbers", 6);
+	config->ints[CONFIG_BASICSCORE] = sConfigMgr->GetIntDefault("RoomBasicScore", 5000);
+	config->ints[CONFIG_WAIT_TIME] = sConfigMgr->GetIntDefault("waitTime", 4000);
+	config->ints[CONFIG_AI_PLAYER_COUNT] = sConfigMgr->GetIntDefault("aiPlayerCount", 10);
+	config->ints[CONFIG_AI_DELAY] = sConfigMgr->GetIntDefault("aiDelay", 2000);
+	config->ints[CONFIG_DEAL_SEED] = sConfigMgr->GetIntDefault("Deal.Seed", 0);
+	config->ints[CONFIG_BASICGOLD] = sConfigMgr->GetIntDefault("RoomBasicGold", 100);
+	config->ints[CONFIG_TURN_TIMEOUT] = sConfigMgr->GetIntDefault("TurnTimeout", 20000);
+	config->ints[CONFIG_DRAIN_TIMEOUT] = sConfigMgr->GetIntDefault("Drain.Timeout", 60000);
+	config->ints[CONFIG_SPECTATOR_ENABLE] = sConfigMgr->GetBoolDefault("Spectator.Enable", true) ? 1 : 0;
+	config->ints[CONFIG_SPECTATOR_DELAY] = sConfigMgr->GetIntDefault("Spectator.Delay", 30000);
+	config->ints[CONFIG_SPECTATOR_BUFFER_SIZE] = std::min(std::max(sConfigMgr->GetIntDefault("Spectator.BufferSize", 256), 16), 4096);
+
 	if (reload)
 	{
-		uint32 val = sConfigMgr->GetIntDefault("WorldServerPort", 8085);
-		if (val != m_int_configs[CONFIG_PORT_WORLD])
-			TC_LOG_ERROR("server.loading", "WorldServerPort option can't be changed at worldserver.conf reload, using current value (%u).", m_int_configs[CONFIG_PORT_WORLD]);
+		for (StartupConfig const& startup : StartupConfigs)
+		{
+			if (config->ints[startup.index] == current->ints[startup.index])
+				continue;
+
+			TC_LOG_ERROR("server.loading", "%s option can't be changed at worldserver.conf reload, using current value (%u).",
+				startup.name, current->ints[startup.index]);
+			config->ints[startup.index] = current->ints[startup.index];
+		}
+	}
+
+	PublishConfig(config);
+	sTickProfiler->LoadConfig();
+
+	if (reload)
+	{
+		/// the rooms read their settings from the snapshot just published
+		sRoomMgr->LoadRooms();
+		TC_LOG_INFO("server.loading", "World settings reloaded (generation %u)", config->generation);
 	}
-	else
-		m_int_configs[CONFIG_PORT_WORLD] = sConfigMgr->GetIntDefault("WorldServerPort", 8085);
-
-	m_int_configs[CONFIG_SOCKET_TIMEOUTTIME] = sConfigMgr->GetIntDefault("SocketTimeOutTime", 30000);
-	m_int_configs[CONFIG_INTERVAL_ROOMUPDATE] = sConfigMgr->GetIntDefault("RoomUpdateInterval", 100);
-	m_int_configs[CONFIG_NUMTHREADS] = sConfigMgr->GetIntDefault("RoomUpdate.Threads", 1);
-	m_int_configs[CONFIG_NUMBERROOMS] = sConfigMgr->GetIntDefault("RoomNumbers", 6);
-	m_int_configs[CONFIG_BASICSCORE] = sConfigMgr->GetIntDefault("RoomBasicScore", 5000);
-	m_int_configs[CONFIG_WAIT_TIME] = sConfigMgr->GetIntDefault("waitTime", 4000);
-	m_int_configs[CONFIG_AI_PLAYER_COUNT] = sConfigMgr->GetIntDefault("aiPlayerCount", 10);
-	m_int_configs[CONFIG_ROOM1_GOLD] = sConfigMgr->GetIntDefault("room1.Gold", 1000);
-	m_int_configs[CONFIG_ROOM2_GOLD] = sConfigMgr->GetIntDefault("room2.Gold", 7000);
-	m_int_configs[CONFIG_ROOM3_GOLD] = sConfigMgr->GetIntDefault("room3.Gold", 12000);
-	m_int_configs[CONFIG_ROOM4_GOLD] = sConfigMgr->GetIntDefault("room4.Gold", 30000);
-	m_int_configs[CONFIG_ROOM5_GOLD] = sConfigMgr->GetIntDefault("room5.Gold", 90000);
-	m_int_configs[CONFIG_ROOM6_GOLD] = sConfigMgr->GetIntDefault("room6.Gold", 300000);
-	m_int_configs[CONFIG_AI_DELAY] = sConfigMgr->GetIntDefault("aiDelay", 2000);
-	
+}
 
+void World::PublishConfig(std::shared_ptr<WorldConfig const> config)
+{
+	std::atomic_store(&m_config, std::move(config));
 }
 
 /// Update the World !
 void World::Update(uint32 diff)
 {
-	UpdateSessions(diff);
-	sRoomMgr->Update(diff);
+	WatchdogTick watchdogTick("World::Update");
+
+	/// no room update runs between the ticks, a reload here is seen whole by the next one
+	if (m_configReloadRequested.exchange(false))
+		LoadConfigSettings(true);
+
+	sHandoff->Update();
+	if (m_drainRequested.exchange(false))
+		BeginDrain();
+
+	uint32 tickBegin = getMSTime();
+	sTickProfiler->BeginTick();
+	{
+		WorldConfigScope configScope;
+		PROFILE_TICK_PHASE(TICK_PHASE_WORLD);
+
+		UpdateSessions(diff);
+		sRoomMgr->Update(diff);
+		if (m_draining)
+			UpdateDrain(diff);
+	}
+	sTickProfiler->EndTick(GetMSTimeDiffToNow(tickBegin));
+	sTickProfiler->Update(diff);
 }
 
 void World::UpdateSessions(uint32 diff)
 {
+	PROFILE_TICK_PHASE(TICK_PHASE_SESSIONS);
+
+	m_events.Update(diff);
+
 	///- Add new sessions
 	WorldSession* sess = NULL;
 	while (addSessQueue.next(sess))
@@ -148,4 +257,67 @@ void World::UpdateSessions(uint32 diff)
 			delete pSession;
 		}
 	}
+
+	_sessionsGauge->Set(m_sessions.size());
+}
+
+void World::BeginDrain()
+{
+	if (m_draining)
+		return;
+
+	m_draining = true;
+	m_drainTime = 0;
+	m_drainHandedToAi = false;
+	sRoomMgr->StopMatching();
+	sClusterNode->SendRooms();
+
+	uint32 timeout = getIntConfig(CONFIG_DRAIN_TIMEOUT);
+	for (SessionMap::const_iterator itr = m_sessions.begin(); itr != m_sessions.end(); ++itr)
+		itr->second->SendServerNotice(SERVER_NOTICE_DRAIN, (timeout + 999) / 1000);
+
+	TC_LOG_INFO("server.worldserver", "Draining: %u desks in game, the ai ends the rounds left in %u s",
+		sRoomMgr->GetDeskCount(), timeout / 1000);
+}
+
+/// Called by the world thread between the room updates
+void World::UpdateDrain(uint32 diff)
+{
+	m_drainTime += diff;
+	uint32 timeout = getIntConfig(CONFIG_DRAIN_TIMEOUT);
+
+	/// a player not at a desk has nothing to finish here, the client connects again elsewhere
+	if (m_drainTime >= DRAIN_NOTICE_DELAY)
+	{
+		std::vector<uint32> idle;
+		for (SessionMap::const_iterator itr = m_sessions.begin(); itr != m_sessions.end(); ++itr)
+		{
+			Player* player = itr->second->getPlayer();
+			if (!player || !player->getDesk())
+				idle.push_back(itr->first);
+		}
+
+		for (uint32 id : idle)
+			RemoveSession(id);
+	}
+
+	if (!m_drainHandedToAi && m_drainTime >= timeout)
+	{
+		TC_LOG_INFO("server.worldserver", "Draining: %u desks still in game after %u s, the ai ends their rounds",
+			sRoomMgr->GetDeskCount(), timeout / 1000);
+		sRoomMgr->HandDesksToAi();
+		m_drainHandedToAi = true;
+	}
+
+	uint32 desks = sRoomMgr->GetDeskCount();
+	if (desks == 0 && m_drainTime >= DRAIN_NOTICE_DELAY)
+	{
+		TC_LOG_INFO("server.worldserver", "Drained in %u s, stopping", m_drainTime / 1000);
+		StopNow(SHUTDOWN_EXIT_CODE);
+	}
+	else if (m_drainTime >= 2 * timeout)
+	{
+		TC_LOG_ERROR("server.worldserver", "Draining: %u desks still in game after %u s, stopping anyway", desks, m_drainTime / 1000);
+		StopNow(SHUTDOWN_EXIT_CODE);
+	}
 }
@@ -4,14 +4,18 @@
 
 
 #include "Common.h"
+#include "EventProcessor.h"
 #include "Timer.h"
 
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <list>
+#include <vector>
 
+class MetricGauge;
 class WorldSession;
 class WorldSocket;
 
@@ -25,13 +29,14 @@ enum WorldIntConfigs
 	CONFIG_BASICSCORE,
 	CONFIG_WAIT_TIME,
 	CONFIG_AI_PLAYER_COUNT,
-	CONFIG_ROOM1_GOLD,
-	CONFIG_ROOM2_GOLD,
-	CONFIG_ROOM3_GOLD,
-	CONFIG_ROOM4_GOLD,
-	CONFIG_ROOM5_GOLD,
-	CONFIG_ROOM6_GOLD,
 	CONFIG_AI_DELAY,
+	CONFIG_DEAL_SEED,
+	CONFIG_BASICGOLD,
+	CONFIG_TURN_TIMEOUT,
+	CONFIG_DRAIN_TIMEOUT,
+	CONFIG_SPECTATOR_ENABLE,
+	CONFIG_SPECTATOR_DELAY,
+	CONFIG_SPECTATOR_BUFFER_SIZE,
 	INT_CONFIG_VALUE_COUNT
 };
 
@@ -44,6 +49,29 @@ enum ShutdownExitCode
 
 typedef std::unordered_map<uint32, WorldSession*> SessionMap;
 
+/// Values of one load of the config. Never written once published: a reload builds a new
+/// snapshot and swaps the pointer, so a reader sees all its values from the same load.
+struct WorldConfig
+{
+	uint32 ints[INT_CONFIG_VALUE_COUNT];
+	uint32 generation;                           /// reloads before this one
+};
+
+/// Pins the snapshot current at its construction for the calling thread, until its destruction.
+/// The world tick and each room update hold one, their reads agree for the whole tick.
+class WorldConfigScope
+{
+public:
+	WorldConfigScope();
+	~WorldConfigScope();
+
+private:
+	WorldConfigScope(WorldConfigScope const&) = delete;
+	WorldConfigScope& operator=(WorldConfigScope const&) = delete;
+
+	std::shared_ptr<WorldConfig const> _previous;
+};
+
 
 /// The World
 class World
@@ -61,8 +89,17 @@ public:
 	bool RemoveSession(uint32 id);
 
 	void SetInitialWorldSettings();
+	void CleanupsBeforeStop();
 	void LoadConfigSettings(bool reload = false);
 
+	/// Asks for a reload of worldserver.conf, safe from any thread: the world thread reloads at the start of its next tick
+	void RequestConfigReload() { m_configReloadRequested = true; }
+
+	/// Asks for a drain, safe from any thread: from the next tick no game starts, the players not at
+	/// a desk are let go and the world stops once the rounds in progress are over
+	void RequestDrain() { m_drainRequested = true; }
+	bool IsDraining() const { return m_draining; }
+
 	static void StopNow(uint8 exitcode) { m_stopEvent = true; m_ExitCode = exitcode; }
 	static bool IsStopped() { return m_stopEvent; }
 
@@ -70,10 +107,19 @@ public:
 
 	void UpdateSessions(uint32 diff);
 
+	/// Snapshot of the config pinned by the thread for its tick, the latest one outside a tick.
+	/// A snapshot lives as long as a copy of it, the io threads read theirs safely without a scope.
+	std::shared_ptr<WorldConfig const> GetConfig() const
+	{
+		return m_tickConfig ? m_tickConfig : std::atomic_load(&m_config);
+	}
+
 	/// Get a server configuration element (see #WorldConfigs)
 	uint32 getIntConfig(WorldIntConfigs index) const
 	{
-		return index < INT_CONFIG_VALUE_COUNT ? m_int_configs[index] : 0;
+		if (index >= INT_CONFIG_VALUE_COUNT)
+			return 0;
+		return m_tickConfig ? m_tickConfig->ints[index] : std::atomic_load(&m_config)->ints[index];
 	}
 
 private:
@@ -88,7 +134,25 @@ private:
 	void AddSession_(WorldSession* s);
 	LockedQueue<WorldSession*> addSessQueue;
 
-	uint32 m_int_configs[INT_CONFIG_VALUE_COUNT];
+	friend class WorldConfigScope;
+
+	/// swaps the snapshot in, the one replaced is freed with its last copy
+	void PublishConfig(std::shared_ptr<WorldConfig const> config);
+
+	void BeginDrain();
+	void UpdateDrain(uint32 diff);
+
+	std::shared_ptr<WorldConfig const> m_config;  /// read and swapped with std::atomic_load and std::atomic_store
+	std::atomic<bool> m_configReloadRequested;
+	std::atomic<bool> m_drainRequested;
+	std::atomic<bool> m_draining;
+	uint32 m_drainTime;                          /// ms since the drain began
+	bool m_drainHandedToAi;
+	static thread_local std::shared_ptr<WorldConfig const> m_tickConfig;
+
+	EventProcessor m_events;                     /// events of the world thread, the socket timeouts of the sessions
+
+	MetricGauge* _sessionsGauge;
 };
 
 #define sWorld World::instance()
@@ -0,0 +1,68 @@
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <thread>
+
+#include "AsyncAcceptor.h"
+#include "Configuration/Config.h"
+#include "Log.h"
+#include "RouterClientSocket.h"
+#include "RouterNodeSocket.h"
+
+#ifndef _LANDLORD_ROUTER_CONFIG
+#define _LANDLORD_ROUTER_CONFIG  "routerserver.conf"
+#endif
+
+boost::asio::io_service _ioService;
+
+void SignalHandler(const boost::system::error_code& error, int signalNumber);
+
+/// Front of a cluster: accepts the clients and passes them to the game nodes (worldserver with
+/// Cluster.Router set) that connect to Router.NodePort.
+int main(int argc, char* argv[])
+{
+	std::string configFile = _LANDLORD_ROUTER_CONFIG;
+	std::string configError;
+	if (!sConfigMgr->LoadInitial(configFile, configError))
+	{
+		printf("Error in config file: %s\n", configError.c_str());
+		return 1;
+	}
+
+	boost::asio::signal_set signals(_ioService, SIGINT, SIGTERM);
+#if PLATFORM == PLATFORM_WINDOWS
+	signals.add(SIGBREAK);
+#endif
+	signals.async_wait(SignalHandler);
+
+	// The nodes first, a client has nowhere to go before
+	std::string nodeListener = sConfigMgr->GetStringDefault("Router.NodeBindIP", "127.0.0.1");
+	uint16 nodePort = uint16(sConfigMgr->GetIntDefault("Router.NodePort", 8090));
+	AsyncAcceptor<RouterNodeSocket> nodeAcceptor(_ioService, nodeListener, nodePort, true);
+	TC_LOG_INFO("server.router", "Waiting for the game nodes on %s:%u", nodeListener.c_str(), nodePort);
+
+	std::string clientListener = sConfigMgr->GetStringDefault("BindIP", "0.0.0.0");
+	uint16 clientPort = uint16(sConfigMgr->GetIntDefault("RouterPort", 8085));
+	AsyncAcceptor<RouterClientSocket> clientAcceptor(_ioService, clientListener, clientPort,
+		sConfigMgr->GetBoolDefault("Network.TcpNodelay", true));
+	TC_LOG_INFO("server.router", "Router listening on %s:%u", clientListener.c_str(), clientPort);
+
+	int numThreads = sConfigMgr->GetIntDefault("ThreadPool", 2);
+	if (numThreads < 1)
+		numThreads = 1;
+
+	std::vector<std::thread> threadPool;
+	for (int i = 0; i < numThreads; ++i)
+		threadPool.push_back(std::thread(boost::bind(&boost::asio::io_service::run, &_ioService)));
+
+	for (auto& thread : threadPool)
+		thread.join();
+
+	TC_LOG_INFO("server.router", "Router stopped");
+	return 0;
+}
+
+void SignalHandler(const boost::system::error_code& error, int /*signalNumber*/)
+{
+	if (!error)
+		_ioService.stop();
+}
@@ -0,0 +1,154 @@
+#include "Router.h"
+
+#include "Log.h"
+#include "RouterNodeSocket.h"
+
+#include <algorithm>
+
+uint32 Router::NewClientId()
+{
+	/// 0 is the node itself on the links
+	uint32 id = ++_nextClientId;
+	return id ? id : ++_nextClientId;
+}
+
+Router::NodePtr Router::RouteLogin(uint32 accountId, uint32 roomId)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	/// the node refuses or resumes the account, it knows best
+	std::unordered_map<uint32, NodePtr>::const_iterator player = _players.find(accountId);
+	if (player != _players.end())
+		return player->second;
+
+	std::unordered_map<uint32, NodeListType>::const_iterator room = _roomNodes.find(roomId);
+	if (room == _roomNodes.end() || room->second.empty())
+		return NodePtr();
+
+	return room->second.front();
+}
+
+Router::NodePtr Router::RouteResume(uint32 accountId)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	std::unordered_map<uint32, NodePtr>::const_iterator player = _players.find(accountId);
+	return player != _players.end() ? player->second : NodePtr();
+}
+
+void Router::AddNode(NodePtr const& node)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	for (NodePtr const& other : _nodes)
+		if (other->GetNodeId() == node->GetNodeId())
+			TC_LOG_WARN("server.router", "Node %u connected twice, a server taking over from the other one?", node->GetNodeId());
+
+	_nodes.push_back(node);
+	_nodeRooms[node.get()];
+	TC_LOG_INFO("server.router", "Node %u connected from %s, %u nodes", node->GetNodeId(),
+		node->GetRemoteIpAddress().to_string().c_str(), uint32(_nodes.size()));
+}
+
+void Router::SetNodeRooms(NodePtr const& node, std::vector<uint32> const& rooms)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	/// the link may have closed while the message was read
+	std::unordered_map<RouterNodeSocket*, std::set<uint32>>::iterator nodeRooms = _nodeRooms.find(node.get());
+	if (nodeRooms == _nodeRooms.end())
+		return;
+
+	std::set<uint32>& current = nodeRooms->second;
+	std::set<uint32> wanted(rooms.begin(), rooms.end());
+
+	for (uint32 roomId : current)
+		if (!wanted.count(roomId))
+			RemoveRoomNode(roomId, node.get());
+
+	for (uint32 roomId : wanted)
+	{
+		if (current.count(roomId))
+			continue;
+
+		NodeListType& nodes = _roomNodes[roomId];
+		nodes.push_back(node);
+		if (nodes.size() == 1)
+			TC_LOG_INFO("server.router", "Room %u is on node %u", roomId, node->GetNodeId());
+	}
+
+	current.swap(wanted);
+}
+
+void Router::RemoveRoomNode(uint32 roomId, RouterNodeSocket* node)
+{
+	NodeListType& nodes = _roomNodes[roomId];
+	NodeListType::iterator itr = std::find_if(nodes.begin(), nodes.end(), [node](NodePtr const& other) { return other.get() == node; });
+	if (itr == nodes.end())
+		return;
+
+	bool owner = itr == nodes.begin();
+	nodes.erase(itr);
+	if (!owner)
+		return;
+
+	if (nodes.empty())
+		TC_LOG_WARN("server.router", "Room %u left node %u, no node takes players in it", roomId, node->GetNodeId());
+	else
+		TC_LOG_INFO("server.router", "Room %u left node %u, it is on node %u now", roomId, node->GetNodeId(), nodes.front()->GetNodeId());
+}
+
+void Router::AddPlayers(NodePtr const& node, std::vector<uint32> const& ids)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	if (!_nodeRooms.count(node.get()))
+		return;
+
+	for (uint32 id : ids)
+		_players[id] = node;
+}
+
+void Router::RemovePlayers(NodePtr const& node, std::vector<uint32> const& ids)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	/// the account may be in game at another node since
+	for (uint32 id : ids)
+	{
+		std::unordered_map<uint32, NodePtr>::iterator itr = _players.find(id);
+		if (itr != _players.end() && itr->second == node)
+			_players.erase(itr);
+	}
+}
+
+void Router::RemoveNode(RouterNodeSocket* node)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	NodeListType::iterator itr = std::find_if(_nodes.begin(), _nodes.end(), [node](NodePtr const& other) { return other.get() == node; });
+	if (itr == _nodes.end())
+		return;
+
+	/// keeps the node alive until it is out of every list
+	NodePtr removed = *itr;
+	_nodes.erase(itr);
+
+	for (uint32 roomId : _nodeRooms[node])
+		RemoveRoomNode(roomId, node);
+	_nodeRooms.erase(node);
+
+	uint32 players = 0;
+	for (std::unordered_map<uint32, NodePtr>::iterator player = _players.begin(); player != _players.end();)
+	{
+		if (player->second.get() == node)
+		{
+			player = _players.erase(player);
+			++players;
+		}
+		else
+			++player;
+	}
+
+	TC_LOG_ERROR("server.router", "Node %u is gone with %u players in game, %u nodes left", node->GetNodeId(), players, uint32(_nodes.size()));
+}
@@ -0,0 +1,63 @@
+#ifndef _ROUTER_H
+#define _ROUTER_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class RouterNodeSocket;
+
+/// Where the clients go: the login to a room goes to the first node that opened the room and still
+/// takes new players in it, the others opening it wait to take over. An account in game at a node
+/// goes back to that node, whatever the room it asks, and it resumes there.
+/// A node lost takes its clients with it, they connect again and go to the nodes left.
+class Router
+{
+public:
+	typedef std::shared_ptr<RouterNodeSocket> NodePtr;
+
+	static Router* instance()
+	{
+		static Router instance;
+		return &instance;
+	}
+
+	uint32 NewClientId();
+
+	/// null when no node takes players in the room
+	NodePtr RouteLogin(uint32 accountId, uint32 roomId);
+	/// null when the account is in game nowhere
+	NodePtr RouteResume(uint32 accountId);
+
+	void AddNode(NodePtr const& node);
+	/// all the rooms the node takes new players in, the ones missing are handed to the next node
+	void SetNodeRooms(NodePtr const& node, std::vector<uint32> const& rooms);
+	void AddPlayers(NodePtr const& node, std::vector<uint32> const& ids);
+	void RemovePlayers(NodePtr const& node, std::vector<uint32> const& ids);
+	void RemoveNode(RouterNodeSocket* node);
+
+private:
+	Router() : _nextClientId(0) { }
+
+	/// under _lock
+	void RemoveRoomNode(uint32 roomId, RouterNodeSocket* node);
+
+	typedef std::vector<NodePtr> NodeListType;
+
+	std::atomic<uint32> _nextClientId;
+
+	std::mutex _lock;
+	NodeListType _nodes;
+	std::unordered_map<RouterNodeSocket*, std::set<uint32>> _nodeRooms;
+	std::unordered_map<uint32, NodeListType> _roomNodes;      /// in the order they opened the room
+	std::unordered_map<uint32, NodePtr> _players;               /// account ids in game
+};
+
+#define sRouter Router::instance()
+
+#endif
@@ -0,0 +1,164 @@
+#include "RouterClientSocket.h"
+
+#include "ClusterProtocol.h"
+#include "Opcodes.h"
+#include "Router.h"
+#include "RouterNodeSocket.h"
+
+#define ROUTER_MAX_PACKET_SIZE 10240
+
+RouterClientSocket::RouterClientSocket(tcp::socket&& socket)
+	: Base(std::move(socket), sizeof(RouterPktHeader)), _id(sRouter->NewClientId()), _nodeClosed(false)
+{
+}
+
+void RouterClientSocket::CloseSocket()
+{
+	Base::CloseSocket();
+
+	std::shared_ptr<RouterNodeSocket> node;
+	{
+		std::lock_guard<std::mutex> lock(_nodeLock);
+		node.swap(_node);
+	}
+
+	if (!node)
+		return;
+
+	node->RemoveClient(_id);
+	if (!_nodeClosed)
+		node->SendMessage(CLUSTER_CLIENT_CLOSE, _id, nullptr, 0);
+}
+
+void RouterClientSocket::SendRaw(uint8 const* data, std::size_t size)
+{
+	if (!IsOpen())
+		return;
+
+	std::lock_guard<std::mutex> guard(_writeLock);
+
+	bool needsWriteStart = _writeQueue.empty();
+
+	_writeQueue.push(std::vector<uint8>(data, data + size));
+
+	if (needsWriteStart)
+		AsyncWrite(_writeQueue.front());
+}
+
+void RouterClientSocket::CloseByNode()
+{
+	_nodeClosed = true;
+	DelayedClose();
+}
+
+void RouterClientSocket::DelayedClose()
+{
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		if (!_writeQueue.empty())
+		{
+			DelayedCloseSocket();
+			return;
+		}
+	}
+
+	CloseSocket();
+}
+
+void RouterClientSocket::ReadHeaderHandler()
+{
+	RouterPktHeader* header = reinterpret_cast<RouterPktHeader*>(GetHeaderBuffer());
+
+	if (header->size < sizeof(RouterPktHeader) || header->size >= ROUTER_MAX_PACKET_SIZE || header->cmd >= NUM_MSG_TYPES)
+	{
+		TC_LOG_ERROR("network", "RouterClientSocket::ReadHeaderHandler(): client %s sent malformed packet (size: %u, cmd: %u)",
+			GetRemoteIpAddress().to_string().c_str(), header->size, header->cmd);
+		CloseSocket();
+		return;
+	}
+
+	AsyncReadData(header->size - sizeof(RouterPktHeader));
+}
+
+void RouterClientSocket::ReadDataHandler()
+{
+	/// what the client sends while the node closes it goes nowhere
+	if (_nodeClosed)
+		return;
+
+	std::shared_ptr<RouterNodeSocket> node;
+	{
+		std::lock_guard<std::mutex> lock(_nodeLock);
+		node = _node;
+	}
+
+	if (!node)
+	{
+		node = Route();
+		if (!node)
+			return;
+	}
+
+	node->SendClientPacket(_id, GetHeaderBuffer(), sizeof(RouterPktHeader), GetDataBuffer(), GetDataSize());
+
+	AsyncReadHeader();
+}
+
+std::shared_ptr<RouterNodeSocket> RouterClientSocket::Route()
+{
+	RouterPktHeader* header = reinterpret_cast<RouterPktHeader*>(GetHeaderBuffer());
+	uint8 const* data = GetDataBuffer();
+	std::size_t size = GetDataSize();
+
+	/// the data starts with two uint32 the client leaves at 0, then come the fields WorldSession reads
+	uint32 accountId = 0;
+	uint32 roomId = 0;
+	std::shared_ptr<RouterNodeSocket> node;
+	if (header->cmd == CMSG_PLAYER_LOGIN && size >= 24)
+	{
+		memcpy(&roomId, data + 12, sizeof(roomId));
+		memcpy(&accountId, data + 20, sizeof(accountId));
+		node = sRouter->RouteLogin(accountId, roomId);
+	}
+	else if ((header->cmd == CMSG_PLAYER_RESUME || header->cmd == CMSG_SPECTATE) && size >= 12)
+	{
+		/// a spectator goes where the account it watches plays
+		memcpy(&accountId, data + 8, sizeof(accountId));
+		node = sRouter->RouteResume(accountId);
+	}
+	else
+	{
+		TC_LOG_ERROR("network", "RouterClientSocket::Route(): client %s sent opcode %u before logging in",
+			GetRemoteIpAddress().to_string().c_str(), header->cmd);
+		CloseSocket();
+		return nullptr;
+	}
+
+	if (!node || !node->AddClient(shared_from_this(), _id))
+	{
+		if (header->cmd == CMSG_PLAYER_LOGIN)
+			TC_LOG_WARN("server.router", "No node takes players in room %u, the login of account %u fails", roomId, accountId);
+		else if (header->cmd == CMSG_PLAYER_RESUME)
+			TC_LOG_WARN("server.router", "Account %u is in game at no node, its resume fails", accountId);
+		else
+			TC_LOG_DEBUG("server.router", "Account %u is in game at no node, nothing to watch", accountId);
+		SendFailure(header->cmd);
+		DelayedClose();
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_nodeLock);
+		_node = node;
+	}
+
+	TC_LOG_DEBUG("server.router", "Client %u (account %u) goes to node %u", _id, accountId, node->GetNodeId());
+	return node;
+}
+
+void RouterClientSocket::SendFailure(uint32 cmd)
+{
+	/// LOGIN_RESULT_FAILED, SPECTATE_RESULT_FAILED: the node replies the same way to the request
+	uint32 packet[5] = { sizeof(packet), cmd, 0, 0, 0 };
+	SendRaw(reinterpret_cast<uint8 const*>(packet), sizeof(packet));
+}
@@ -0,0 +1,60 @@
+#ifndef _ROUTER_CLIENT_SOCKET_H
+#define _ROUTER_CLIENT_SOCKET_H
+
+#include "Socket.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class RouterNodeSocket;
+
+#pragma pack(push, 1)
+
+/// header of the client packets, as WorldSocket reads it
+struct RouterPktHeader
+{
+	uint32 size;
+	uint32 cmd;
+};
+
+#pragma pack(pop)
+
+/// Client connection, its login or resume picks the node all its packets go to
+class RouterClientSocket : public Socket<RouterClientSocket, std::vector<uint8>>
+{
+	typedef Socket<RouterClientSocket, std::vector<uint8>> Base;
+
+public:
+	explicit RouterClientSocket(tcp::socket&& socket);
+
+	void Start() override { AsyncReadHeader(); }
+	/// tells the node the client is gone
+	void CloseSocket() override;
+
+	/// packet from the node, header included
+	void SendRaw(uint8 const* data, std::size_t size);
+	/// the node closed the client or is gone: what it sent is written, then the connection closes
+	void CloseByNode();
+
+protected:
+	void ReadHeaderHandler() override;
+	void ReadDataHandler() override;
+
+private:
+	/// picks the node from the first packet, null when there is none for the client
+	std::shared_ptr<RouterNodeSocket> Route();
+	/// failure reply to the login, resume or spectate request the client routed with
+	void SendFailure(uint32 cmd);
+	/// closes once what is queued is written
+	void DelayedClose();
+
+	uint32 _id;
+
+	std::mutex _nodeLock;
+	std::shared_ptr<RouterNodeSocket> _node;
+	std::atomic<bool> _nodeClosed;
+};
+
+#endif
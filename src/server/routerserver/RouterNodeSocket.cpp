@@ -0,0 +1,157 @@
+#include "RouterNodeSocket.h"
+
+#include "Router.h"
+#include "RouterClientSocket.h"
+
+void RouterNodeSocket::CloseSocket()
+{
+	Base::CloseSocket();
+	sRouter->RemoveNode(this);
+
+	ClientMapType clients;
+	{
+		std::lock_guard<std::mutex> lock(_clientsLock);
+		clients.swap(_clients);
+	}
+
+	for (ClientMapType::iterator itr = clients.begin(); itr != clients.end(); ++itr)
+		itr->second->CloseByNode();
+}
+
+bool RouterNodeSocket::AddClient(std::shared_ptr<RouterClientSocket> const& client, uint32 id)
+{
+	std::lock_guard<std::mutex> lock(_clientsLock);
+
+	/// a link closing has taken its clients already
+	if (!IsOpen())
+		return false;
+
+	_clients[id] = client;
+	return true;
+}
+
+void RouterNodeSocket::RemoveClient(uint32 id)
+{
+	std::lock_guard<std::mutex> lock(_clientsLock);
+	_clients.erase(id);
+}
+
+std::shared_ptr<RouterClientSocket> RouterNodeSocket::FindClient(uint32 id, bool remove)
+{
+	std::lock_guard<std::mutex> lock(_clientsLock);
+
+	ClientMapType::iterator itr = _clients.find(id);
+	if (itr == _clients.end())
+		return nullptr;
+
+	std::shared_ptr<RouterClientSocket> client = itr->second;
+	if (remove)
+		_clients.erase(itr);
+	return client;
+}
+
+void RouterNodeSocket::SendMessage(uint16 type, uint32 client, void const* data, std::size_t size)
+{
+	if (!IsOpen())
+		return;
+
+	std::lock_guard<std::mutex> guard(_writeLock);
+
+	bool needsWriteStart = _writeQueue.empty();
+
+	_writeQueue.push(BuildClusterMessage(type, client, data, size));
+
+	if (needsWriteStart)
+		AsyncWrite(_writeQueue.front());
+}
+
+void RouterNodeSocket::SendClientPacket(uint32 client, uint8 const* header, std::size_t headerSize, uint8 const* data, std::size_t size)
+{
+	if (!IsOpen())
+		return;
+
+	std::vector<uint8> message = BuildClusterMessage(CLUSTER_CLIENT_DATA, client, nullptr, headerSize + size);
+	memcpy(message.data() + sizeof(ClusterHeader), header, headerSize);
+	if (size)
+		memcpy(message.data() + sizeof(ClusterHeader) + headerSize, data, size);
+
+	std::lock_guard<std::mutex> guard(_writeLock);
+
+	bool needsWriteStart = _writeQueue.empty();
+
+	_writeQueue.push(std::move(message));
+
+	if (needsWriteStart)
+		AsyncWrite(_writeQueue.front());
+}
+
+std::vector<uint32> RouterNodeSocket::ReadIds()
+{
+	std::vector<uint32> ids(GetDataSize() / sizeof(uint32));
+	if (!ids.empty())
+		memcpy(ids.data(), GetDataBuffer(), ids.size() * sizeof(uint32));
+	return ids;
+}
+
+void RouterNodeSocket::ReadHeaderHandler()
+{
+	ClusterHeader* header = reinterpret_cast<ClusterHeader*>(GetHeaderBuffer());
+
+	/// the node says who it is first, and once
+	bool hello = header->type == CLUSTER_NODE_HELLO;
+	if (header->type < CLUSTER_NODE_HELLO || header->type > CLUSTER_CLIENT_CLOSE || hello != !_nodeId)
+	{
+		TC_LOG_ERROR("server.router", "Node %s sent an unexpected message (type %u), closing the link",
+			GetRemoteIpAddress().to_string().c_str(), uint32(header->type));
+		CloseSocket();
+		return;
+	}
+
+	AsyncReadData(header->size);
+}
+
+void RouterNodeSocket::ReadDataHandler()
+{
+	ClusterHeader* header = reinterpret_cast<ClusterHeader*>(GetHeaderBuffer());
+
+	switch (header->type)
+	{
+		case CLUSTER_NODE_HELLO:
+		{
+			uint32 hello[2] = { 0, 0 };
+			if (GetDataSize() >= sizeof(hello))
+				memcpy(hello, GetDataBuffer(), sizeof(hello));
+
+			if (hello[0] != CLUSTER_PROTOCOL_VERSION || !hello[1])
+			{
+				TC_LOG_ERROR("server.router", "Node %s speaks version %u of the cluster protocol, this router %u",
+					GetRemoteIpAddress().to_string().c_str(), hello[0], CLUSTER_PROTOCOL_VERSION);
+				CloseSocket();
+				return;
+			}
+
+			_nodeId = hello[1];
+			sRouter->AddNode(shared_from_this());
+			break;
+		}
+		case CLUSTER_NODE_ROOMS:
+			sRouter->SetNodeRooms(shared_from_this(), ReadIds());
+			break;
+		case CLUSTER_PLAYER_ENTER:
+			sRouter->AddPlayers(shared_from_this(), ReadIds());
+			break;
+		case CLUSTER_PLAYER_LEAVE:
+			sRouter->RemovePlayers(shared_from_this(), ReadIds());
+			break;
+		case CLUSTER_CLIENT_DATA:
+			if (std::shared_ptr<RouterClientSocket> client = FindClient(header->client, false))
+				client->SendRaw(GetDataBuffer(), GetDataSize());
+			break;
+		case CLUSTER_CLIENT_CLOSE:
+			if (std::shared_ptr<RouterClientSocket> client = FindClient(header->client, true))
+				client->CloseByNode();
+			break;
+	}
+
+	AsyncReadHeader();
+}
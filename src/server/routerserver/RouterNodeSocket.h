@@ -0,0 +1,52 @@
+#ifndef _ROUTER_NODE_SOCKET_H
+#define _ROUTER_NODE_SOCKET_H
+
+#include "ClusterProtocol.h"
+#include "Socket.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class RouterClientSocket;
+
+/// Link of a game node, it connected to Router.NodePort
+class RouterNodeSocket : public Socket<RouterNodeSocket, std::vector<uint8>>
+{
+	typedef Socket<RouterNodeSocket, std::vector<uint8>> Base;
+
+public:
+	explicit RouterNodeSocket(tcp::socket&& socket) : Base(std::move(socket), sizeof(ClusterHeader)), _nodeId(0) { }
+
+	void Start() override { AsyncReadHeader(); }
+	/// the clients of the node are closed with the link, they connect again to another node
+	void CloseSocket() override;
+
+	uint32 GetNodeId() const { return _nodeId; }
+
+	/// false once the link is closed
+	bool AddClient(std::shared_ptr<RouterClientSocket> const& client, uint32 id);
+	void RemoveClient(uint32 id);
+
+	void SendMessage(uint16 type, uint32 client, void const* data, std::size_t size);
+	/// a client packet, its header and its data are read apart
+	void SendClientPacket(uint32 client, uint8 const* header, std::size_t headerSize, uint8 const* data, std::size_t size);
+
+protected:
+	void ReadHeaderHandler() override;
+	void ReadDataHandler() override;
+
+private:
+	typedef std::unordered_map<uint32, std::shared_ptr<RouterClientSocket>> ClientMapType;
+
+	std::vector<uint32> ReadIds();
+	std::shared_ptr<RouterClientSocket> FindClient(uint32 id, bool remove);
+
+	uint32 _nodeId;                                 /// 0 until the node said hello
+
+	std::mutex _clientsLock;
+	ClientMapType _clients;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "Watchdog.h"
+#include "Log.h"
+
+#include <chrono>
+#include <sstream>
+
+#if PLATFORM == PLATFORM_UNIX
+#  include <execinfo.h>
+#  include <pthread.h>
+#  include <signal.h>
+#  define WATCHDOG_BACKTRACE_SIGNAL SIGUSR2
+#endif
+
+namespace
+{
+#if PLATFORM == PLATFORM_UNIX
+    // filled by the stuck thread itself from the signal handler
+    std::atomic<bool> captureRequested(false);
+    std::atomic<bool> captureDone(false);
+    void* captureFrames[WATCHDOG_MAX_FRAMES];
+    int captureFrameCount = 0;
+
+    void BacktraceSignalHandler(int /*signal*/)
+    {
+        if (!captureRequested.load(std::memory_order_acquire))
+            return;
+
+        captureFrameCount = backtrace(captureFrames, WATCHDOG_MAX_FRAMES);
+        captureDone.store(true, std::memory_order_release);
+    }
+#endif
+
+    // threads registered past WATCHDOG_MAX_THREADS share this slot and are not watched
+    WatchdogSlot overflowSlot;
+} // namespace
+
+WatchdogSlot::WatchdogSlot() : tickStart(0), tickSequence(0), tickName(nullptr), phase(nullptr),
+    room(WATCHDOG_NO_ID), desk(WATCHDOG_NO_ID), player(WATCHDOG_NO_ID), reportedSequence(0), thread()
+{
+    threadName[0] = '\0';
+}
+
+Watchdog::Watchdog() : _slotCount(0), _threshold(0), _checkInterval(0), _reportCooldown(0), _lastReport(0),
+    _suppressedReports(0), _running(false)
+{
+}
+
+Watchdog::~Watchdog()
+{
+    Stop();
+}
+
+uint64 Watchdog::Now()
+{
+    static std::chrono::steady_clock::time_point const epoch = std::chrono::steady_clock::now();
+
+    // never 0, which marks an idle slot
+    return uint64(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count()) + 1;
+}
+
+WatchdogSlot* Watchdog::GetThreadSlot()
+{
+    static thread_local WatchdogSlot* slot = nullptr;
+    if (slot)
+        return slot;
+
+    uint32 index = _slotCount.load(std::memory_order_relaxed);
+    do
+    {
+        if (index >= WATCHDOG_MAX_THREADS)
+        {
+            slot = &overflowSlot;
+            return slot;
+        }
+    } while (!_slotCount.compare_exchange_weak(index, index + 1));
+
+    slot = &_slots[index];
+#if PLATFORM == PLATFORM_UNIX
+    slot->thread = pthread_self();
+#endif
+    snprintf(slot->threadName, sizeof(slot->threadName), "thread %u", index);
+    return slot;
+}
+
+void Watchdog::SetThreadName(char const* name)
+{
+    WatchdogSlot* slot = GetThreadSlot();
+    snprintf(slot->threadName, sizeof(slot->threadName), "%s", name);
+}
+
+void Watchdog::Start(uint32 threshold, uint32 checkInterval, uint32 reportCooldown)
+{
+    if (_running || !threshold)
+        return;
+
+    _threshold = threshold;
+    _checkInterval = checkInterval ? checkInterval : 100;
+    _reportCooldown = reportCooldown;
+
+#if PLATFORM == PLATFORM_UNIX
+    // the first call of backtrace() loads libgcc, which is not safe from a signal handler
+    void* frames[1];
+    backtrace(frames, 1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &BacktraceSignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(WATCHDOG_BACKTRACE_SIGNAL, &action, nullptr);
+#endif
+
+    _running = true;
+    _thread = std::thread(&Watchdog::Run, this);
+
+    TC_LOG_INFO("server.watchdog", "Watchdog started, reporting ticks longer than %u ms", _threshold);
+}
+
+void Watchdog::Stop()
+{
+    if (!_running.exchange(false))
+        return;
+
+    _wakeUp.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void Watchdog::Run()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    while (_running)
+    {
+        _wakeUp.wait_for(lock, std::chrono::milliseconds(_checkInterval));
+        if (!_running)
+            break;
+
+        Check(Now());
+    }
+}
+
+void Watchdog::Check(uint64 now)
+{
+    uint32 count = std::min<uint32>(_slotCount.load(std::memory_order_acquire), WATCHDOG_MAX_THREADS);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        WatchdogSlot& slot = _slots[i];
+
+        uint64 start = slot.tickStart.load(std::memory_order_acquire);
+        if (!start || now < start || now - start < _threshold)
+            continue;
+
+        uint32 sequence = slot.tickSequence.load(std::memory_order_relaxed);
+        if (slot.reportedSequence == sequence)
+            continue;
+
+        slot.reportedSequence = sequence;
+
+        if (_lastReport && now - _lastReport < uint64(_reportCooldown) * IN_MILLISECONDS)
+        {
+            ++_suppressedReports;
+            continue;
+        }
+
+        _lastReport = now;
+        Report(slot, now - start);
+    }
+}
+
+static std::string FormatId(uint32 id)
+{
+    if (id == WATCHDOG_NO_ID)
+        return "-";
+
+    std::ostringstream ss;
+    ss << id;
+    return ss.str();
+}
+
+void Watchdog::Report(WatchdogSlot& slot, uint64 elapsed)
+{
+    char const* tickName = slot.tickName.load(std::memory_order_relaxed);
+    char const* phase = slot.phase.load(std::memory_order_relaxed);
+
+    TC_LOG_ERROR("server.watchdog", "%s on %s is running for " UI64FMTD " ms (threshold %u ms): room %s, desk %s, player %s, phase %s (%u reports suppressed)",
+        tickName ? tickName : "tick", slot.threadName, elapsed, _threshold, FormatId(slot.room).c_str(), FormatId(slot.desk).c_str(),
+        FormatId(slot.player).c_str(), phase ? phase : "-", _suppressedReports);
+
+    _suppressedReports = 0;
+
+    std::istringstream backtrace(CaptureBacktrace(slot));
+    std::string line;
+    while (std::getline(backtrace, line))
+        TC_LOG_ERROR("server.watchdog", "  %s", line.c_str());
+}
+
+std::string Watchdog::CaptureBacktrace(WatchdogSlot& slot)
+{
+#if PLATFORM == PLATFORM_UNIX
+    captureDone.store(false, std::memory_order_relaxed);
+    captureRequested.store(true, std::memory_order_release);
+
+    if (pthread_kill(slot.thread, WATCHDOG_BACKTRACE_SIGNAL) != 0)
+    {
+        captureRequested = false;
+        return "backtrace unavailable: the thread is gone";
+    }
+
+    for (uint32 waited = 0; waited < 200 && !captureDone.load(std::memory_order_acquire); ++waited)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    captureRequested.store(false, std::memory_order_release);
+    if (!captureDone.load(std::memory_order_acquire))
+        return "backtrace unavailable: the thread did not answer";
+
+    std::ostringstream ss;
+    if (char** symbols = backtrace_symbols(captureFrames, captureFrameCount))
+    {
+        // frame 0 and 1 are the signal handler and the signal trampoline
+        for (int i = 2; i < captureFrameCount; ++i)
+            ss << '#' << (i - 2) << ' ' << symbols[i] << '\n';
+        free(symbols);
+    }
+    return ss.str();
+#else
+    (void)slot;
+    return "backtrace unavailable on this platform";
+#endif
+}
+
+WatchdogTick::WatchdogTick(char const* name, uint32 room) : _slot(sWatchdog->GetThreadSlot())
+{
+    _outermost = _slot->tickStart.load(std::memory_order_relaxed) == 0;
+    _prevRoom = _slot->room.load(std::memory_order_relaxed);
+
+    _slot->room.store(room, std::memory_order_relaxed);
+    if (!_outermost)
+        return;
+
+    _slot->tickName.store(name, std::memory_order_relaxed);
+    _slot->tickSequence.fetch_add(1, std::memory_order_relaxed);
+    _slot->tickStart.store(Watchdog::Now(), std::memory_order_release);
+}
+
+WatchdogTick::~WatchdogTick()
+{
+    if (_outermost)
+        _slot->tickStart.store(0, std::memory_order_release);
+
+    _slot->room.store(_prevRoom, std::memory_order_relaxed);
+}
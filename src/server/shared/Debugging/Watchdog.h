@@ -0,0 +1,123 @@
+#ifndef TRINITYCORE_WATCHDOG_H
+#define TRINITYCORE_WATCHDOG_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define WATCHDOG_MAX_THREADS 64
+#define WATCHDOG_MAX_FRAMES  64
+#define WATCHDOG_NO_ID       0xFFFFFFFF
+
+/// What a thread is currently doing. Written only by the owning thread,
+/// read by the watchdog thread.
+struct WatchdogSlot
+{
+    WatchdogSlot();
+
+    std::atomic<uint64> tickStart;                  // steady clock ms, 0 when idle
+    std::atomic<uint32> tickSequence;               // bumped by every tick, one report per tick
+    std::atomic<char const*> tickName;
+    std::atomic<char const*> phase;
+    std::atomic<uint32> room;
+    std::atomic<uint32> desk;
+    std::atomic<uint32> player;
+    uint32 reportedSequence;
+    char threadName[32];
+    std::thread::native_handle_type thread;
+};
+
+/// Watches world and room ticks from a separate thread and reports the ones running over
+/// the threshold with the room, desk and phase being executed and a backtrace of the stuck thread.
+class Watchdog
+{
+public:
+    static Watchdog* instance()
+    {
+        static Watchdog instance;
+        return &instance;
+    }
+
+    void Start(uint32 threshold, uint32 checkInterval, uint32 reportCooldown);
+    void Stop();
+    bool IsRunning() const { return _running; }
+
+    /// slot of the calling thread, registered on first use
+    WatchdogSlot* GetThreadSlot();
+    void SetThreadName(char const* name);
+
+    /// desk and player the calling thread is working on, restored by the enclosing WatchdogContext
+    void SetCurrentDesk(uint32 desk) { GetThreadSlot()->desk.store(desk, std::memory_order_relaxed); }
+    void SetCurrentPlayer(uint32 player) { GetThreadSlot()->player.store(player, std::memory_order_relaxed); }
+
+    static uint64 Now();
+
+private:
+    Watchdog();
+    ~Watchdog();
+
+    void Run();
+    void Check(uint64 now);
+    void Report(WatchdogSlot& slot, uint64 elapsed);
+    std::string CaptureBacktrace(WatchdogSlot& slot);
+
+    WatchdogSlot _slots[WATCHDOG_MAX_THREADS];
+    std::atomic<uint32> _slotCount;
+
+    uint32 _threshold;
+    uint32 _checkInterval;
+    uint32 _reportCooldown;
+    uint64 _lastReport;
+    uint32 _suppressedReports;
+
+    std::atomic<bool> _running;
+    std::thread _thread;
+    std::mutex _lock;
+    std::condition_variable _wakeUp;
+};
+
+#define sWatchdog Watchdog::instance()
+
+/// Marks a tick of the calling thread; nested ticks keep the outermost start time
+class WatchdogTick
+{
+public:
+    WatchdogTick(char const* name, uint32 room = WATCHDOG_NO_ID);
+    ~WatchdogTick();
+
+private:
+    WatchdogSlot* _slot;
+    bool _outermost;
+    uint32 _prevRoom;
+};
+
+/// Records the phase, desk or player the calling thread is working on for the lifetime of the scope
+class WatchdogContext
+{
+public:
+    explicit WatchdogContext(char const* phase) : _slot(sWatchdog->GetThreadSlot())
+    {
+        _prevPhase = _slot->phase.exchange(phase, std::memory_order_relaxed);
+        _prevDesk = _slot->desk.load(std::memory_order_relaxed);
+        _prevPlayer = _slot->player.load(std::memory_order_relaxed);
+    }
+
+    ~WatchdogContext()
+    {
+        _slot->phase.store(_prevPhase, std::memory_order_relaxed);
+        _slot->desk.store(_prevDesk, std::memory_order_relaxed);
+        _slot->player.store(_prevPlayer, std::memory_order_relaxed);
+    }
+
+private:
+    WatchdogSlot* _slot;
+    char const* _prevPhase;
+    uint32 _prevDesk;
+    uint32 _prevPlayer;
+};
+
+#endif
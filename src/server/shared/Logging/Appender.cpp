@@ -74,33 +74,57 @@ void Appender::write(LogMessage& message)
         return;
 
     message.prefix.clear();
+    buildPrefix(message.prefix, message.level, message.type, message.mtime);
+
+    _write(message);
+}
+
+void Appender::queue(LogLevel msgLevel, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length)
+{
+    if (!level || level > msgLevel)
+        return;
+
+    _queue(msgLevel, type, mtime, param1, text, length);
+}
+
+void Appender::_queue(LogLevel msgLevel, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length)
+{
+    // appenders without a batched path write right away from the flusher thread
+    LogMessage message(msgLevel, type, std::string(text, length));
+    message.mtime = mtime;
+    message.param1 = param1;
+
+    buildPrefix(message.prefix, msgLevel, type, mtime);
+    _write(message);
+}
+
+void Appender::buildPrefix(std::string& prefix, LogLevel msgLevel, std::string const& type, time_t mtime) const
+{
     if (flags & APPENDER_FLAGS_PREFIX_TIMESTAMP)
-        message.prefix.append(message.getTimeStr());
+        prefix.append(LogMessage::getTimeStr(mtime));
 
     if (flags & APPENDER_FLAGS_PREFIX_LOGLEVEL)
     {
-        if (!message.prefix.empty())
-            message.prefix.push_back(' ');
+        if (!prefix.empty())
+            prefix.push_back(' ');
 
-        char text[MAX_QUERY_LEN];
-        snprintf(text, MAX_QUERY_LEN, "%-5s", Appender::getLogLevelString(message.level));
-        message.prefix.append(text);
+        char text[16];
+        snprintf(text, sizeof(text), "%-5s", Appender::getLogLevelString(msgLevel));
+        prefix.append(text);
     }
 
     if (flags & APPENDER_FLAGS_PREFIX_LOGFILTERTYPE)
     {
-        if (!message.prefix.empty())
-            message.prefix.push_back(' ');
+        if (!prefix.empty())
+            prefix.push_back(' ');
 
-        message.prefix.push_back('[');
-        message.prefix.append(message.type);
-        message.prefix.push_back(']');
+        prefix.push_back('[');
+        prefix.append(type);
+        prefix.push_back(']');
     }
 
-    if (!message.prefix.empty())
-        message.prefix.push_back(' ');
-
-    _write(message);
+    if (!prefix.empty())
+        prefix.push_back(' ');
 }
 
 const char* Appender::getLogLevelString(LogLevel level)
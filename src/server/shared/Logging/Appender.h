@@ -94,6 +94,15 @@ class Appender
         void write(LogMessage& message);
         static const char* getLogLevelString(LogLevel level);
 
+        /// Asynchronous path: text (with its newline) stays valid until the next Flush()
+        void queue(LogLevel level, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length);
+        /// Writes everything queued since the last call
+        virtual void Flush() { }
+
+    protected:
+        void buildPrefix(std::string& prefix, LogLevel level, std::string const& type, time_t mtime) const;
+        virtual void _queue(LogLevel level, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length);
+
     private:
         virtual void _write(LogMessage const& /*message*/) = 0;
 
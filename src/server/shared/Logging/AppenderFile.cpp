@@ -20,6 +20,10 @@
 
 #if PLATFORM == PLATFORM_WINDOWS
 # include <Windows.h>
+#else
+# include <limits.h>
+# include <sys/uio.h>
+# include <unistd.h>
 #endif
 
 AppenderFile::AppenderFile(uint8 id, std::string const& name, LogLevel level, const char* _filename, const char* _logDir, const char* _mode, AppenderFlags _flags, uint64 fileSize):
@@ -29,7 +33,8 @@ AppenderFile::AppenderFile(uint8 id, std::string const& name, LogLevel level, co
     logDir(_logDir),
     mode(_mode),
     maxFileSize(fileSize),
-    fileSize(0)
+    fileSize(0),
+    pendingSize(0)
 {
     dynamicName = std::string::npos != filename.find("%s");
     backup = (_flags & APPENDER_FLAGS_MAKE_FILE_BACKUP) != 0;
@@ -40,6 +45,7 @@ AppenderFile::AppenderFile(uint8 id, std::string const& name, LogLevel level, co
 
 AppenderFile::~AppenderFile()
 {
+    Flush();
     CloseFile();
 }
 
@@ -72,6 +78,92 @@ void AppenderFile::_write(LogMessage const& message)
     fileSize += uint64(message.Size());
 }
 
+void AppenderFile::_queue(LogLevel level, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length)
+{
+    if (dynamicName)
+    {
+        Appender::_queue(level, type, mtime, param1, text, length);
+        return;
+    }
+
+    uint32 prefixOffset = pendingPrefixes.size();
+    buildPrefix(pendingPrefixes, level, type, mtime);
+    uint32 prefixLength = pendingPrefixes.size() - prefixOffset;
+
+    if (maxFileSize > 0 && fileSize.load() + pendingSize + prefixLength + length > maxFileSize)
+    {
+        // the batch so far belongs to the old file
+        std::string prefix = pendingPrefixes.substr(prefixOffset);
+        pendingPrefixes.resize(prefixOffset);
+        Flush();
+
+        logfile = OpenFile(filename, "w", true);
+        prefixOffset = 0;
+        pendingPrefixes = prefix;
+    }
+
+    PendingWrite pending = { prefixOffset, prefixLength, text, length };
+    pendingWrites.push_back(pending);
+    pendingSize += prefixLength + length;
+}
+
+void AppenderFile::Flush()
+{
+    if (pendingWrites.empty())
+        return;
+
+    if (logfile)
+    {
+#if PLATFORM == PLATFORM_WINDOWS
+        for (PendingWrite const& pending : pendingWrites)
+        {
+            fwrite(pendingPrefixes.data() + pending.prefixOffset, 1, pending.prefixLength, logfile);
+            fwrite(pending.text, 1, pending.textLength, logfile);
+        }
+        fflush(logfile);
+#else
+        // nothing is left in the stdio buffer, the synchronous path flushes after every message
+        int fd = fileno(logfile);
+
+        std::vector<iovec> vectors;
+        vectors.reserve(pendingWrites.size() * 2);
+        for (PendingWrite const& pending : pendingWrites)
+        {
+            if (pending.prefixLength)
+                vectors.push_back({ const_cast<char*>(pendingPrefixes.data()) + pending.prefixOffset, pending.prefixLength });
+            vectors.push_back({ const_cast<char*>(pending.text), pending.textLength });
+        }
+
+        for (size_t i = 0; i < vectors.size();)
+        {
+            int count = int(std::min<size_t>(vectors.size() - i, IOV_MAX));
+            ssize_t written = writev(fd, &vectors[i], count);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            // skip what went out, a short write resumes inside a vector
+            while (i < vectors.size() && size_t(written) >= vectors[i].iov_len)
+                written -= vectors[i++].iov_len;
+
+            if (written > 0)
+            {
+                vectors[i].iov_base = static_cast<char*>(vectors[i].iov_base) + written;
+                vectors[i].iov_len -= written;
+            }
+        }
+#endif
+        fileSize += pendingSize;
+    }
+
+    pendingWrites.clear();
+    pendingPrefixes.clear();
+    pendingSize = 0;
+}
+
 FILE* AppenderFile::OpenFile(std::string const &filename, std::string const &mode, bool backup)
 {
     std::string fullName(logDir + filename);
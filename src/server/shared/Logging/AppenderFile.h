@@ -19,6 +19,7 @@
 #define APPENDERFILE_H
 
 #include <atomic>
+#include <vector>
 #include "Appender.h"
 
 class AppenderFile: public Appender
@@ -27,10 +28,21 @@ class AppenderFile: public Appender
         AppenderFile(uint8 _id, std::string const& _name, LogLevel level, const char* filename, const char* logDir, const char* mode, AppenderFlags flags, uint64 maxSize);
         ~AppenderFile();
         FILE* OpenFile(std::string const& _name, std::string const& _mode, bool _backup);
+        void Flush() override;
 
     private:
+        struct PendingWrite
+        {
+            uint32 prefixOffset;
+            uint32 prefixLength;
+            char const* text;
+            uint32 textLength;
+        };
+
         void CloseFile();
         void _write(LogMessage const& message) override;
+        void _queue(LogLevel level, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length) override;
+
         FILE* logfile;
         std::string filename;
         std::string logDir;
@@ -39,6 +51,11 @@ class AppenderFile: public Appender
         bool backup;
         uint64 maxFileSize;
         std::atomic<uint64> fileSize;
+
+        // batch of the asynchronous logger, prefixes are kept apart so the texts are not copied
+        std::string pendingPrefixes;
+        std::vector<PendingWrite> pendingWrites;
+        uint64 pendingSize;
 };
 
 #endif
@@ -23,13 +23,33 @@
 #include "AppenderConsole.h"
 #include "AppenderFile.h"
 //#include "AppenderDB.h"
-#include "LogOperation.h"
+#include "LogBuffer.h"
 
 #include <cstdarg>
 #include <cstdio>
 #include <sstream>
 
-Log::Log() : _ioService(nullptr), _strand(nullptr)
+namespace
+{
+    /// LogBuffer of the current thread, handed over to the flusher when the thread exits
+    struct LogBufferOwner
+    {
+        LogBufferOwner() : buffer(nullptr) { }
+        ~LogBufferOwner()
+        {
+            if (buffer)
+                buffer->SetOrphaned();
+        }
+
+        LogBuffer* buffer;
+    };
+
+    thread_local LogBufferOwner threadBuffer;
+
+    std::string const noParam;
+}
+
+Log::Log() : _bufferSize(0), _flushInterval(0), _async(false)
 {
     m_logsTimestamp = "_" + GetTimestampStr();
     LoadFromConfig();
@@ -37,8 +57,12 @@ Log::Log() : _ioService(nullptr), _strand(nullptr)
 
 Log::~Log()
 {
-    delete _strand;
     Close();
+
+    // buffers of threads still alive are left to the process exit
+    for (LogBuffer* buffer : _buffers)
+        if (buffer->IsOrphaned())
+            delete buffer;
 }
 
 uint8 Log::NextAppenderId()
@@ -264,27 +288,146 @@ void Log::ReadLoggersFromConfig()
 void Log::vlog(std::string const& filter, LogLevel level, char const* str, va_list argptr)
 {
     char text[MAX_QUERY_LEN];
-    vsnprintf(text, MAX_QUERY_LEN, str, argptr);
-    write(new LogMessage(level, filter, text));
+    int length = vsnprintf(text, MAX_QUERY_LEN, str, argptr);
+    if (length < 0)
+        length = 0;
+    else if (length >= MAX_QUERY_LEN)
+        length = MAX_QUERY_LEN - 1;
+
+    if (queue(level, filter, noParam, text, uint32(length)))
+        return;
+
+    write(new LogMessage(level, filter, std::string(text, length)));
 }
 
-void Log::write(LogMessage* msg) const
+void Log::write(LogMessage* msg)
 {
+    if (queue(msg->level, msg->type, msg->param1, msg->text.c_str(), uint32(msg->text.size())))
+    {
+        delete msg;
+        return;
+    }
+
     Logger const* logger = GetLoggerByType(msg->type);
     msg->text.append("\n");
 
-    if (_ioService)
+    logger->write(*msg);
+    delete msg;
+}
+
+bool Log::queue(LogLevel level, std::string const& type, std::string const& param1, char const* text, uint32 length)
+{
+    if (!_async.load(std::memory_order_relaxed))
+        return false;
+
+    LogBuffer* buffer = GetThreadBuffer();
+    time_t now = time(NULL);
+
+    while (!buffer->Push(level, type, param1, text, length, now))
     {
-        auto logOperation = std::shared_ptr<LogOperation>(new LogOperation(logger, msg));
+        // full, wait for the flusher rather than lose messages
+        if (!_async)
+            return false;
+
+        _flushCondition.notify_one();
+        std::this_thread::yield();
+    }
+
+    if (buffer->GetUsed() > buffer->GetCapacity() / 2)
+        _flushCondition.notify_one();
 
-        _ioService->post(_strand->wrap([logOperation](){ logOperation->call(); }));
+    return true;
+}
+
+LogBuffer* Log::GetThreadBuffer()
+{
+    if (!threadBuffer.buffer)
+    {
+        threadBuffer.buffer = new LogBuffer(_bufferSize);
 
+        std::lock_guard<std::mutex> lock(_buffersLock);
+        _buffers.push_back(threadBuffer.buffer);
     }
-    else
+
+    return threadBuffer.buffer;
+}
+
+void Log::StartAsync(uint32 bufferSize, uint32 flushInterval)
+{
+    if (_async)
+        return;
+
+    _bufferSize = bufferSize;
+    _flushInterval = flushInterval ? flushInterval : 10;
+    _async = true;
+    _flushThread = std::thread(&Log::FlushThread, this);
+}
+
+void Log::StopAsync()
+{
+    if (!_async.exchange(false))
+        return;
+
+    _flushCondition.notify_all();
+    if (_flushThread.joinable())
+        _flushThread.join();
+
+    // whatever was queued before the stop
+    FlushBuffers();
+}
+
+void Log::FlushThread()
+{
+    std::unique_lock<std::mutex> lock(_flushLock);
+    while (_async)
     {
-        logger->write(*msg);
-        delete msg;
+        _flushCondition.wait_for(lock, std::chrono::milliseconds(_flushInterval));
+        FlushBuffers();
+    }
+}
+
+void Log::FlushBuffers()
+{
+    std::vector<LogBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(_buffersLock);
+        for (std::vector<LogBuffer*>::iterator itr = _buffers.begin(); itr != _buffers.end();)
+        {
+            if ((*itr)->IsOrphaned() && (*itr)->IsEmpty())
+            {
+                delete *itr;
+                itr = _buffers.erase(itr);
+            }
+            else
+                buffers.push_back(*itr++);
+        }
     }
+
+    // records stay in place until every appender wrote its batch
+    std::vector<uint64> ends(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        ends[i] = buffers[i]->Acquire();
+        buffers[i]->ForEach(ends[i], [this](LogRecord const& record) { dispatch(record); });
+    }
+
+    for (AppenderMap::iterator it = appenders.begin(); it != appenders.end(); ++it)
+        if (it->second)
+            it->second->Flush();
+
+    for (size_t i = 0; i < buffers.size(); ++i)
+        buffers[i]->Release(ends[i]);
+}
+
+void Log::dispatch(LogRecord const& record) const
+{
+    std::string type(record.type(), record.typeLength);
+    Logger const* logger = GetLoggerByType(type);
+    if (!logger)
+        return;
+
+    std::string param1(record.param1(), record.param1Length);
+    logger->queue(LogLevel(record.level), type, time_t(record.mtime), param1, record.text(), record.textLength);
 }
 
 std::string Log::GetTimestampStr()
@@ -311,6 +454,8 @@ bool Log::SetLogLevel(std::string const& name, const char* newLevelc, bool isLog
     if (newLevel < 0)
         return false;
 
+    std::lock_guard<std::mutex> lock(_configLock);
+
     if (isLogger)
     {
         LoggerMap::iterator it = loggers.begin();
@@ -321,6 +466,7 @@ bool Log::SetLogLevel(std::string const& name, const char* newLevelc, bool isLog
             return false;
 
         it->second.setLogLevel(newLevel);
+        RefreshFilters();
     }
     else
     {
@@ -379,8 +525,36 @@ void Log::SetRealmId(uint32 id)
           //  ((AppenderDB *)it->second)->setRealmId(id);
 }
 
+LogLevel Log::GetFilterLevel(std::string const& type) const
+{
+    Logger const* logger = GetLoggerByType(type);
+    return logger ? logger->getLogLevel() : LOG_LEVEL_DISABLED;
+}
+
+void Log::RegisterFilter(LogFilter* filter)
+{
+    std::lock_guard<std::mutex> lock(_filtersLock);
+    filter->_level = uint8(GetFilterLevel(filter->_type));
+    _filters.push_back(filter);
+}
+
+void Log::UnregisterFilter(LogFilter* filter)
+{
+    std::lock_guard<std::mutex> lock(_filtersLock);
+    _filters.erase(std::remove(_filters.begin(), _filters.end(), filter), _filters.end());
+}
+
+void Log::RefreshFilters()
+{
+    std::lock_guard<std::mutex> lock(_filtersLock);
+    for (LogFilter* filter : _filters)
+        filter->_level = uint8(GetFilterLevel(filter->_type));
+}
+
 void Log::Close()
 {
+    StopAsync();
+
     loggers.clear();
     for (AppenderMap::iterator it = appenders.begin(); it != appenders.end(); ++it)
     {
@@ -392,6 +566,8 @@ void Log::Close()
 
 void Log::LoadFromConfig()
 {
+    std::lock_guard<std::mutex> lock(_configLock);
+
     Close();
 
     AppenderId = 0;
@@ -402,4 +578,8 @@ void Log::LoadFromConfig()
 
     ReadAppendersFromConfig();
     ReadLoggersFromConfig();
+    RefreshFilters();
+
+    if (sConfigMgr->GetBoolDefault("Log.Async.Enable", true))
+        StartAsync(sConfigMgr->GetIntDefault("Log.Async.BufferSize", 256) * 1024, sConfigMgr->GetIntDefault("Log.Async.FlushInterval", 10));
 }
@@ -23,14 +23,21 @@
 #include "Appender.h"
 #include "Logger.h"
 #include <stdarg.h>
-#include <boost/asio/io_service.hpp>
-#include <boost/asio/strand.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #define LOGGER_ROOT "root"
 
+class LogBuffer;
+class LogFilter;
+struct LogRecord;
+
 class Log
 {
     typedef std::unordered_map<std::string, Logger> LoggerMap;
@@ -41,16 +48,9 @@ class Log
 
     public:
 
-        static Log* instance(boost::asio::io_service* ioService = nullptr)
+        static Log* instance()
         {
             static Log instance;
-
-            if (ioService != nullptr)
-            {
-                instance._ioService = ioService;
-                instance._strand = new boost::asio::strand(*ioService);
-            }
-
             return &instance;
         }
 
@@ -66,10 +66,23 @@ class Log
 
         void SetRealmId(uint32 id);
 
+        void RegisterFilter(LogFilter* filter);
+        void UnregisterFilter(LogFilter* filter);
+
     private:
         static std::string GetTimestampStr();
         void vlog(std::string const& f, LogLevel level, char const* str, va_list argptr);
-        void write(LogMessage* msg) const;
+        void write(LogMessage* msg);
+
+        // Asynchronous logging: every thread formats into its own LogBuffer,
+        // a single flusher thread drains them and writes the appenders in batches
+        void StartAsync(uint32 bufferSize, uint32 flushInterval);
+        void StopAsync();
+        bool queue(LogLevel level, std::string const& type, std::string const& param1, char const* text, uint32 length);
+        LogBuffer* GetThreadBuffer();
+        void FlushThread();
+        void FlushBuffers();
+        void dispatch(LogRecord const& record) const;
 
         Logger const* GetLoggerByType(std::string const& type) const;
         Appender* GetAppenderByName(std::string const& name);
@@ -78,6 +91,8 @@ class Log
         void CreateLoggerFromConfig(std::string const& name);
         void ReadAppendersFromConfig();
         void ReadLoggersFromConfig();
+        LogLevel GetFilterLevel(std::string const& type) const;
+        void RefreshFilters();
 
         AppenderMap appenders;
         LoggerMap loggers;
@@ -86,8 +101,21 @@ class Log
         std::string m_logsDir;
         std::string m_logsTimestamp;
 
-        boost::asio::io_service* _ioService;
-        boost::asio::strand* _strand;
+        std::vector<LogFilter*> _filters;
+        std::mutex _filtersLock;
+
+        // a config reload and a level change from the admin console don't rebuild the loggers together
+        std::mutex _configLock;
+
+        std::vector<LogBuffer*> _buffers;
+        std::mutex _buffersLock;
+        uint32 _bufferSize;
+        uint32 _flushInterval;
+
+        std::atomic<bool> _async;
+        std::thread _flushThread;
+        std::mutex _flushLock;
+        std::condition_variable _flushCondition;
 };
 
 inline Logger const* Log::GetLoggerByType(std::string const& type) const
@@ -109,9 +137,8 @@ inline Logger const* Log::GetLoggerByType(std::string const& type) const
 
 inline bool Log::ShouldLog(std::string const& type, LogLevel level) const
 {
-    // TODO: Use cache to store "Type.sub1.sub2": "Type" equivalence, should
-    // Speed up in cases where requesting "Type.sub1.sub2" but only configured
-    // Logger "Type"
+    // Walks the logger hierarchy, TC_LOG_* call sites go through their LogFilter
+    // and only end up here for a filter type that is not a constant
 
     Logger const* logger = GetLoggerByType(type);
     if (!logger)
@@ -134,10 +161,68 @@ inline void Log::outMessage(std::string const& filter, LogLevel level, const cha
 
 #define sLog Log::instance()
 
+/// Logger level resolved for one filter type, kept up to date by Log::LoadFromConfig
+/// and Log::SetLogLevel so that a disabled log statement only costs an atomic load.
+/// Meant to be a static of the call site (see TC_LOG_MESSAGE_BODY).
+class LogFilter
+{
+    public:
+        explicit LogFilter(char const* type) : _typeName(type), _type(type), _level(LOG_LEVEL_DISABLED)
+        {
+            sLog->RegisterFilter(this);
+        }
+
+        explicit LogFilter(std::string const& type) : _typeName(nullptr), _type(type), _level(LOG_LEVEL_DISABLED)
+        {
+            sLog->RegisterFilter(this);
+        }
+
+        ~LogFilter()
+        {
+            sLog->UnregisterFilter(this);
+        }
+
+        bool IsEnabled(LogLevel level) const
+        {
+            LogLevel filterLevel = LogLevel(_level.load(std::memory_order_relaxed));
+            return filterLevel != LOG_LEVEL_DISABLED && filterLevel <= level;
+        }
+
+        // the type of the call may differ from the one the filter was created with when it is not a literal
+        bool ShouldLog(char const* type, LogLevel level) const
+        {
+            if (type == _typeName || _type == type)
+                return IsEnabled(level);
+
+            return sLog->ShouldLog(type, level);
+        }
+
+        bool ShouldLog(std::string const& type, LogLevel level) const
+        {
+            if (_type == type)
+                return IsEnabled(level);
+
+            return sLog->ShouldLog(type, level);
+        }
+
+        std::string const& GetType() const { return _type; }
+
+    private:
+        friend class Log;
+
+        LogFilter(LogFilter const&) = delete;
+        LogFilter& operator=(LogFilter const&) = delete;
+
+        char const* _typeName;
+        std::string _type;
+        std::atomic<uint8> _level;
+};
+
 #if PLATFORM != PLATFORM_WINDOWS
 #define TC_LOG_MESSAGE_BODY(filterType__, level__, ...)                 \
         do {                                                            \
-            if (sLog->ShouldLog(filterType__, level__))                 \
+            static LogFilter const logFilter__(filterType__);           \
+            if (logFilter__.ShouldLog(filterType__, level__))           \
                 sLog->outMessage(filterType__, level__, __VA_ARGS__);   \
         } while (0)
 #else
@@ -145,7 +230,8 @@ inline void Log::outMessage(std::string const& filter, LogLevel level, const cha
         __pragma(warning(push))                                         \
         __pragma(warning(disable:4127))                                 \
         do {                                                            \
-            if (sLog->ShouldLog(filterType__, level__))                 \
+            static LogFilter const logFilter__(filterType__);           \
+            if (logFilter__.ShouldLog(filterType__, level__))           \
                 sLog->outMessage(filterType__, level__, __VA_ARGS__);   \
         } while (0)                                                     \
         __pragma(warning(pop))
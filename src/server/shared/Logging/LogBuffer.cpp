@@ -0,0 +1,69 @@
+#include "LogBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+LogBuffer::LogBuffer(uint32 size) : _orphaned(false), _writePos(0), _readPos(0)
+{
+    // round up to a power of two so positions can be masked
+    _size = LOG_BUFFER_MIN_SIZE;
+    while (_size < size && _size < 0x40000000)
+        _size <<= 1;
+
+    _mask = _size - 1;
+    _data = new char[_size];
+}
+
+LogBuffer::~LogBuffer()
+{
+    delete[] _data;
+}
+
+bool LogBuffer::Push(LogLevel level, std::string const& type, std::string const& param1, char const* text, uint32 length, time_t mtime)
+{
+    uint32 typeLength = std::min<uint32>(type.size(), 0xFF);
+    uint32 param1Length = std::min<uint32>(param1.size(), 0xFFFF);
+
+    // a record may take a quarter of the buffer at most, longer texts are cut
+    uint32 headerSize = sizeof(LogRecord) + typeLength + param1Length;
+    length = std::min(length, _size / 4 - headerSize - 8);
+
+    uint32 need = (headerSize + length + 1 + 7) & ~7;
+
+    uint64 write = _writePos.load(std::memory_order_relaxed);
+    uint64 read = _readPos.load(std::memory_order_acquire);
+
+    uint32 tail = _size - uint32(write & _mask);
+    uint32 skip = need > tail ? tail : 0;
+
+    if (write + skip + need - read > _size)
+        return false;
+
+    if (skip >= sizeof(LogRecord))
+    {
+        LogRecord* padding = reinterpret_cast<LogRecord*>(_data + (write & _mask));
+        padding->size = skip;
+        padding->level = LOG_LEVEL_DISABLED;
+    }
+
+    write += skip;
+
+    LogRecord* record = reinterpret_cast<LogRecord*>(_data + (write & _mask));
+    record->size = need;
+    record->level = uint8(level);
+    record->typeLength = uint8(typeLength);
+    record->param1Length = uint16(param1Length);
+    record->textLength = length + 1;
+    record->mtime = int64(mtime);
+
+    char* dest = reinterpret_cast<char*>(record + 1);
+    memcpy(dest, type.c_str(), typeLength);
+    dest += typeLength;
+    memcpy(dest, param1.c_str(), param1Length);
+    dest += param1Length;
+    memcpy(dest, text, length);
+    dest[length] = '\n';
+
+    _writePos.store(write + need, std::memory_order_release);
+    return true;
+}
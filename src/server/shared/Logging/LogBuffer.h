@@ -0,0 +1,86 @@
+#ifndef TRINITYCORE_LOGBUFFER_H
+#define TRINITYCORE_LOGBUFFER_H
+
+#include "Appender.h"
+
+#include <atomic>
+
+#define LOG_BUFFER_MIN_SIZE (64 * 1024)
+
+/// Header of a message queued in a LogBuffer, followed by the filter type, param1 and the text
+struct LogRecord
+{
+    uint32 size;                // whole record with padding
+    uint8 level;                // LOG_LEVEL_DISABLED marks the padding left before a wrap
+    uint8 typeLength;
+    uint16 param1Length;
+    uint32 textLength;          // including the trailing newline
+    int64 mtime;
+
+    char const* type() const { return reinterpret_cast<char const*>(this + 1); }
+    char const* param1() const { return type() + typeLength; }
+    char const* text() const { return param1() + param1Length; }
+};
+
+/// Preallocated ring of log records written by a single thread and drained by the log flusher.
+/// Positions only grow, a record never wraps around the end of the storage.
+class LogBuffer
+{
+    public:
+        explicit LogBuffer(uint32 size);
+        ~LogBuffer();
+
+        /// producer side, returns false when the record does not fit until the flusher catches up
+        bool Push(LogLevel level, std::string const& type, std::string const& param1, char const* text, uint32 length, time_t mtime);
+
+        /// consumer side, records up to the returned position stay valid until Release()
+        uint64 Acquire() const { return _writePos.load(std::memory_order_acquire); }
+        void Release(uint64 pos) { _readPos.store(pos, std::memory_order_release); }
+
+        template<class Handler>
+        void ForEach(uint64 end, Handler const& handler) const
+        {
+            for (uint64 pos = _readPos.load(std::memory_order_relaxed); pos < end;)
+            {
+                uint32 tail = _size - uint32(pos & _mask);
+                if (tail < sizeof(LogRecord))
+                {
+                    pos += tail;
+                    continue;
+                }
+
+                LogRecord const* record = reinterpret_cast<LogRecord const*>(_data + (pos & _mask));
+                if (record->level != LOG_LEVEL_DISABLED)
+                    handler(*record);
+
+                pos += record->size;
+            }
+        }
+
+        uint32 GetUsed() const { return uint32(_writePos.load(std::memory_order_relaxed) - _readPos.load(std::memory_order_relaxed)); }
+        uint32 GetCapacity() const { return _size; }
+        bool IsEmpty() const { return _writePos.load(std::memory_order_acquire) == _readPos.load(std::memory_order_relaxed); }
+
+        /// set when the owning thread exits, the flusher frees the buffer once it is drained
+        void SetOrphaned() { _orphaned = true; }
+        bool IsOrphaned() const { return _orphaned; }
+
+    private:
+        LogBuffer(LogBuffer const&) = delete;
+        LogBuffer& operator=(LogBuffer const&) = delete;
+
+        char* _data;
+        uint32 _size;
+        uint64 _mask;
+        std::atomic<bool> _orphaned;
+
+        /// the producer and the flusher each write their own position, padded apart so they never
+        /// share a cache line. Padding rather than alignas, new does not honour a 64 byte alignment.
+        char _padWrite[64];
+        std::atomic<uint64> _writePos;
+        char _padRead[64 - sizeof(std::atomic<uint64>)];
+        std::atomic<uint64> _readPos;
+        char _padEnd[64 - sizeof(std::atomic<uint64>)];
+};
+
+#endif
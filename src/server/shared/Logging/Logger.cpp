@@ -62,3 +62,13 @@ void Logger::write(LogMessage& message) const
         if (it->second)
             it->second->write(message);
 }
+
+void Logger::queue(LogLevel msgLevel, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length) const
+{
+    if (!level || level > msgLevel || !length)
+        return;
+
+    for (AppenderMap::const_iterator it = appenders.begin(); it != appenders.end(); ++it)
+        if (it->second)
+            it->second->queue(msgLevel, type, mtime, param1, text, length);
+}
@@ -33,6 +33,7 @@ class Logger
         LogLevel getLogLevel() const;
         void setLogLevel(LogLevel level);
         void write(LogMessage& message) const;
+        void queue(LogLevel level, std::string const& type, time_t mtime, std::string const& param1, char const* text, uint32 length) const;
 
     private:
         std::string name;
@@ -19,6 +19,7 @@
 #define __ASYNCACCEPT_H_
 
 #include "Log.h"
+#include <atomic>
 #include <boost/asio.hpp>
 
 using boost::asio::ip::tcp;
@@ -29,20 +30,45 @@ class AsyncAcceptor
 public:
     AsyncAcceptor(boost::asio::io_service& ioService, std::string bindIp, int port) :
         _acceptor(ioService, tcp::endpoint(boost::asio::ip::address::from_string(bindIp), port)),
-        _socket(ioService)
+        _socket(ioService), _closed(false)
     {
         AsyncAccept();
     };
 
     AsyncAcceptor(boost::asio::io_service& ioService, std::string bindIp, int port, bool tcpNoDelay) :
         _acceptor(ioService, tcp::endpoint(boost::asio::ip::address::from_string(bindIp), port)),
-        _socket(ioService)
+        _socket(ioService), _closed(false)
     {
         _acceptor.set_option(boost::asio::ip::tcp::no_delay(tcpNoDelay));
 
         AsyncAccept();
     };
 
+    // takes a socket already listening, handed over by the process that bound it
+    AsyncAcceptor(boost::asio::io_service& ioService, tcp::acceptor::native_handle_type listener, bool tcpNoDelay) :
+        _acceptor(ioService), _socket(ioService), _closed(false)
+    {
+        sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+        _acceptor.assign(address.ss_family == AF_INET6 ? tcp::v6() : tcp::v4(), listener);
+        _acceptor.set_option(boost::asio::ip::tcp::no_delay(tcpNoDelay));
+
+        AsyncAccept();
+    };
+
+    tcp::acceptor::native_handle_type GetNativeHandle() { return _acceptor.native_handle(); }
+
+    // stops accepting, the connections accepted so far go on
+    void Close()
+    {
+        if (_closed.exchange(true))
+            return;
+
+        boost::system::error_code error;
+        _acceptor.close(error);
+    }
+
 private:
     void AsyncAccept()
     {
@@ -62,12 +88,14 @@ private:
             }
 
             // lets slap some more this-> on this so we can fix this bug with gcc 4.7.2 throwing internals in yo face
-            this->AsyncAccept();
+            if (!this->_closed)
+                this->AsyncAccept();
         });
     }
 
     tcp::acceptor _acceptor;
     tcp::socket _socket;
+    std::atomic<bool> _closed;
 };
 
 #endif /* __ASYNCACCEPT_H_ */
@@ -0,0 +1,52 @@
+#ifndef _CLUSTER_PROTOCOL_H
+#define _CLUSTER_PROTOCOL_H
+
+#include "Define.h"
+
+#include <cstring>
+#include <vector>
+
+/// Link between the router (routerserver) and a game node (worldserver with Cluster.Router set).
+/// The node connects to the router and tells it the rooms it takes new players in and the accounts
+/// in game there. The clients connect to the router, which passes their packets to a node and back
+/// as they are on the wire, each tagged with the id the router gave the client connection.
+/// Every message is a ClusterHeader and size bytes, little endian as the client packets.
+
+#define CLUSTER_PROTOCOL_VERSION   1
+#define CLUSTER_MAX_IDS            4096         // room or account ids in one message
+
+enum ClusterMessageType
+{
+    CLUSTER_NODE_HELLO    = 1,                  // node: uint32 protocol version, uint32 node id
+    CLUSTER_NODE_ROOMS    = 2,                  // node: uint32 room ids taking new players, all of them every time
+    CLUSTER_PLAYER_ENTER  = 3,                  // node: uint32 account ids now in game at the node
+    CLUSTER_PLAYER_LEAVE  = 4,                  // node: uint32 account ids that left the node
+    CLUSTER_CLIENT_DATA   = 5,                  // both ways: a client packet, its header included
+    CLUSTER_CLIENT_CLOSE  = 6                   // both ways: the client connection is gone
+};
+
+struct ClusterHeader
+{
+    uint16 type;
+    uint16 size;
+    uint32 client;                              // 0 for the messages of the node itself
+};
+
+/// header and payload in one buffer, ready to be queued on the link. Without data the payload is
+/// left for the caller to fill.
+inline std::vector<uint8> BuildClusterMessage(uint16 type, uint32 client, void const* data, std::size_t size)
+{
+    std::vector<uint8> message(sizeof(ClusterHeader) + size);
+
+    ClusterHeader header;
+    header.type = type;
+    header.size = uint16(size);
+    header.client = client;
+    memcpy(message.data(), &header, sizeof(header));
+    if (data && size)
+        memcpy(message.data() + sizeof(header), data, size);
+
+    return message;
+}
+
+#endif
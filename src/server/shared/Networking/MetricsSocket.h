@@ -0,0 +1,77 @@
+#ifndef __METRICSSOCKET_H__
+#define __METRICSSOCKET_H__
+
+#include "Metrics.h"
+#include <memory>
+#include <sstream>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+using boost::asio::ip::tcp;
+
+#define METRICS_MAX_REQUEST_SIZE 4096
+
+/// Minimal HTTP/1.0 responder for the metrics scrape, one request per connection.
+/// Accepted by AsyncAcceptor<MetricsSocket> on the network io_service.
+class MetricsSocket : public std::enable_shared_from_this<MetricsSocket>
+{
+public:
+    explicit MetricsSocket(tcp::socket&& socket) : _socket(std::move(socket)), _request(METRICS_MAX_REQUEST_SIZE) { }
+
+    void Start()
+    {
+        auto self(shared_from_this());
+        boost::asio::async_read_until(_socket, _request, "\r\n\r\n", [self](boost::system::error_code error, std::size_t /*bytes*/)
+        {
+            if (!error)
+                self->HandleRequest();
+        });
+    }
+
+private:
+    void HandleRequest()
+    {
+        std::istream request(&_request);
+        std::string method, path;
+        request >> method >> path;
+
+        std::string body;
+        char const* status = "200 OK";
+        if (method != "GET")
+        {
+            status = "405 Method Not Allowed";
+            body = "only GET is supported\n";
+        }
+        else if (path != "/metrics" && path != "/")
+        {
+            status = "404 Not Found";
+            body = "try /metrics\n";
+        }
+        else
+            body = sMetrics->Render();
+
+        std::ostringstream response;
+        response << "HTTP/1.0 " << status << "\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        _response = response.str();
+
+        auto self(shared_from_this());
+        boost::asio::async_write(_socket, boost::asio::buffer(_response), [self](boost::system::error_code /*error*/, std::size_t /*bytes*/)
+        {
+            boost::system::error_code ignored;
+            self->_socket.shutdown(tcp::socket::shutdown_both, ignored);
+            self->_socket.close(ignored);
+        });
+    }
+
+    tcp::socket _socket;
+    boost::asio::streambuf _request;
+    std::string _response;
+};
+
+#endif // __METRICSSOCKET_H__
@@ -0,0 +1,71 @@
+#include "DeckShuffler.h"
+#include "Common.h"
+#include "SFMT.h"
+#include "Util.h"
+
+DeckShuffler::DeckShuffler(uint32 seed) : _rng(new SFMTRand()), _seed(0)
+{
+    Seed(seed);
+}
+
+DeckShuffler::~DeckShuffler()
+{
+    delete _rng;
+}
+
+void DeckShuffler::Seed(uint32 seed)
+{
+    _seed = seed;
+    _rng->RandomInit(int(seed));
+}
+
+void DeckShuffler::SeedSecure()
+{
+    uint32 key[8];
+    for (uint32 i = 0; i < 8; i += 2)
+    {
+        uint64 value = rand_secure();
+        key[i] = uint32(value);
+        key[i + 1] = uint32(value >> 32);
+    }
+
+    _seed = 0;
+    _rng->RandomInitByArray(key, 8);
+}
+
+uint32 DeckShuffler::Bounded(uint32 range)
+{
+    uint64 m = uint64(_rng->BRandom()) * range;
+    uint32 low = uint32(m);
+    if (low < range)
+    {
+        // values below 2^32 mod range would make the first results of the range more likely
+        uint32 threshold = (0u - range) % range;
+        while (low < threshold)
+        {
+            m = uint64(_rng->BRandom()) * range;
+            low = uint32(m);
+        }
+    }
+
+    return uint32(m >> 32);
+}
+
+void DeckShuffler::Shuffle(uint8* deck, uint32 size)
+{
+    for (uint32 i = size; i > 1; --i)
+    {
+        uint32 j = Bounded(i);
+        std::swap(deck[i - 1], deck[j]);
+    }
+}
+
+void DeckShuffler::ShuffleBatch(uint8 const* source, uint8* decks, uint32 size, uint32 count)
+{
+    for (uint32 i = 0; i < count; ++i)
+    {
+        uint8* deck = decks + i * size;
+        memcpy(deck, source, size);
+        Shuffle(deck, size);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TRINITYCORE_DECKSHUFFLER_H
+#define TRINITYCORE_DECKSHUFFLER_H
+
+#include "Define.h"
+
+class SFMTRand;
+
+/// Unbiased Fisher-Yates shuffles drawn from an SFMT generator owned by the shuffler.
+/// The same seed always produces the same sequence of decks, which allows a deal to be replayed.
+/// Not thread safe, every owner (a room) keeps its own.
+class DeckShuffler
+{
+public:
+    explicit DeckShuffler(uint32 seed);
+    ~DeckShuffler();
+
+    void Seed(uint32 seed);
+    /// seeds the whole generator state from the OS random source, the decks can't be replayed
+    /// nor found back from a 32 bit seed. GetSeed returns 0.
+    void SeedSecure();
+    uint32 GetSeed() const { return _seed; }
+
+    /// uniform value in [0, range), multiply-shift with rejection of the biased low part
+    uint32 Bounded(uint32 range);
+
+    void Shuffle(uint8* deck, uint32 size);
+
+    /// copies the ordered source deck count times into decks and shuffles each copy,
+    /// the generator refills its state for many decks at once with SIMD
+    void ShuffleBatch(uint8 const* source, uint8* decks, uint32 size, uint32 count);
+
+private:
+    DeckShuffler(DeckShuffler const&) = delete;
+    DeckShuffler& operator=(DeckShuffler const&) = delete;
+
+    SFMTRand* _rng;
+    uint32 _seed;
+};
+
+#endif
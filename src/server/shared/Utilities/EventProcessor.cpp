@@ -18,10 +18,94 @@
 
 #include "EventProcessor.h"
 
-EventProcessor::EventProcessor()
+#include <new>
+
+// sizes of the pooled blocks are multiples of EVENT_BLOCK_SIZE, larger events use the heap
+#define EVENT_BLOCK_SIZE        64
+#define EVENT_BLOCK_CLASSES     4
+#define EVENT_FREE_LIST_MAX     1024                        // blocks kept by a thread for each size
+
+namespace
+{
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct FreeList
+    {
+        FreeList() : head(nullptr), count(0) { }
+        ~FreeList()
+        {
+            while (head)
+            {
+                FreeBlock* block = head;
+                head = block->next;
+                ::operator delete(block);
+            }
+        }
+
+        FreeBlock* head;
+        uint32 count;
+    };
+
+    // an event deleted by another thread than the one which created it moves its block to the deleting thread
+    thread_local FreeList EventFreeLists[EVENT_BLOCK_CLASSES];
+
+    uint32 BlockClass(size_t size)
+    {
+        return uint32((size + EVENT_BLOCK_SIZE - 1) / EVENT_BLOCK_SIZE) - 1;
+    }
+}
+
+void* BasicEvent::operator new(size_t size)
+{
+    uint32 blockClass = BlockClass(size);
+    if (blockClass >= EVENT_BLOCK_CLASSES)
+        return ::operator new(size);
+
+    FreeList& list = EventFreeLists[blockClass];
+    if (!list.head)
+        return ::operator new((blockClass + 1) * EVENT_BLOCK_SIZE);
+
+    FreeBlock* block = list.head;
+    list.head = block->next;
+    --list.count;
+    return block;
+}
+
+void BasicEvent::operator delete(void* block, size_t size)
+{
+    if (!block)
+        return;
+
+    uint32 blockClass = BlockClass(size);
+    if (blockClass >= EVENT_BLOCK_CLASSES || EventFreeLists[blockClass].count >= EVENT_FREE_LIST_MAX)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeList& list = EventFreeLists[blockClass];
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = list.head;
+    list.head = freeBlock;
+    ++list.count;
+}
+
+BasicEvent::~BasicEvent()
+{
+    if (m_owner)
+        m_owner->Unlink(this);
+}
+
+void BasicEvent::Expire()
+{
+    m_owner->Fire(this);
+}
+
+EventProcessor::EventProcessor() : m_events(nullptr), m_eventCount(0), m_updateTime(0)
 {
-    m_time = 0;
-    m_aborting = false;
 }
 
 EventProcessor::~EventProcessor()
@@ -31,69 +115,112 @@ EventProcessor::~EventProcessor()
 
 void EventProcessor::Update(uint32 p_time)
 {
-    // update time
-    m_time += p_time;
+    m_updateTime = p_time;
 
-    // main event loop
-    EventList::iterator i;
-    while (((i = m_events.begin()) != m_events.end()) && i->first <= m_time)
+    // the wheel fires the events of each expired ms in expiry order
+    m_wheel.Update(p_time);
+}
+
+void EventProcessor::Fire(BasicEvent* Event)
+{
+    uint64 now = m_wheel.GetTime();
+
+    // queued further than the wheel reaches, it goes round once more
+    if (Event->m_execTime > now)
     {
-        // get and remove event from queue
-        BasicEvent* Event = i->second;
-        m_events.erase(i);
+        m_wheel.Schedule(*Event, Event->m_execTime - now);
+        return;
+    }
 
-        if (!Event->to_Abort)
-        {
-            if (Event->Execute(m_time, p_time))
-            {
-                // completely destroy event if it is not re-added
-                delete Event;
-            }
-        }
-        else
+    // out of the queue while it runs, Execute may add it again
+    Unlink(Event);
+
+    if (!Event->to_Abort)
+    {
+        if (Event->Execute(now, m_updateTime))
         {
-            Event->Abort(m_time);
+            // completely destroy event if it is not re-added
             delete Event;
         }
     }
+    else
+    {
+        Event->Abort(now);
+        delete Event;
+    }
 }
 
 void EventProcessor::KillAllEvents(bool force)
 {
-    // prevent event insertions
-    m_aborting = true;
-
     // first, abort all existing events
-    for (EventList::iterator i = m_events.begin(); i != m_events.end();)
+    for (BasicEvent* i = m_events; i;)
     {
-        EventList::iterator i_old = i;
-        ++i;
-
-        i_old->second->to_Abort = true;
-        i_old->second->Abort(m_time);
-        if (force || i_old->second->IsDeletable())
-        {
-            delete i_old->second;
+        BasicEvent* i_old = i;
+        i = i->m_nextEvent;
 
-            if (!force)                                      // need per-element cleanup
-                m_events.erase (i_old);
-        }
+        i_old->to_Abort = true;
+        i_old->Abort(m_wheel.GetTime());
+        if (force || i_old->IsDeletable())
+            delete i_old;
     }
-
-    // fast clear event list (in force case)
-    if (force)
-        m_events.clear();
 }
 
 void EventProcessor::AddEvent(BasicEvent* Event, uint64 e_time, bool set_addtime)
 {
-    if (set_addtime) Event->m_addTime = m_time;
+    uint64 now = m_wheel.GetTime();
+
+    if (set_addtime) Event->m_addTime = now;
     Event->m_execTime = e_time;
-    m_events.insert(std::pair<uint64, BasicEvent*>(e_time, Event));
+
+    if (Event->m_owner != this)
+    {
+        if (Event->m_owner)
+            Event->m_owner->Unlink(Event);
+        Link(Event);
+    }
+
+    m_wheel.Schedule(*Event, e_time > now ? e_time - now : 0);
+}
+
+void EventProcessor::AbortEvent(BasicEvent* Event)
+{
+    if (Event->m_owner != this)
+        return;
+
+    Event->Cancel();
+    Unlink(Event);
+
+    Event->to_Abort = true;
+    Event->Abort(m_wheel.GetTime());
+    delete Event;
 }
 
 uint64 EventProcessor::CalculateTime(uint64 t_offset) const
 {
-    return(m_time + t_offset);
+    return(m_wheel.GetTime() + t_offset);
+}
+
+void EventProcessor::Link(BasicEvent* Event)
+{
+    Event->m_owner = this;
+    Event->m_prevEvent = nullptr;
+    Event->m_nextEvent = m_events;
+    if (m_events)
+        m_events->m_prevEvent = Event;
+    m_events = Event;
+    ++m_eventCount;
 }
 
+void EventProcessor::Unlink(BasicEvent* Event)
+{
+    if (Event->m_prevEvent)
+        Event->m_prevEvent->m_nextEvent = Event->m_nextEvent;
+    else
+        m_events = Event->m_nextEvent;
+    if (Event->m_nextEvent)
+        Event->m_nextEvent->m_prevEvent = Event->m_prevEvent;
+
+    Event->m_owner = nullptr;
+    Event->m_prevEvent = Event->m_nextEvent = nullptr;
+    --m_eventCount;
+}
@@ -20,21 +20,28 @@
 #define __EVENTPROCESSOR_H
 
 #include "Define.h"
-
-#include <map>
+#include "TimingWheel.h"
 
 // Note. All times are in milliseconds here.
 
-class BasicEvent
+class EventProcessor;
+
+// Events are queued on the timing wheel of their processor, the wheel links being part of the event.
+// Deleting a queued event removes it from its queue in O(1).
+class BasicEvent : public TimerNode
 {
+    friend class EventProcessor;
+
     public:
         BasicEvent()
         {
             to_Abort = false;
             m_addTime = 0;
             m_execTime = 0;
+            m_owner = nullptr;
+            m_prevEvent = m_nextEvent = nullptr;
         }
-        virtual ~BasicEvent() { }                           // override destructor to perform some actions on event removal
+        virtual ~BasicEvent();                              // override destructor to perform some actions on event removal
 
         // this method executes when the event is triggered
         // return false if event does not want to be deleted
@@ -45,29 +52,54 @@ class BasicEvent
 
         virtual void Abort(uint64 /*e_time*/) { }           // this method executes when the event is aborted
 
+        // events are carved from free lists of fixed size blocks kept by each thread,
+        // creating and deleting them does not reach the heap once the lists are warm
+        static void* operator new(size_t size);
+        static void operator delete(void* block, size_t size);
+
         bool to_Abort;                                      // set by externals when the event is aborted, aborted events don't execute
         // and get Abort call when deleted
 
         // these can be used for time offset control
         uint64 m_addTime;                                   // time when the event was added to queue, filled by event handler
         uint64 m_execTime;                                  // planned time of next execution, filled by event handler
-};
 
-typedef std::multimap<uint64, BasicEvent*> EventList;
+    protected:
+        void Expire() override;
+
+    private:
+        EventProcessor* m_owner;                            // processor the event is queued in
+        BasicEvent* m_prevEvent;                            // list of the events queued in m_owner
+        BasicEvent* m_nextEvent;
+};
 
 class EventProcessor
 {
+    friend class BasicEvent;
+
     public:
         EventProcessor();
         ~EventProcessor();
 
+        // runs the events due within p_time, all the events due at the same ms run as one batch
         void Update(uint32 p_time);
         void KillAllEvents(bool force);
         void AddEvent(BasicEvent* Event, uint64 e_time, bool set_addtime = true);
+        // aborts and deletes a queued event at once instead of when it is due
+        void AbortEvent(BasicEvent* Event);
         uint64 CalculateTime(uint64 t_offset) const;
+        uint32 GetEventCount() const { return m_eventCount; }
+
+        // the wheel running the events, intrusive timers of the objects of the owner can share it
+        TimingWheel& GetTimers() { return m_wheel; }
     protected:
-        uint64 m_time;
-        EventList m_events;
-        bool m_aborting;
+        void Link(BasicEvent* Event);
+        void Unlink(BasicEvent* Event);
+        void Fire(BasicEvent* Event);
+
+        TimingWheel m_wheel;
+        BasicEvent* m_events;                               // every queued event
+        uint32 m_eventCount;
+        uint32 m_updateTime;
 };
 #endif
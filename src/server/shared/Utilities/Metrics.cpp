@@ -0,0 +1,150 @@
+#include "Metrics.h"
+#include "TimingHistogram.h"
+
+#include <sstream>
+
+MetricCounter::MetricCounter()
+{
+    for (uint32 i = 0; i < METRIC_COUNTER_STRIPES; ++i)
+        _stripes[i].value = 0;
+}
+
+uint32 MetricCounter::ThreadStripe()
+{
+    static std::atomic<uint32> nextStripe(0);
+    static thread_local uint32 stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % METRIC_COUNTER_STRIPES;
+    return stripe;
+}
+
+uint64 MetricCounter::Value() const
+{
+    uint64 value = 0;
+    for (uint32 i = 0; i < METRIC_COUNTER_STRIPES; ++i)
+        value += _stripes[i].value.load(std::memory_order_relaxed);
+    return value;
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    for (auto& family : _families)
+    {
+        for (auto& counter : family.second.counters)
+            delete counter.second;
+        for (auto& gauge : family.second.gauges)
+            delete gauge.second;
+    }
+}
+
+MetricsRegistry::MetricFamily& MetricsRegistry::GetFamily(std::string const& name, char const* type)
+{
+    MetricFamily& family = _families[name];
+    if (!family.type)
+        family.type = type;
+    return family;
+}
+
+MetricCounter* MetricsRegistry::GetCounter(std::string const& name, std::string const& labels)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    MetricCounter*& counter = GetFamily(name, "counter").counters[labels];
+    if (!counter)
+        counter = new MetricCounter();
+    return counter;
+}
+
+MetricGauge* MetricsRegistry::GetGauge(std::string const& name, std::string const& labels)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    MetricGauge*& gauge = GetFamily(name, "gauge").gauges[labels];
+    if (!gauge)
+        gauge = new MetricGauge();
+    return gauge;
+}
+
+void MetricsRegistry::RegisterHistogram(std::string const& name, std::string const& labels, TimingHistogram* histogram)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    GetFamily(name, "summary").histograms[labels] = histogram;
+}
+
+void MetricsRegistry::UnregisterHistogram(std::string const& name, std::string const& labels)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    auto itr = _families.find(name);
+    if (itr != _families.end())
+        itr->second.histograms.erase(labels);
+}
+
+void MetricsRegistry::SetHelp(std::string const& name, std::string const& help)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    _families[name].help = help;
+}
+
+static void AppendSample(std::ostringstream& ss, std::string const& name, std::string const& labels, std::string const& extraLabel)
+{
+    ss << name;
+    if (!labels.empty() || !extraLabel.empty())
+    {
+        ss << '{' << labels;
+        if (!labels.empty() && !extraLabel.empty())
+            ss << ',';
+        ss << extraLabel << '}';
+    }
+    ss << ' ';
+}
+
+std::string MetricsRegistry::Render()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    std::ostringstream ss;
+
+    for (auto const& itr : _families)
+    {
+        std::string const& name = itr.first;
+        MetricFamily const& family = itr.second;
+        if (!family.type)
+            continue;
+
+        if (!family.help.empty())
+            ss << "# HELP " << name << ' ' << family.help << '\n';
+        ss << "# TYPE " << name << ' ' << family.type << '\n';
+
+        for (auto const& counter : family.counters)
+        {
+            AppendSample(ss, name, counter.first, "");
+            ss << counter.second->Value() << '\n';
+        }
+
+        for (auto const& gauge : family.gauges)
+        {
+            AppendSample(ss, name, gauge.first, "");
+            ss << gauge.second->Value() << '\n';
+        }
+
+        // durations are exported in seconds, as the exposition format expects
+        for (auto const& histogram : family.histograms)
+        {
+            TimingSnapshot snapshot = histogram.second->Snapshot();
+            AppendSample(ss, name, histogram.first, "quantile=\"0.5\"");
+            ss << snapshot.p50 / 1e6 << '\n';
+            AppendSample(ss, name, histogram.first, "quantile=\"0.9\"");
+            ss << snapshot.p90 / 1e6 << '\n';
+            AppendSample(ss, name, histogram.first, "quantile=\"0.99\"");
+            ss << snapshot.p99 / 1e6 << '\n';
+            AppendSample(ss, name, histogram.first, "quantile=\"0.999\"");
+            ss << snapshot.p999 / 1e6 << '\n';
+            AppendSample(ss, name + "_sum", histogram.first, "");
+            ss << snapshot.sum / 1e6 << '\n';
+            AppendSample(ss, name + "_count", histogram.first, "");
+            ss << snapshot.count << '\n';
+        }
+    }
+
+    return ss.str();
+}
@@ -0,0 +1,101 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+class TimingHistogram;
+
+#define METRIC_COUNTER_STRIPES 16
+#define METRIC_CACHE_LINE      64
+
+/// Monotonic counter. Every thread increments its own cache line,
+/// the stripes are only summed when the value is read.
+class MetricCounter
+{
+public:
+    MetricCounter();
+
+    void Add(uint64 value = 1)
+    {
+        _stripes[ThreadStripe()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64 Value() const;
+
+private:
+    static uint32 ThreadStripe();
+
+    struct Stripe
+    {
+        std::atomic<uint64> value;
+        char pad[METRIC_CACHE_LINE - sizeof(std::atomic<uint64>)];
+    };
+
+    Stripe _stripes[METRIC_COUNTER_STRIPES];
+};
+
+/// Value that can go up and down, written by its owner and read by the exporter
+class MetricGauge
+{
+public:
+    MetricGauge() : _value(0) { }
+
+    void Set(int64 value) { _value.store(value, std::memory_order_relaxed); }
+    void Add(int64 value) { _value.fetch_add(value, std::memory_order_relaxed); }
+    int64 Value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64> _value;
+};
+
+/// Named metrics in the plain text exposition format understood by Prometheus.
+/// Registration takes a lock and returns a pointer that stays valid for the lifetime
+/// of the process, callers are expected to keep it instead of looking it up again.
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry* instance()
+    {
+        static MetricsRegistry instance;
+        return &instance;
+    }
+
+    /// labels are given without braces: room="1",state="playing"
+    MetricCounter* GetCounter(std::string const& name, std::string const& labels = "");
+    MetricGauge* GetGauge(std::string const& name, std::string const& labels = "");
+    void RegisterHistogram(std::string const& name, std::string const& labels, TimingHistogram* histogram);
+    void UnregisterHistogram(std::string const& name, std::string const& labels);
+
+    void SetHelp(std::string const& name, std::string const& help);
+
+    std::string Render();
+
+private:
+    MetricsRegistry() { }
+    ~MetricsRegistry();
+
+    struct MetricFamily
+    {
+        MetricFamily() : type(nullptr) { }
+
+        char const* type;
+        std::string help;
+        std::map<std::string, MetricCounter*> counters;
+        std::map<std::string, MetricGauge*> gauges;
+        std::map<std::string, TimingHistogram*> histograms;
+    };
+
+    MetricFamily& GetFamily(std::string const& name, char const* type);
+
+    std::map<std::string, MetricFamily> _families;
+    std::mutex _lock;
+};
+
+#define sMetrics MetricsRegistry::instance()
+
+#endif
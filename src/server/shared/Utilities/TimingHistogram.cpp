@@ -0,0 +1,87 @@
+#include "TimingHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+std::string TimingSnapshot::ToString() const
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf), "count: " UI64FMTD " mean: %uus p50: %uus p90: %uus p99: %uus p99.9: %uus max: %uus",
+        count, mean(), p50, p90, p99, p999, max);
+    return std::string(buf);
+}
+
+void TimingHistogram::Reset()
+{
+    for (uint32 i = 0; i < TIMING_BUCKETS; ++i)
+        _buckets[i].store(0, std::memory_order_relaxed);
+
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+TimingSnapshot TimingHistogram::Snapshot(bool reset)
+{
+    uint64 counts[TIMING_BUCKETS];
+    TimingSnapshot snapshot;
+
+    // bucket counters are the source of truth, count and sum may be a few records apart when read concurrently
+    for (uint32 i = 0; i < TIMING_BUCKETS; ++i)
+    {
+        counts[i] = reset ? _buckets[i].exchange(0, std::memory_order_relaxed) : _buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += counts[i];
+    }
+
+    snapshot.sum = reset ? _sum.exchange(0, std::memory_order_relaxed) : _sum.load(std::memory_order_relaxed);
+    snapshot.max = reset ? _max.exchange(0, std::memory_order_relaxed) : _max.load(std::memory_order_relaxed);
+    if (reset)
+        _count.store(0, std::memory_order_relaxed);
+
+    SetPercentiles(snapshot, counts);
+    return snapshot;
+}
+
+TimingSnapshot TimingHistogram::Snapshot(TimingWindow& window)
+{
+    uint64 counts[TIMING_BUCKETS];
+    TimingSnapshot snapshot;
+
+    // a counter below the window was reset since, all it holds is new
+    for (uint32 i = 0; i < TIMING_BUCKETS; ++i)
+    {
+        uint64 total = _buckets[i].load(std::memory_order_relaxed);
+        counts[i] = total >= window.buckets[i] ? total - window.buckets[i] : total;
+        window.buckets[i] = total;
+        snapshot.count += counts[i];
+        if (counts[i])
+            snapshot.max = BucketUpperBound(i);
+    }
+
+    uint64 sum = _sum.load(std::memory_order_relaxed);
+    snapshot.sum = sum >= window.sum ? sum - window.sum : sum;
+    window.sum = sum;
+    snapshot.max = std::min(snapshot.max, _max.load(std::memory_order_relaxed));
+
+    SetPercentiles(snapshot, counts);
+    return snapshot;
+}
+
+void TimingHistogram::SetPercentiles(TimingSnapshot& snapshot, uint64 const* counts)
+{
+    if (!snapshot.count)
+        return;
+
+    uint32* const targets[] = { &snapshot.p50, &snapshot.p90, &snapshot.p99, &snapshot.p999 };
+    double const quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+    uint64 seen = 0;
+    uint32 next = 0;
+    for (uint32 i = 0; i < TIMING_BUCKETS && next < 4; ++i)
+    {
+        seen += counts[i];
+        while (next < 4 && seen >= uint64(std::ceil(quantiles[next] * snapshot.count)))
+            *targets[next++] = std::min(BucketUpperBound(i), snapshot.max);
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef _TIMING_HISTOGRAM_H
+#define _TIMING_HISTOGRAM_H
+
+#include "Define.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#if COMPILER == COMPILER_MICROSOFT
+#  include <intrin.h>
+#endif
+
+/// Log-linear (HDR style) histogram of durations in microseconds.
+/// Every power of two range is split in TIMING_SUB_BUCKETS linear buckets,
+/// so the relative error of a reported percentile stays below 1/8.
+/// Recording is lock free and may happen from any thread.
+#define TIMING_SUB_BUCKET_BITS   3
+#define TIMING_SUB_BUCKETS       (1 << TIMING_SUB_BUCKET_BITS)
+#define TIMING_BUCKETS           ((32 - TIMING_SUB_BUCKET_BITS + 1) * TIMING_SUB_BUCKETS)
+
+struct TimingSnapshot
+{
+    TimingSnapshot() : count(0), sum(0), max(0), p50(0), p90(0), p99(0), p999(0) { }
+
+    uint64 count;
+    uint64 sum;
+    uint32 max;
+    uint32 p50;
+    uint32 p90;
+    uint32 p99;
+    uint32 p999;
+
+    uint32 mean() const { return count ? uint32(sum / count) : 0; }
+    std::string ToString() const;
+};
+
+/// Counters of a histogram at the last snapshot of a window, for reports covering an interval
+/// while the histogram itself keeps counting from the start
+struct TimingWindow
+{
+    TimingWindow() : sum(0) { std::fill(buckets, buckets + TIMING_BUCKETS, uint64(0)); }
+
+    uint64 buckets[TIMING_BUCKETS];
+    uint64 sum;
+};
+
+class TimingHistogram
+{
+public:
+    TimingHistogram() { Reset(); }
+
+    void Record(uint32 us)
+    {
+        _buckets[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(us, std::memory_order_relaxed);
+
+        uint32 prevMax = _max.load(std::memory_order_relaxed);
+        while (us > prevMax && !_max.compare_exchange_weak(prevMax, us, std::memory_order_relaxed))
+            ;
+    }
+
+    /// Collects the counters; with reset the next snapshot only covers the values recorded after this one.
+    TimingSnapshot Snapshot(bool reset = false);
+    /// Collects the values recorded since the last snapshot of the window, the counters are left alone.
+    /// The max is the upper bound of the highest bucket of the interval.
+    TimingSnapshot Snapshot(TimingWindow& window);
+    void Reset();
+
+    static uint32 BucketIndex(uint32 us)
+    {
+        if (us < TIMING_SUB_BUCKETS)
+            return us;
+
+        uint32 group = HighestBit(us) - TIMING_SUB_BUCKET_BITS;
+        return (group + 1) * TIMING_SUB_BUCKETS + ((us >> group) & (TIMING_SUB_BUCKETS - 1));
+    }
+
+    /// Highest value that still falls into the bucket
+    static uint32 BucketUpperBound(uint32 index)
+    {
+        if (index < TIMING_SUB_BUCKETS)
+            return index;
+
+        uint32 group = index / TIMING_SUB_BUCKETS - 1;
+        uint64 low = uint64(TIMING_SUB_BUCKETS + index % TIMING_SUB_BUCKETS) << group;
+        return uint32(low + (uint64(1) << group) - 1);
+    }
+
+private:
+    static void SetPercentiles(TimingSnapshot& snapshot, uint64 const* counts);
+
+    static uint32 HighestBit(uint32 value)
+    {
+#if COMPILER == COMPILER_MICROSOFT
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return uint32(index);
+#else
+        return 31 - uint32(__builtin_clz(value));
+#endif
+    }
+
+    std::atomic<uint64> _buckets[TIMING_BUCKETS];
+    std::atomic<uint64> _count;
+    std::atomic<uint64> _sum;
+    std::atomic<uint32> _max;
+};
+
+/// Measures the lifetime of the scope and records it in microseconds
+class ScopedTickTimer
+{
+public:
+    explicit ScopedTickTimer(TimingHistogram* histogram, std::atomic<uint64>* accumulator = nullptr)
+        : _histogram(histogram), _accumulator(accumulator)
+    {
+        if (_histogram)
+            _start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedTickTimer()
+    {
+        if (!_histogram)
+            return;
+
+        uint64 us = uint64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count());
+        _histogram->Record(us > 0xFFFFFFFF ? 0xFFFFFFFF : uint32(us));
+        if (_accumulator)
+            _accumulator->fetch_add(us, std::memory_order_relaxed);
+    }
+
+private:
+    ScopedTickTimer(ScopedTickTimer const&);
+    ScopedTickTimer& operator=(ScopedTickTimer const&);
+
+    TimingHistogram* _histogram;
+    std::atomic<uint64>* _accumulator;
+    std::chrono::steady_clock::time_point _start;
+};
+
+#endif
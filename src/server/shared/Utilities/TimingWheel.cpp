@@ -0,0 +1,180 @@
+#include "TimingWheel.h"
+#include "Errors.h"
+
+#include <algorithm>
+
+void TimerNode::Cancel()
+{
+    if (!_wheel)
+        return;
+
+    Unlink();
+    --_wheel->_count;
+    _wheel = nullptr;
+}
+
+void TimerNode::Unlink()
+{
+    _prev->_next = _next;
+    _next->_prev = _prev;
+    _prev = _next = nullptr;
+}
+
+TimingWheel::TimingWheel() : _now(0), _count(0)
+{
+    for (uint32 level = 0; level < TIMING_WHEEL_LEVELS; ++level)
+    {
+        _occupied[level] = 0;
+        for (uint32 slot = 0; slot < TIMING_WHEEL_SLOTS; ++slot)
+        {
+            TimerNode& head = _slots[level][slot];
+            head._prev = head._next = &head;
+        }
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+    // timers outliving the wheel must not reach it when they are destroyed
+    for (uint32 level = 0; level < TIMING_WHEEL_LEVELS; ++level)
+    {
+        for (uint32 slot = 0; slot < TIMING_WHEEL_SLOTS; ++slot)
+        {
+            TimerNode& head = _slots[level][slot];
+            while (head._next != &head)
+            {
+                TimerNode* timer = head._next;
+                timer->Unlink();
+                timer->_wheel = nullptr;
+            }
+            head._prev = head._next = nullptr;
+        }
+    }
+}
+
+void TimingWheel::Schedule(TimerNode& timer, uint64 delay)
+{
+    if (timer._wheel)
+    {
+        timer.Unlink();
+        --timer._wheel->_count;
+    }
+
+    timer._wheel = this;
+    timer._expires = _now + std::min(std::max<uint64>(delay, 1), TIMING_WHEEL_MAX_DELAY);
+    ++_count;
+
+    Insert(timer);
+}
+
+void TimingWheel::Insert(TimerNode& timer)
+{
+    // the level is given by the highest group of bits where the expiry differs from now
+    uint64 diff = timer._expires ^ _now;
+    uint32 level = 0;
+    while (level < TIMING_WHEEL_LEVELS - 1 && (diff >> (TIMING_WHEEL_BITS * (level + 1))) != 0)
+        ++level;
+
+    uint32 slot = uint32(timer._expires >> (TIMING_WHEEL_BITS * level)) & (TIMING_WHEEL_SLOTS - 1);
+
+    TimerNode& head = _slots[level][slot];
+    timer._prev = head._prev;
+    timer._next = &head;
+    head._prev->_next = &timer;
+    head._prev = &timer;
+
+    _occupied[level] |= uint64(1) << slot;
+}
+
+void TimingWheel::Cascade(uint32 level)
+{
+    uint32 slot = uint32(_now >> (TIMING_WHEEL_BITS * level)) & (TIMING_WHEEL_SLOTS - 1);
+    if (!(_occupied[level] & (uint64(1) << slot)))
+        return;
+
+    _occupied[level] &= ~(uint64(1) << slot);
+
+    // every timer of the slot now expires within the range of a lower level
+    Sentinel moved;
+    Splice(_slots[level][slot], moved);
+
+    while (moved._next != &moved)
+    {
+        TimerNode* timer = moved._next;
+        timer->Unlink();
+        Insert(*timer);
+    }
+
+    moved._prev = moved._next = nullptr;
+}
+
+void TimingWheel::Splice(TimerNode& from, TimerNode& to)
+{
+    if (from._next == &from)
+    {
+        to._prev = to._next = &to;
+        return;
+    }
+
+    to._next = from._next;
+    to._prev = from._prev;
+    to._next->_prev = &to;
+    to._prev->_next = &to;
+    from._prev = from._next = &from;
+}
+
+void TimingWheel::Fire(uint32 slot)
+{
+    if (!(_occupied[0] & (uint64(1) << slot)))
+        return;
+
+    _occupied[0] &= ~(uint64(1) << slot);
+
+    // moved aside first, a handler may schedule or cancel any timer, this one included
+    Sentinel expired;
+    Splice(_slots[0][slot], expired);
+
+    while (expired._next != &expired)
+    {
+        TimerNode* timer = expired._next;
+        timer->Unlink();
+        timer->_wheel = nullptr;
+        --_count;
+        timer->Expire();
+    }
+
+    expired._prev = expired._next = nullptr;
+}
+
+uint64 TimingWheel::NextStop(uint64 target) const
+{
+    uint32 position = uint32(_now) & (TIMING_WHEEL_SLOTS - 1);
+    uint64 wrap = (_now | (TIMING_WHEEL_SLOTS - 1)) + 1;
+
+    uint64 pending = position + 1 < TIMING_WHEEL_SLOTS ? _occupied[0] >> (position + 1) : 0;
+    uint64 next = pending ? _now + 1 + LowestBit(pending) : wrap;
+
+    return std::min(next, target);
+}
+
+void TimingWheel::Update(uint32 diff)
+{
+    uint64 target = _now + diff;
+    while (_now < target)
+    {
+        _now = NextStop(target);
+
+        // when a level wraps, the slot of the level above that starts is spread below, highest first
+        if ((_now & (TIMING_WHEEL_SLOTS - 1)) == 0)
+        {
+            uint32 top = 1;
+            while (top < TIMING_WHEEL_LEVELS - 1 && ((_now >> (TIMING_WHEEL_BITS * top)) & (TIMING_WHEEL_SLOTS - 1)) == 0)
+                ++top;
+
+            for (uint32 level = top; level > 0; --level)
+                Cascade(level);
+        }
+
+        Fire(uint32(_now) & (TIMING_WHEEL_SLOTS - 1));
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef TRINITYCORE_TIMINGWHEEL_H
+#define TRINITYCORE_TIMINGWHEEL_H
+
+#include "Define.h"
+
+#if COMPILER == COMPILER_MICROSOFT
+#  include <intrin.h>
+#endif
+
+/// Hierarchical timing wheel: TIMING_WHEEL_LEVELS wheels of TIMING_WHEEL_SLOTS slots, one tick
+/// being a millisecond. A timer goes to the lowest level whose range holds its expiry and moves
+/// one level down each time the level below wraps, the last level firing it.
+/// Scheduling and cancelling are O(1), advancing costs one step per 64 ticks plus one per expiry.
+/// Not thread safe, a wheel and its timers belong to one thread at a time (a room).
+#define TIMING_WHEEL_BITS      6
+#define TIMING_WHEEL_SLOTS     (1 << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_LEVELS    4
+#define TIMING_WHEEL_MAX_DELAY ((uint64(1) << (TIMING_WHEEL_BITS * TIMING_WHEEL_LEVELS)) - 1)
+
+class TimingWheel;
+
+/// Intrusive timer node, embedded in the object it wakes up.
+/// A timer destroyed while scheduled removes itself from its wheel.
+class TimerNode
+{
+    friend class TimingWheel;
+
+public:
+    TimerNode() : _wheel(nullptr), _prev(nullptr), _next(nullptr), _expires(0) { }
+    virtual ~TimerNode() { Cancel(); }
+
+    bool IsScheduled() const { return _wheel != nullptr; }
+    void Cancel();
+
+protected:
+    virtual void Expire() = 0;
+
+private:
+    TimerNode(TimerNode const&) = delete;
+    TimerNode& operator=(TimerNode const&) = delete;
+
+    void Unlink();
+
+    TimingWheel* _wheel;
+    TimerNode* _prev;
+    TimerNode* _next;
+    uint64 _expires;
+};
+
+/// Timer calling a member function of its owner
+template<class T>
+class MemberTimer : public TimerNode
+{
+public:
+    typedef void (T::*Handler)();
+
+    MemberTimer(T* owner, Handler handler) : _owner(owner), _handler(handler) { }
+
+protected:
+    void Expire() override { (_owner->*_handler)(); }
+
+private:
+    T* _owner;
+    Handler _handler;
+};
+
+class TimingWheel
+{
+    friend class TimerNode;
+
+public:
+    TimingWheel();
+    ~TimingWheel();
+
+    /// (re)schedules timer to expire delay ms from now, at least one tick, at most TIMING_WHEEL_MAX_DELAY
+    void Schedule(TimerNode& timer, uint64 delay);
+
+    /// moves the wheel diff ms forward and fires every timer expired meanwhile, in expiry order
+    void Update(uint32 diff);
+
+    uint64 GetTime() const { return _now; }
+    uint32 GetTimerCount() const { return _count; }
+
+private:
+    TimingWheel(TimingWheel const&) = delete;
+    TimingWheel& operator=(TimingWheel const&) = delete;
+
+    // head of the circular list of a slot
+    struct Sentinel : TimerNode
+    {
+        void Expire() override { }
+    };
+
+    void Insert(TimerNode& timer);
+    void Cascade(uint32 level);
+    /// moves the list headed by from to the empty sentinel to
+    static void Splice(TimerNode& from, TimerNode& to);
+    void Fire(uint32 slot);
+    /// next tick, up to target, at which a level 0 slot may fire or the lowest level wraps
+    uint64 NextStop(uint64 target) const;
+
+    static uint32 LowestBit(uint64 value)
+    {
+#if COMPILER == COMPILER_MICROSOFT
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return uint32(index);
+#else
+        return uint32(__builtin_ctzll(value));
+#endif
+    }
+
+    Sentinel _slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+    uint64 _occupied[TIMING_WHEEL_LEVELS];      // a bit per slot that may hold timers
+    uint64 _now;
+    uint32 _count;
+};
+
+#endif
@@ -31,6 +31,13 @@
   #include <arpa/inet.h>
 #endif
 
+#if PLATFORM == PLATFORM_WINDOWS
+  #include <random>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
 static boost::thread_specific_ptr<SFMTRand> sfmtRand;
 
 static SFMTRand* GetRng()
@@ -69,6 +76,20 @@ uint32 rand32()
     return GetRng()->BRandom();
 }
 
+uint64 rand_secure()
+{
+    uint64 value = 0;
+#if PLATFORM == PLATFORM_WINDOWS
+    std::random_device device;
+    value = uint64(device()) << 32 | device();
+#else
+    static int const urandom = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    ssize_t got = urandom >= 0 ? read(urandom, &value, sizeof(value)) : -1;
+    ASSERT(got == ssize_t(sizeof(value)));
+#endif
+    return value;
+}
+
 double rand_norm()
 {
     return GetRng()->Random();
@@ -85,6 +85,10 @@ uint32 urand(uint32 min, uint32 max);
 /* Return a random number in the range 0 .. UINT32_MAX. */
 uint32 rand32();
 
+/* Return a random number from the entropy of the system, for the secrets a client must not guess.
+   The generators above are seeded from the time. */
+uint64 rand_secure();
+
 /* Return a random number in the range min..max */
 float frand(float min, float max);
 
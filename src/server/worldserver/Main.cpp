@@ -1,9 +1,15 @@
 #include <boost/asio.hpp>
 #include <thread>
 
+#include "AdminSocket.h"
 #include "AsyncAcceptor.h"
+#include "ClusterNode.h"
 #include "Configuration/Config.h"
+#include "Handoff.h"
 #include "Log.h"
+#include "MetricsSocket.h"
+#include "SpectatorMgr.h"
+#include "Watchdog.h"
 #include "World.h"
 #include "WorldSocket.h"
 
@@ -16,7 +22,11 @@
 
 boost::asio::io_service _ioService;
 
-void SignalHandler(const boost::system::error_code& error, int signalNumber);
+void SignalHandler(boost::asio::signal_set* signals, const boost::system::error_code& error, int signalNumber);
+
+#if PLATFORM != PLATFORM_WINDOWS
+void ReloadSignalHandler(boost::asio::signal_set* signals, const boost::system::error_code& error, int signalNumber);
+#endif
 
 void WorldUpdateLoop();
 
@@ -32,11 +42,18 @@ int main(int argc, char* argv[])
 		printf("Error in config file: %s\n", configError.c_str());
 		return 1;
 	}
+	// SIGTERM drains the server, a second one or SIGINT stops it right away
 	boost::asio::signal_set signals(_ioService, SIGINT, SIGTERM);
 #if PLATFORM == PLATFORM_WINDOWS
 	signals.add(SIGBREAK);
 #endif
-	signals.async_wait(SignalHandler);
+	signals.async_wait(boost::bind(&SignalHandler, &signals, boost::asio::placeholders::error, boost::asio::placeholders::signal_number));
+
+#if PLATFORM != PLATFORM_WINDOWS
+	// SIGHUP reloads worldserver.conf
+	boost::asio::signal_set reloadSignals(_ioService, SIGHUP);
+	reloadSignals.async_wait(boost::bind(&ReloadSignalHandler, &reloadSignals, boost::asio::placeholders::error, boost::asio::placeholders::signal_number));
+#endif
 
 	int numThreads = sConfigMgr->GetIntDefault("ThreadPool", 1);
 	std::vector<std::thread> threadPool;
@@ -47,6 +64,12 @@ int main(int argc, char* argv[])
 	for (int i = 0; i < numThreads; ++i)
 		threadPool.push_back(std::thread(boost::bind(&boost::asio::io_service::run, &_ioService)));
 
+	// Take the listening sockets of the server running at the handoff socket, it drains meanwhile.
+	// The store is only loaded once that server closed it.
+	std::string handoffSocket = sConfigMgr->GetStringDefault("Handoff.Socket", "");
+	if (!handoffSocket.empty())
+		sHandoff->TakeOver(handoffSocket);
+
 	// Initialize the World
 	sWorld->SetInitialWorldSettings();
 	// Launch the worldserver listener socket
@@ -54,22 +77,145 @@ int main(int argc, char* argv[])
 	std::string worldListener = sConfigMgr->GetStringDefault("BindIP", "0.0.0.0");
 	bool tcpNoDelay = sConfigMgr->GetBoolDefault("Network.TcpNodelay", true);
 
-	AsyncAcceptor<WorldSocket> worldAcceptor(_ioService, worldListener, worldPort, tcpNoDelay);
+	// Listeners handed over come in the order they are taken below
+	uint32 handedListener = 0;
+
+	std::unique_ptr<AsyncAcceptor<WorldSocket>> worldAcceptor;
+	if (sHandoff->GetListener(handedListener) >= 0)
+		worldAcceptor.reset(new AsyncAcceptor<WorldSocket>(_ioService, sHandoff->GetListener(handedListener++), tcpNoDelay));
+	else
+		worldAcceptor.reset(new AsyncAcceptor<WorldSocket>(_ioService, worldListener, worldPort, tcpNoDelay));
+
+	// Launch the metrics endpoint, local only unless configured otherwise
+	std::unique_ptr<AsyncAcceptor<MetricsSocket>> metricsAcceptor;
+	if (sConfigMgr->GetBoolDefault("Metrics.Enable", true))
+	{
+		std::string metricsListener = sConfigMgr->GetStringDefault("Metrics.BindIP", "127.0.0.1");
+		uint16 metricsPort = uint16(sConfigMgr->GetIntDefault("Metrics.Port", 8086));
+
+		if (sHandoff->GetListener(handedListener) >= 0)
+			metricsAcceptor.reset(new AsyncAcceptor<MetricsSocket>(_ioService, sHandoff->GetListener(handedListener++), false));
+		else
+			metricsAcceptor.reset(new AsyncAcceptor<MetricsSocket>(_ioService, metricsListener, metricsPort));
+		TC_LOG_INFO("server.worldserver", "Metrics endpoint listening on http://%s:%u/metrics", metricsListener.c_str(), metricsPort);
+	}
+
+	// Launch the admin console, on a Unix socket or on a localhost port
+	std::unique_ptr<AsyncAcceptor<AdminSocket<tcp>>> adminAcceptor;
+#if PLATFORM != PLATFORM_WINDOWS
+	std::unique_ptr<AdminLocalAcceptor> adminLocalAcceptor;
+#endif
+	if (sConfigMgr->GetBoolDefault("Admin.Enable", false))
+	{
+		std::string adminSocket = sConfigMgr->GetStringDefault("Admin.Socket", "");
+		uint16 adminPort = uint16(sConfigMgr->GetIntDefault("Admin.Port", 8087));
+		std::string adminSecret = sConfigMgr->GetStringDefault("Admin.Secret", "");
+		sAdminConsole->SetSecret(adminSecret);
+
+#if PLATFORM != PLATFORM_WINDOWS
+		if (!adminSocket.empty())
+		{
+			adminLocalAcceptor.reset(new AdminLocalAcceptor(_ioService, adminSocket));
+			if (adminLocalAcceptor->IsOpen())
+				TC_LOG_INFO("server.worldserver", "Admin console listening on %s", adminSocket.c_str());
+		}
+		else
+#endif
+		if (!adminSecret.empty())
+		{
+			if (sHandoff->GetListener(handedListener) >= 0)
+				adminAcceptor.reset(new AsyncAcceptor<AdminSocket<tcp>>(_ioService, sHandoff->GetListener(handedListener++), false));
+			else
+				adminAcceptor.reset(new AsyncAcceptor<AdminSocket<tcp>>(_ioService, "127.0.0.1", adminPort));
+			TC_LOG_INFO("server.worldserver", "Admin console listening on 127.0.0.1:%u", adminPort);
+		}
+		else
+		{
+			// any local user can connect to the port, it is not opened without a secret to ask them
+			TC_LOG_ERROR("server.worldserver", "Admin console needs Admin.Secret to listen on 127.0.0.1:%u, it stays closed", adminPort);
+		}
+	}
+
+	// Wait for the server to hand over to, the listeners go in the order taken above
+	if (!handoffSocket.empty())
+	{
+		std::vector<int> listeners;
+		listeners.push_back(worldAcceptor->GetNativeHandle());
+		if (metricsAcceptor)
+			listeners.push_back(metricsAcceptor->GetNativeHandle());
+		if (adminAcceptor)
+			listeners.push_back(adminAcceptor->GetNativeHandle());
+
+		AsyncAcceptor<WorldSocket>* world = worldAcceptor.get();
+		AsyncAcceptor<MetricsSocket>* metrics = metricsAcceptor.get();
+		AsyncAcceptor<AdminSocket<tcp>>* admin = adminAcceptor.get();
+		sHandoff->Start(_ioService, handoffSocket, listeners, [world, metrics, admin]()
+		{
+			world->Close();
+			if (metrics)
+				metrics->Close();
+			if (admin)
+				admin->Close();
+		});
+	}
+
+	// Take the players the cluster router sends, next to the ones connecting directly
+	std::string clusterRouter = sConfigMgr->GetStringDefault("Cluster.Router", "");
+	if (!clusterRouter.empty())
+		sClusterNode->Start(_ioService, clusterRouter, sConfigMgr->GetIntDefault("Cluster.NodeId", 1));
+
+	// Release the delayed desk events to the spectators on the network threads
+	sSpectatorMgr->Start(_ioService);
+
+	// Watch the world and room ticks for stalls
+	if (sConfigMgr->GetBoolDefault("Watchdog.Enable", true))
+	{
+		sWatchdog->Start(sConfigMgr->GetIntDefault("Watchdog.Threshold", 500),
+			sConfigMgr->GetIntDefault("Watchdog.CheckInterval", 100),
+			sConfigMgr->GetIntDefault("Watchdog.ReportCooldown", 30));
+	}
 
 	WorldUpdateLoop();
 
 	// Shutdown starts here
+	sWatchdog->Stop();
+	sWorld->CleanupsBeforeStop();
+	sClusterNode->Stop();
+	sSpectatorMgr->Stop();
+	sHandoff->Stop();
 	ShutdownThreadPool(threadPool);
 
 	return 0;
 }
 
-void SignalHandler(const boost::system::error_code& error, int /*signalNumber*/)
+void SignalHandler(boost::asio::signal_set* signals, const boost::system::error_code& error, int signalNumber)
 {
-	if (!error)
+	if (error)
+		return;
+
+	if (signalNumber != SIGTERM || sWorld->IsDraining())
+	{
 		World::StopNow(SHUTDOWN_EXIT_CODE);
+		return;
+	}
+
+	TC_LOG_INFO("server.worldserver", "SIGTERM received, draining, a second one stops the server");
+	sWorld->RequestDrain();
+	signals->async_wait(boost::bind(&SignalHandler, signals, boost::asio::placeholders::error, boost::asio::placeholders::signal_number));
 }
 
+#if PLATFORM != PLATFORM_WINDOWS
+void ReloadSignalHandler(boost::asio::signal_set* signals, const boost::system::error_code& error, int /*signalNumber*/)
+{
+	if (error)
+		return;
+
+	TC_LOG_INFO("server.worldserver", "SIGHUP received, reloading worldserver.conf");
+	sWorld->RequestConfigReload();
+	signals->async_wait(boost::bind(&ReloadSignalHandler, signals, boost::asio::placeholders::error, boost::asio::placeholders::signal_number));
+}
+#endif
+
 void WorldUpdateLoop()
 {
 	uint32 realCurrTime = 0;
@@ -77,6 +223,8 @@ void WorldUpdateLoop()
 
 	uint32 prevSleepTime = 0;                               // used for balanced full tick time length near WORLD_SLEEP_CONST
 
+	sWatchdog->SetThreadName("world");
+
 	///- While we have not World::m_stopEvent, update the world
 	while (!World::IsStopped())
 	{
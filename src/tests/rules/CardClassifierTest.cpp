@@ -0,0 +1,109 @@
+#include "CardClassifier.h"
+#include "GameVariant.h"
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+
+/// Checks CardClassifier::CheckPlay, what the server lets a client play: only cards of the hand,
+/// beating the last play of the desk or passing on it, and the multiplier a grab score sets the stake
+/// with. Returns the number of failed checks.
+
+typedef CardClassifier<ClassicRules> Classifier;
+
+static uint32 Failures = 0;
+
+/// cards from color << 4 | rank values, terminated like the hands and the plays of the players
+struct Cards
+{
+	Cards(std::initializer_list<uint8> values)
+	{
+		memset(cards, CARD_TERMINATE, sizeof(cards));
+		uint32 i = 0;
+		for (uint8 value : values)
+			cards[i++] = value;
+	}
+
+	uint8 cards[24];
+};
+
+static void Check(char const* name, CardType type, CardType expected)
+{
+	if (type == expected)
+		return;
+
+	printf("%s: type %u, expected %u\n", name, uint32(type), uint32(expected));
+	++Failures;
+}
+
+static void CheckMultiplier(char const* name, uint64 multiplier, uint64 expected)
+{
+	if (multiplier == expected)
+		return;
+
+	printf("%s: multiplier %llu, expected %llu\n", name, (unsigned long long)multiplier, (unsigned long long)expected);
+	++Failures;
+}
+
+static CardType Lead(Cards const& hand, Cards const& play)
+{
+	return Classifier::CheckPlay(hand.cards, play.cards, nullptr, 24);
+}
+
+static CardType Follow(Cards const& hand, Cards const& play, Cards const& last)
+{
+	return Classifier::CheckPlay(hand.cards, play.cards, last.cards, 24);
+}
+
+int main()
+{
+	/// a 3 of each color, the jokers, a pair of 5 and single 7, 9 and king
+	Cards hand = { 0x00, 0x10, 0x20, 0x30, 61, 62, 0x02, 0x12, 0x04, 0x06, 0x0a };
+
+	/// the same card four times makes a bomb of one card held
+	Check("fake bomb of one card", Classifier::Classify(Cards({ 0x02, 0x02, 0x02, 0x02 }).cards, 24), CARD_TYPE_BOMB);
+	Check("fake bomb of one card", Lead(hand, { 0x02, 0x02, 0x02, 0x02 }), CARD_TYPE_END);
+	Check("fake bomb of cards not held", Lead(hand, { 0x05, 0x15, 0x25, 0x35 }), CARD_TYPE_END);
+	Check("fake bomb on a play", Follow(hand, { 0x0b, 0x1b, 0x2b, 0x3b }, { 0x01 }), CARD_TYPE_END);
+	Check("fake rocket", Lead({ 0x00, 61 }, { 61, 62 }), CARD_TYPE_END);
+	Check("card played twice", Lead(hand, { 0x04, 0x04 }), CARD_TYPE_END);
+
+	Check("bomb held", Lead(hand, { 0x00, 0x10, 0x20, 0x30 }), CARD_TYPE_BOMB);
+	Check("rocket held", Lead(hand, { 61, 62 }), CARD_TYPE_ROCKET);
+	Check("pair held", Lead(hand, { 0x02, 0x12 }), CARD_TYPE_PAIR);
+
+	Check("pass on a lead", Lead(hand, { }), CARD_TYPE_END);
+	Check("pass on a play", Follow(hand, { }, { 0x0c }), CARD_TYPE_PASS);
+
+	Check("higher single", Follow(hand, { 0x0a }, { 0x07 }), CARD_TYPE_SINGLE);
+	Check("lower single", Follow(hand, { 0x04 }, { 0x07 }), CARD_TYPE_END);
+	Check("same rank", Follow(hand, { 0x06 }, { 0x16 }), CARD_TYPE_END);
+	Check("pair on a single", Follow(hand, { 0x02, 0x12 }, { 0x01 }), CARD_TYPE_END);
+	Check("higher pair", Follow(hand, { 0x02, 0x12 }, { 0x01, 0x11 }), CARD_TYPE_PAIR);
+
+	Check("bomb on a pair", Follow(hand, { 0x00, 0x10, 0x20, 0x30 }, { 0x0c, 0x1c }), CARD_TYPE_BOMB);
+	Check("lower bomb", Follow(hand, { 0x00, 0x10, 0x20, 0x30 }, { 0x01, 0x11, 0x21, 0x31 }), CARD_TYPE_END);
+	Check("rocket on a bomb", Follow(hand, { 61, 62 }, { 0x0c, 0x1c, 0x2c, 0x3c }), CARD_TYPE_ROCKET);
+	Check("bomb on a rocket", Follow({ 0x01, 0x11, 0x21, 0x31 }, { 0x01, 0x11, 0x21, 0x31 }, { 61, 62 }), CARD_TYPE_END);
+
+	Cards run = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+	Check("higher run", Follow(run, { 0x02, 0x03, 0x04, 0x05, 0x06 }, { 0x10, 0x11, 0x12, 0x13, 0x14 }), CARD_TYPE_SINGLE_PROGRESSION);
+	Check("longer run", Follow(run, { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 }, { 0x10, 0x11, 0x12, 0x13, 0x14 }), CARD_TYPE_END);
+
+	/// 444 555 with 6666 as two pairs of wings is led by the 5, below 555 666 with a pair of 3 and of 7
+	Cards airplane = { 0x01, 0x11, 0x21, 0x02, 0x12, 0x22, 0x03, 0x13, 0x23, 0x33 };
+	Check("airplane", Lead(airplane, airplane), CARD_TYPE_AIRPLANE);
+	Check("lower airplane", Follow(airplane, airplane, { 0x02, 0x12, 0x22, 0x03, 0x13, 0x23, 0x00, 0x10, 0x04, 0x14 }), CARD_TYPE_END);
+
+	/// a score out of range sent by a client multiplies the stake by the max grab score at most
+	RulesVariant<ClassicRules> variant;
+	CheckMultiplier("grab score 2", variant.GetMultiplier(2, 0, false), 2);
+	CheckMultiplier("grab score 2 with a bomb", variant.GetMultiplier(2, 1, false), 4);
+	CheckMultiplier("no grab score", variant.GetMultiplier(-1, 0, false), 1);
+	CheckMultiplier("grab score over the max", variant.GetMultiplier(0x3FFFFFFF, 0, false), ClassicRules::MAX_GRAB_SCORE);
+	CheckMultiplier("grab score over the max with a spring", variant.GetMultiplier(0x7FFFFFFF, 0, true), ClassicRules::MAX_GRAB_SCORE * 2);
+
+	if (Failures)
+		printf("%u checks failed\n", Failures);
+	return Failures ? 1 : 0;
+}
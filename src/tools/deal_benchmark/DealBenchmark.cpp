@@ -0,0 +1,157 @@
+#include "GameRules.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+/// Measures the deal throughput of the room shuffles: the former rand() % 54 swap, a DeckShuffler
+/// shuffling one deck a call, and ClassicRules::Deal shuffling a batch of decks a call as the rooms
+/// do. Every thread deals with its own shuffler like a room updater thread, while rand() is shared by
+/// all of them. It also checks a batch deals the same decks as the deals one by one, which
+/// Room::ReplayDeal relies on.
+
+struct BenchmarkOptions
+{
+	BenchmarkOptions() : count(1000000), batch(16), threads(1), seed(uint32(time(nullptr))) { }
+
+	uint32 count;                /// decks dealt by each thread
+	uint32 batch;                /// decks a ClassicRules::Deal call
+	uint32 threads;
+	uint32 seed;
+};
+
+enum DealMethod
+{
+	DEAL_METHOD_RAND,
+	DEAL_METHOD_SINGLE,
+	DEAL_METHOD_BATCH,
+	MAX_DEAL_METHODS
+};
+
+static char const* const MethodNames[MAX_DEAL_METHODS] = { "rand() % 54 swap", "DeckShuffler, one deck", "DeckShuffler, batch" };
+
+static void Usage(char const* prog)
+{
+	printf("Usage: %s [options]\n"
+		"  -n <count>       decks dealt by each thread (default 1000000)\n"
+		"  -b <batch>       decks shuffled a call by the batch (default 16, the rooms' batch)\n"
+		"  -t <threads>     threads dealing at once (default 1)\n"
+		"  -s <seed>        seed of the shufflers (default: the time)\n", prog);
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc)
+			return false;
+
+		char const* value = argv[++i];
+		switch (argv[i - 1][1])
+		{
+			case 'n': options.count = strtoul(value, nullptr, 10); break;
+			case 'b': options.batch = strtoul(value, nullptr, 10); break;
+			case 't': options.threads = strtoul(value, nullptr, 10); break;
+			case 's': options.seed = strtoul(value, nullptr, 10); break;
+			default: return false;
+		}
+	}
+	return options.count > 0 && options.batch > 0 && options.threads > 0;
+}
+
+/// the shuffle the rooms used before DeckShuffler
+static void RandSwap(uint8* deck)
+{
+	for (uint32 i = 0; i < ClassicRules::DECK_CARDS; ++i)
+	{
+		uint32 other = rand() % ClassicRules::DECK_CARDS;
+		std::swap(deck[i], deck[other]);
+	}
+}
+
+/// deals count decks, the sum of the first cards keeps the compiler from dropping the work
+static uint32 Deal(DealMethod method, BenchmarkOptions const& options, uint32 seed)
+{
+	DeckShuffler shuffler(seed);
+	std::vector<uint8> decks(options.batch * ClassicRules::DECK_CARDS);
+	uint32 sum = 0;
+
+	for (uint32 dealt = 0; dealt < options.count;)
+	{
+		switch (method)
+		{
+			case DEAL_METHOD_RAND:
+				ClassicRules::NewDeck(decks.data());
+				RandSwap(decks.data());
+				++dealt;
+				break;
+			case DEAL_METHOD_SINGLE:
+				ClassicRules::Deal(shuffler, decks.data(), 1);
+				++dealt;
+				break;
+			default:
+				ClassicRules::Deal(shuffler, decks.data(), options.batch);
+				dealt += options.batch;
+				break;
+		}
+		sum += decks[0];
+	}
+	return sum;
+}
+
+static bool CheckBatch(uint32 seed, uint32 batch)
+{
+	DeckShuffler batched(seed);
+	DeckShuffler single(seed);
+	std::vector<uint8> decks(batch * ClassicRules::DECK_CARDS);
+	uint8 deck[ClassicRules::DECK_CARDS];
+
+	ClassicRules::Deal(batched, decks.data(), batch);
+	for (uint32 i = 0; i < batch; ++i)
+	{
+		ClassicRules::Deal(single, deck, 1);
+		if (memcmp(deck, &decks[i * ClassicRules::DECK_CARDS], ClassicRules::DECK_CARDS) != 0)
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	if (!CheckBatch(options.seed, options.batch))
+	{
+		printf("A batch of %u decks does not deal the decks dealt one by one, seed %u\n", options.batch, options.seed);
+		return 1;
+	}
+
+	printf("Dealing %u decks on each of %u threads, batch of %u, seed %u\n", options.count, options.threads, options.batch, options.seed);
+	srand(options.seed);
+
+	for (uint32 method = 0; method < MAX_DEAL_METHODS; ++method)
+	{
+		std::vector<uint32> sums(options.threads);
+		std::vector<std::thread> threads;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (uint32 i = 0; i < options.threads; ++i)
+			threads.emplace_back([&options, &sums, method, i]() { sums[i] = Deal(DealMethod(method), options, options.seed + i); });
+		for (std::thread& thread : threads)
+			thread.join();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("  %-24s %12.0f decks/s (%.3f s, check %u)\n", MethodNames[method],
+			double(options.count) * options.threads / seconds, seconds, sums[0]);
+	}
+	return 0;
+}
@@ -0,0 +1,150 @@
+#include "DealTable.h"
+#include "GameRules.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+/// Builds the deal table of the no-shuffle rooms. Deals are shaped like NoShuffleRules deals them
+/// without a table, only the ones whose bombs fall in the wanted range are kept: the server then
+/// deals the bomb-heavy hands with a lookup instead of shaping and sorting out decks at each deal.
+
+struct GeneratorOptions
+{
+	GeneratorOptions() : count(1000000), seed(uint32(time(nullptr))), minBombs(2), maxBombs(6), maxSeatBombs(3),
+		fileName("dealtable.bin") { }
+
+	uint32 count;
+	uint32 seed;
+	uint32 minBombs;             /// bombs and rockets over the three hands
+	uint32 maxBombs;
+	uint32 maxSeatBombs;         /// bombs and rockets in a single hand
+	char const* fileName;
+};
+
+static void Usage(char const* prog)
+{
+	printf("Usage: %s [options]\n"
+		"  -n <count>       deals in the table (default 1000000)\n"
+		"  -s <seed>        seed of the generator (default: the time)\n"
+		"  -b <min>         fewest bombs and rockets of a deal (default 2)\n"
+		"  -B <max>         most bombs and rockets of a deal (default 6)\n"
+		"  -h <max>         most bombs and rockets of a hand (default 3)\n"
+		"  -o <file>        table to write (default dealtable.bin)\n", prog);
+}
+
+static bool ParseOptions(int argc, char** argv, GeneratorOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc)
+			return false;
+
+		char const* value = argv[++i];
+		switch (argv[i - 1][1])
+		{
+			case 'n': options.count = strtoul(value, nullptr, 10); break;
+			case 's': options.seed = strtoul(value, nullptr, 10); break;
+			case 'b': options.minBombs = strtoul(value, nullptr, 10); break;
+			case 'B': options.maxBombs = strtoul(value, nullptr, 10); break;
+			case 'h': options.maxSeatBombs = strtoul(value, nullptr, 10); break;
+			case 'o': options.fileName = value; break;
+			default: return false;
+		}
+	}
+	return options.count > 0 && options.minBombs <= options.maxBombs;
+}
+
+/// bombs and rockets of each hand of a deal
+static uint32 CountBombs(uint8 const* deck, uint32* seatBombs)
+{
+	uint32 total = 0;
+	for (uint32 seat = 0; seat < NoShuffleRules::SEATS; ++seat)
+	{
+		uint8 counts[CARD_RANKS] = { 0 };
+		for (uint32 i = 0; i < NoShuffleRules::HAND_CARDS; ++i)
+			++counts[CardRank(deck[seat * NoShuffleRules::HAND_CARDS + i])];
+
+		seatBombs[seat] = counts[CARD_RANK_SMALL_JOKER] && counts[CARD_RANK_BIG_JOKER] ? 1 : 0;
+		for (uint8 rank = 0; rank < CARD_RANK_SMALL_JOKER; ++rank)
+			if (counts[rank] == CARD_COLORS)
+				++seatBombs[seat];
+		total += seatBombs[seat];
+	}
+	return total;
+}
+
+int main(int argc, char** argv)
+{
+	GeneratorOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	printf("Generating %u deals with %u to %u bombs (at most %u a hand), seed %u\n",
+		options.count, options.minBombs, options.maxBombs, options.maxSeatBombs, options.seed);
+
+	DeckShuffler shuffler(options.seed);
+	std::vector<uint8> deals(uint64(options.count) * DEAL_TABLE_DECK);
+	uint64 shaped = 0;
+	uint32 histogram[NoShuffleRules::SEATS * CARD_RANKS] = { 0 };
+
+	for (uint32 i = 0; i < options.count; ++i)
+	{
+		uint8 deck[DEAL_TABLE_DECK];
+		uint32 seatBombs[NoShuffleRules::SEATS];
+		uint32 bombs;
+		uint32 attempts = 0;
+		do
+		{
+			if (++attempts > 100000)
+			{
+				printf("No deal in 100000 matches the bomb range, widen it\n");
+				return 1;
+			}
+
+			NoShuffleRules::Shape(shuffler, deck);
+			bombs = CountBombs(deck, seatBombs);
+			++shaped;
+		} while (bombs < options.minBombs || bombs > options.maxBombs || seatBombs[0] > options.maxSeatBombs
+			|| seatBombs[1] > options.maxSeatBombs || seatBombs[2] > options.maxSeatBombs);
+
+		/// only the ranks are kept, the server picks the suits at each deal
+		for (uint32 card = 0; card < DEAL_TABLE_DECK; ++card)
+			deals[uint64(i) * DEAL_TABLE_DECK + card] = CardRank(deck[card]);
+		++histogram[bombs];
+	}
+
+	DealTableHeader header;
+	header.magic = DEAL_TABLE_MAGIC;
+	header.version = DEAL_TABLE_VERSION;
+	header.deckSize = DEAL_TABLE_DECK;
+	header.count = options.count;
+	header.seed = options.seed;
+	header.checksum = DealTableChecksum(deals.data(), deals.size());
+
+	FILE* file = fopen(options.fileName, "wb");
+	if (!file)
+	{
+		printf("Can't open %s\n", options.fileName);
+		return 1;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(deals.data(), 1, deals.size(), file) == deals.size();
+	written = fclose(file) == 0 && written;
+	if (!written)
+	{
+		printf("Can't write %s\n", options.fileName);
+		remove(options.fileName);
+		return 1;
+	}
+
+	printf("Kept %u of " UI64FMTD " deals shaped, bombs a deal:\n", options.count, shaped);
+	for (uint32 bombs = options.minBombs; bombs <= options.maxBombs && bombs < NoShuffleRules::SEATS * CARD_RANKS; ++bombs)
+		printf("  %2u: %u\n", bombs, histogram[bombs]);
+	printf("Wrote %s\n", options.fileName);
+	return 0;
+}